@@ -0,0 +1,377 @@
+//-----------------------------------------------------
+// Name: benchmain.cpp
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <sstream>
+
+#include "corpusgenerator.h"
+#include "corpusstats.h"
+#include "mst.h"
+#include "mstdiff.h"
+#include "mstmerge.h"
+
+namespace
+{
+
+struct BenchOptions
+{
+    BenchOptions():m_iterations(5),m_keep(false){ m_sizes.push_back(1000); m_sizes.push_back(10000); m_sizes.push_back(100000); }
+
+    CorpusGenerator::Options m_corpus;
+    vector<unsigned int> m_sizes;
+    unsigned int m_iterations;
+    string m_dir;
+    bool m_keep;
+};
+
+//-----------------------------------------------------
+// Best of _iterations runs, in seconds
+//-----------------------------------------------------
+double Measure
+(
+    unsigned int _iterations,
+    function<void()> const& _func
+)
+{
+    double best = 0.0;
+    for (unsigned int i = 0; i < _iterations; i++)
+    {
+        auto const start = chrono::steady_clock::now();
+        _func();
+        double const seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        best = (i == 0) ? seconds : min(best, seconds);
+    }
+    return best;
+}
+
+//-----------------------------------------------------
+// One line of the report, _bytes 0 for no MB/s
+//-----------------------------------------------------
+void Report
+(
+    char const* _name,
+    unsigned int _entries,
+    double _seconds,
+    double _bytes,
+    double _items
+)
+{
+    double const mb = _bytes / (1024.0 * 1024.0);
+    printf("%-16s %9u %12.3f", _name, _entries, _seconds * 1000.0);
+    if (_bytes > 0)
+    {
+        printf(" %12.1f", mb / _seconds);
+    }
+    else
+    {
+        printf(" %12s", "-");
+    }
+    printf(" %14.0f\n", _items / _seconds);
+    fflush(stdout);
+}
+
+long long GetFileSize
+(
+    string const& _fileName
+)
+{
+    FILE* file = fopen(_fileName.c_str(), "rb");
+    if (!file) return 0;
+    fseek(file, 0, SEEK_END);
+    long long const size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+//-----------------------------------------------------
+// Generate a file of _entries entries and time every path on it
+//-----------------------------------------------------
+bool RunSize
+(
+    BenchOptions const& _options,
+    unsigned int _entries
+)
+{
+    CorpusGenerator::Options corpus = _options.m_corpus;
+    corpus.m_entryCount = _entries;
+
+    string const mstFile = _options.m_dir + "bench_" + to_string(_entries) + ".mst";
+    string const saveFile = _options.m_dir + "bench_" + to_string(_entries) + "_save.mst";
+    string const textFile = _options.m_dir + "bench_" + to_string(_entries) + ".txt";
+
+    string errorMsg;
+    if (!CorpusGenerator(corpus).Generate(mstFile, errorMsg))
+    {
+        fprintf(stderr, "%s: %s\n", mstFile.c_str(), errorMsg.c_str());
+        return false;
+    }
+    double const fileSize = static_cast<double>(GetFileSize(mstFile));
+
+    bool success = true;
+    mst file;
+    double seconds = Measure(_options.m_iterations, [&]()
+    {
+        success &= file.Load(mstFile, errorMsg);
+    });
+    if (!success)
+    {
+        fprintf(stderr, "%s: %s\n", mstFile.c_str(), errorMsg.c_str());
+        return false;
+    }
+    Report("Load", _entries, seconds, fileSize, _entries);
+
+    seconds = Measure(_options.m_iterations, [&]()
+    {
+        success &= file.Save(saveFile, errorMsg);
+    });
+    Report("Save", _entries, seconds, fileSize, _entries);
+
+    seconds = Measure(_options.m_iterations, [&]()
+    {
+        success &= file.Export(textFile, errorMsg);
+    });
+    Report("Export", _entries, seconds, static_cast<double>(GetFileSize(textFile)), _entries);
+
+    if (!success)
+    {
+        fprintf(stderr, "%s\n", errorMsg.c_str());
+        return false;
+    }
+
+    // Nothing matches, every entry is scanned
+    int found = 0;
+    seconds = Measure(_options.m_iterations, [&]()
+    {
+        found += file.Search(string("no_such_name"));
+    });
+    Report("Search(name)", _entries, seconds, 0, _entries);
+
+    seconds = Measure(_options.m_iterations, [&]()
+    {
+        found += file.Search(wstring(L"\x30F4\x30F4\x30F4"));
+    });
+    Report("Search(text)", _entries, seconds, 0, _entries);
+
+    // Every name once, the first call also builds the index
+    vector<string> names;
+    for (unsigned int i = 0; i < file.GetEntryCount(); i++)
+    {
+        names.push_back(file.GetEntry(i).m_name);
+    }
+    seconds = Measure(_options.m_iterations, [&]()
+    {
+        for (string const& name : names)
+        {
+            found += file.FindEntry(name);
+        }
+    });
+    Report("FindEntry", _entries, seconds, 0, _entries);
+
+    long long pageCount = 0;
+    seconds = Measure(_options.m_iterations, [&]()
+    {
+        CorpusStats stats;
+        stats.Add(file.GetSnapshot());
+        pageCount += stats.GetPageCount();
+    });
+    Report("CorpusStats", _entries, seconds, 0, _entries);
+
+    vector<mst::TextEntry> entries;
+    seconds = Measure(_options.m_iterations, [&]()
+    {
+        file.GetAllEntries(entries);
+    });
+    Report("GetAllEntries", _entries, seconds, 0, _entries);
+
+    // Same random moves every iteration, items are moves
+    unsigned int const moveCount = 10000;
+    mt19937 random(_options.m_corpus.m_seed);
+    uniform_int_distribution<unsigned int> index(0, _entries - 1);
+    vector<pair<unsigned int, unsigned int>> moves(moveCount);
+    for (pair<unsigned int, unsigned int>& move : moves)
+    {
+        move = make_pair(index(random), index(random));
+    }
+
+    mst::Snapshot const unmoved = file.GetSnapshot();
+    seconds = Measure(_options.m_iterations, [&]()
+    {
+        for (pair<unsigned int, unsigned int> const& move : moves)
+        {
+            file.MoveEntry(move.first, move.second);
+        }
+    });
+    Report("MoveEntry", _entries, seconds, 0, moveCount);
+
+    // Entries are shared with the unmoved snapshot, only the order differs
+    seconds = Measure(_options.m_iterations, [&]()
+    {
+        MstDiff diff;
+        diff.Compare(unmoved, file.GetSnapshot());
+        found += diff.GetCount(MstDiff::ChangeType::Moved);
+    });
+    Report("MstDiff", _entries, seconds, 0, _entries);
+
+    // Theirs is the base and shares its entries, this is mostly the matching
+    seconds = Measure(_options.m_iterations, [&]()
+    {
+        MstMerge merge;
+        merge.Merge(unmoved, file.GetSnapshot(), unmoved);
+        found += static_cast<int>(merge.GetConflicts().size());
+    });
+    Report("MstMerge", _entries, seconds, 0, _entries);
+
+    if (!_options.m_keep)
+    {
+        remove(mstFile.c_str());
+        remove(saveFile.c_str());
+        remove(textFile.c_str());
+    }
+
+    // Keep the searches from being optimized away
+    return found != -2;
+}
+
+void PrintUsage()
+{
+    fputs
+    (
+        "Usage: mstBench [options]\n"
+        "\n"
+        "  --entries <n,n,...>  Entry counts of the generated files (1000,10000,100000)\n"
+        "  --pages <min,max>    Pages per entry (1,3)\n"
+        "  --length <n>         Average characters per page (40)\n"
+        "  --tags <d>           Average tags per page (0.5)\n"
+        "  --script <name>      japanese, latin, cyrillic or mixed (japanese)\n"
+        "  --seed <n>           Random seed (1)\n"
+        "  --iterations <n>     Runs per measurement, the best is reported (5)\n"
+        "  --dir <path>         Where generated files are written (current directory)\n"
+        "  --keep               Keep the generated files\n",
+        stdout
+    );
+}
+
+//-----------------------------------------------------
+// Comma separated unsigned numbers
+//-----------------------------------------------------
+bool ParseList
+(
+    char const* _str,
+    vector<unsigned int>& _values
+)
+{
+    _values.clear();
+    stringstream stream(_str);
+    string item;
+    while (getline(stream, item, ','))
+    {
+        char* end = nullptr;
+        unsigned long const value = strtoul(item.c_str(), &end, 10);
+        if (item.empty() || *end != 0) return false;
+        _values.push_back(static_cast<unsigned int>(value));
+    }
+    return !_values.empty();
+}
+
+bool ParseArguments
+(
+    int argc,
+    char* argv[],
+    BenchOptions& _options
+)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string const arg = argv[i];
+        if (arg == "--keep")
+        {
+            _options.m_keep = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) return false;
+        char const* value = argv[++i];
+
+        vector<unsigned int> values;
+        if (arg == "--entries")
+        {
+            if (!ParseList(value, _options.m_sizes)) return false;
+        }
+        else if (arg == "--pages")
+        {
+            if (!ParseList(value, values) || values.size() > 2) return false;
+            _options.m_corpus.m_minPages = values.front();
+            _options.m_corpus.m_maxPages = values.back();
+        }
+        else if (arg == "--length")
+        {
+            _options.m_corpus.m_pageLength = static_cast<unsigned int>(atoi(value));
+        }
+        else if (arg == "--tags")
+        {
+            _options.m_corpus.m_tagDensity = atof(value);
+        }
+        else if (arg == "--script")
+        {
+            if (!CorpusGenerator::GetScript(value, _options.m_corpus.m_script)) return false;
+        }
+        else if (arg == "--seed")
+        {
+            _options.m_corpus.m_seed = static_cast<unsigned int>(atoi(value));
+        }
+        else if (arg == "--iterations")
+        {
+            _options.m_iterations = max(1, atoi(value));
+        }
+        else if (arg == "--dir")
+        {
+            _options.m_dir = value;
+            if (!_options.m_dir.empty() && _options.m_dir.back() != '/' && _options.m_dir.back() != '\\')
+            {
+                _options.m_dir += '/';
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    for (unsigned int size : _options.m_sizes)
+    {
+        if (size == 0) return false;
+    }
+    return _options.m_corpus.m_tagDensity >= 0.0;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    printf("%-16s %9s %12s %12s %14s\n", "Benchmark", "Entries", "Time (ms)", "MB/s", "Entries/s");
+    for (unsigned int size : options.m_sizes)
+    {
+        if (!RunSize(options, size))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
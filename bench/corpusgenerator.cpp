@@ -0,0 +1,230 @@
+#include "corpusgenerator.h"
+
+#include <algorithm>
+#include <cstdio>
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+CorpusGenerator::CorpusGenerator
+(
+    Options const& _options
+)
+    : m_options(_options)
+    , m_random(_options.m_seed)
+{
+    if (m_options.m_maxPages < m_options.m_minPages)
+    {
+        m_options.m_maxPages = m_options.m_minPages;
+    }
+}
+
+//-----------------------------------------------------
+// Fill a snapshot with m_entryCount entries
+//-----------------------------------------------------
+void CorpusGenerator::Generate
+(
+    mst::Snapshot& _snapshot
+)
+{
+    m_random.seed(m_options.m_seed);
+
+    vector<mst::EntryPtr> entries;
+    entries.reserve(m_options.m_entryCount);
+    for (unsigned int i = 0; i < m_options.m_entryCount; i++)
+    {
+        entries.push_back(mst::MakeEntry(GenerateEntry(i)));
+    }
+
+    _snapshot.m_tableName = "msg_bench";
+    _snapshot.m_entries.Assign(entries);
+}
+
+//-----------------------------------------------------
+// Generate and save to a .mst file
+//-----------------------------------------------------
+bool CorpusGenerator::Generate
+(
+    string const& _fileName,
+    string& _errorMsg
+)
+{
+    mst::Snapshot snapshot;
+    Generate(snapshot);
+    return mst::Save(snapshot, _fileName, _errorMsg);
+}
+
+//-----------------------------------------------------
+// japanese, latin, cyrillic or mixed
+//-----------------------------------------------------
+bool CorpusGenerator::GetScript
+(
+    string const& _name,
+    Script& _script
+)
+{
+    static char const* const names[] = {"japanese", "latin", "cyrillic", "mixed"};
+    for (int i = 0; i < 4; i++)
+    {
+        if (_name == names[i])
+        {
+            _script = static_cast<Script>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------
+// One entry, tags are spread over its pages
+//-----------------------------------------------------
+mst::TextEntry CorpusGenerator::GenerateEntry
+(
+    unsigned int _index
+)
+{
+    static char const* const buttons[] = {"button_a", "button_b", "button_x", "button_y", "button_lb", "button_rb", "button_lt", "button_rt", "button_start", "button_back", "button_dpad", "button_lstick", "button_rstick"};
+    static char const* const characters[] = {"sonic", "shadow", "silver", "tails", "knuckles", "amy", "rouge", "omega", "blaze", "elise"};
+
+    Script script = m_options.m_script;
+    if (script == Script::Mixed)
+    {
+        script = static_cast<Script>(GetRandom(0, 2));
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "ev_%04u_%s", _index, characters[GetRandom(0, 9)]);
+
+    mst::TextEntry entry;
+    entry.m_name = name;
+
+    bernoulli_distribution hasTag(m_options.m_tagDensity - static_cast<unsigned int>(m_options.m_tagDensity));
+    unsigned int const pageCount = GetRandom(m_options.m_minPages, m_options.m_maxPages);
+    for (unsigned int page = 0; page < pageCount; page++)
+    {
+        unsigned int const length = GetRandom(m_options.m_pageLength / 2, m_options.m_pageLength * 3 / 2);
+        wstring subtitle = GenerateText(length, script);
+
+        // Long pages are split in two lines
+        if (subtitle.size() > 30)
+        {
+            subtitle[subtitle.size() / 2] = L'\n';
+        }
+
+        // Pick where each tag goes, then insert them in text order
+        vector<pair<unsigned int, string>> tags;
+        unsigned int const textSize = static_cast<unsigned int>(subtitle.size());
+        unsigned int tagCount = static_cast<unsigned int>(m_options.m_tagDensity) + (hasTag(m_random) ? 1 : 0);
+        while (tagCount > 0)
+        {
+            unsigned int const kind = GetRandom(0, 2);
+            if (kind == 2 && tagCount >= 2)
+            {
+                // Colored span, rgba and color around some text
+                unsigned int const start = GetRandom(0, textSize);
+                unsigned int const end = GetRandom(start, textSize);
+                tags.push_back(make_pair(start, "rgba(" + to_string(GetRandom(0, 255)) + "," + to_string(GetRandom(0, 255)) + "," + to_string(GetRandom(0, 255)) + ")"));
+                tags.push_back(make_pair(end, string("color")));
+                tagCount -= 2;
+                continue;
+            }
+
+            if (kind == 0 && page == 0 && entry.m_tags.empty() && tags.empty())
+            {
+                // Voice line at the start of the entry
+                tags.push_back(make_pair(0u, string("sound(") + name + ")"));
+            }
+            else
+            {
+                tags.push_back(make_pair(GetRandom(0, textSize), string("picture(") + buttons[GetRandom(0, 12)] + ")"));
+            }
+            tagCount--;
+        }
+
+        stable_sort(tags.begin(), tags.end(), [](pair<unsigned int, string> const& _a, pair<unsigned int, string> const& _b)
+        {
+            return _a.first < _b.first;
+        });
+
+        for (unsigned int t = 0; t < tags.size(); t++)
+        {
+            // Every $ before this one moved it by one
+            subtitle.insert(tags[t].first + t, 1, L'$');
+            entry.m_tags.push_back(tags[t].second);
+        }
+
+        entry.m_subtitles.push_back(subtitle);
+    }
+
+    return entry;
+}
+
+//-----------------------------------------------------
+// Words of random characters from the script
+//-----------------------------------------------------
+wstring CorpusGenerator::GenerateText
+(
+    unsigned int _length,
+    Script _script
+)
+{
+    wstring text;
+    text.reserve(_length);
+    while (text.size() < _length)
+    {
+        if (!text.empty())
+        {
+            text += (_script == Script::Japanese) ? L'\x3000' : L' ';
+        }
+
+        unsigned int const wordLength = GetRandom(2, 8);
+        for (unsigned int i = 0; i < wordLength && text.size() < _length; i++)
+        {
+            text += GenerateChar(_script);
+        }
+    }
+
+    // End sentences like the game does
+    if (!text.empty())
+    {
+        text.back() = (_script == Script::Japanese) ? L'\x3002' : L'.';
+    }
+    return text;
+}
+
+//-----------------------------------------------------
+// One character of the script
+//-----------------------------------------------------
+wchar_t CorpusGenerator::GenerateChar
+(
+    Script _script
+)
+{
+    switch (_script)
+    {
+    case Script::Japanese:
+    {
+        // Mostly kana with some kanji
+        unsigned int const kind = GetRandom(0, 9);
+        if (kind < 5) return static_cast<wchar_t>(GetRandom(0x3041, 0x3093));
+        if (kind < 8) return static_cast<wchar_t>(GetRandom(0x30A1, 0x30F3));
+        return static_cast<wchar_t>(GetRandom(0x4E00, 0x6FFF));
+    }
+    case Script::Cyrillic:
+        return static_cast<wchar_t>(GetRandom(0xC0, 0xFF));
+    default:
+        return static_cast<wchar_t>(GetRandom(0, 4) ? GetRandom('a', 'z') : GetRandom('A', 'Z'));
+    }
+}
+
+//-----------------------------------------------------
+// Uniform in [_min, _max]
+//-----------------------------------------------------
+unsigned int CorpusGenerator::GetRandom
+(
+    unsigned int _min,
+    unsigned int _max
+)
+{
+    return uniform_int_distribution<unsigned int>(_min, _max)(m_random);
+}
@@ -0,0 +1,61 @@
+//-----------------------------------------------------
+// Name: corpusgenerator.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mst.h"
+
+//-----------------------------------------------------
+// Builds synthetic .mst documents that look like the
+// game's files: ev_ names, pages of one or two lines and
+// sound, button and color tags. The same options and
+// seed always give the same file.
+//-----------------------------------------------------
+class CorpusGenerator
+{
+public:
+    enum Script : int
+    {
+        Japanese,
+        Latin,
+        Cyrillic,   // As russian files store it, remapped to Latin-1
+        Mixed
+    };
+
+    struct Options
+    {
+        Options():m_entryCount(1000),m_minPages(1),m_maxPages(3),m_pageLength(40),m_tagDensity(0.5),m_script(Script::Japanese),m_seed(1){}
+
+        unsigned int m_entryCount;
+        unsigned int m_minPages;
+        unsigned int m_maxPages;
+        unsigned int m_pageLength;  // Average characters per page
+        double m_tagDensity;        // Average tags per page
+        Script m_script;
+        unsigned int m_seed;
+    };
+
+public:
+    CorpusGenerator(Options const& _options);
+
+    void Generate(mst::Snapshot& _snapshot);
+    bool Generate(string const& _fileName, string& _errorMsg);
+
+    static bool GetScript(string const& _name, Script& _script);
+
+private:
+    mst::TextEntry GenerateEntry(unsigned int _index);
+    wstring GenerateText(unsigned int _length, Script _script);
+    wchar_t GenerateChar(Script _script);
+    unsigned int GetRandom(unsigned int _min, unsigned int _max);
+
+private:
+    Options m_options;
+    mt19937 m_random;
+};
@@ -0,0 +1,497 @@
+#include "guibench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <QApplication>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QMessageBox>
+#include <QSettings>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTextStream>
+#include <QThread>
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+DialogCloser::DialogCloser
+(
+    QObject* parent
+)
+    : QObject(parent)
+{
+    // Timers still fire inside a dialog's own event loop
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(CloseDialogs()));
+    m_timer.start(10);
+}
+
+//-----------------------------------------------------
+// Press the default button of the dialog on top
+//-----------------------------------------------------
+void DialogCloser::CloseDialogs()
+{
+    QMessageBox* messageBox = qobject_cast<QMessageBox*>(QApplication::activeModalWidget());
+    if (!messageBox) return;
+
+    fprintf(stderr, "Dialog closed: %s\n", messageBox->text().toLocal8Bit().constData());
+    if (messageBox->defaultButton())
+    {
+        messageBox->defaultButton()->click();
+    }
+    else
+    {
+        messageBox->accept();
+    }
+}
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+GuiBench::GuiBench
+(
+    mstEditor& _editor,
+    CorpusGenerator::Options const& _corpus,
+    QString const& _dir
+)
+    : m_editor(_editor)
+    , m_corpus(_corpus)
+    , m_dir(_dir)
+{
+    // Only the public object names are used, same as a user would see them
+    m_tree = m_editor.findChild<QTreeWidget*>("TW_TreeWidget");
+    m_textEditor = m_editor.findChild<QTextEdit*>("TE_TextEditor");
+    m_russian = m_editor.findChild<QCheckBox*>("CB_Russian");
+    m_apply = m_editor.findChild<QPushButton*>("PB_Save");
+    m_pageNext = m_editor.findChild<QToolButton*>("PB_PageNext");
+    m_pagePrev = m_editor.findChild<QToolButton*>("PB_PagePrev");
+}
+
+//-----------------------------------------------------
+// Run every line of a script
+//-----------------------------------------------------
+bool GuiBench::RunScript
+(
+    QStringList const& _lines,
+    QString& _errorMsg
+)
+{
+    for (int i = 0; i < _lines.size(); i++)
+    {
+        QString const line = _lines[i].trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        int const space = line.indexOf(' ');
+        QString const command = line.left(space);
+        QString const argument = (space == -1) ? QString() : line.mid(space + 1);
+
+        bool ok = true;
+        bool success = true;
+        if (command == "open")
+        {
+            unsigned int const entries = argument.toUInt(&ok);
+            success = ok && entries > 0 && Open(entries, _errorMsg);
+        }
+        else if (command == "select")
+        {
+            int const row = argument.toInt(&ok);
+            success = ok && Select(row, _errorMsg);
+        }
+        else if (command == "type")
+        {
+            Type(argument);
+        }
+        else if (command == "backspace")
+        {
+            int const count = argument.toInt(&ok);
+            success = ok;
+            if (ok) Backspace(count);
+        }
+        else if (command == "page" && (argument == "next" || argument == "prev"))
+        {
+            ChangePage(argument == "next");
+        }
+        else if (command == "apply")
+        {
+            Apply();
+        }
+        else if (command == "russian")
+        {
+            ToggleRussian();
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            _errorMsg = "Line " + QString::number(i + 1) + ": cannot read \"" + line + "\"";
+            return false;
+        }
+        if (!success)
+        {
+            _errorMsg = "Line " + QString::number(i + 1) + ": " + _errorMsg;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------
+// Latency percentiles of every event kind
+//-----------------------------------------------------
+void GuiBench::PrintReport() const
+{
+    printf("%-12s %8s %10s %10s %10s %10s\n", "Event", "Count", "p50 (ms)", "p90 (ms)", "p99 (ms)", "max (ms)");
+    for (auto it = m_latencies.constBegin(); it != m_latencies.constEnd(); ++it)
+    {
+        QVector<double> sorted = it.value();
+        std::sort(sorted.begin(), sorted.end());
+        printf("%-12s %8d %10.3f %10.3f %10.3f %10.3f\n", it.key().toLocal8Bit().constData(), sorted.size(),
+               GetPercentile(sorted, 0.5), GetPercentile(sorted, 0.9), GetPercentile(sorted, 0.99), sorted.back());
+    }
+
+    // The number that is tracked between versions
+    QVector<double> keystrokes = m_latencies.value("keystroke");
+    std::sort(keystrokes.begin(), keystrokes.end());
+    printf("\nkeystroke_p99_ms=%.3f\n", GetPercentile(keystrokes, 0.99));
+    fflush(stdout);
+}
+
+//-----------------------------------------------------
+// Open a generated file, done when every tree item is added
+//-----------------------------------------------------
+bool GuiBench::Open
+(
+    unsigned int _entries,
+    QString& _errorMsg
+)
+{
+    if (!m_files.contains(_entries))
+    {
+        CorpusGenerator::Options corpus = m_corpus;
+        corpus.m_entryCount = _entries;
+
+        QString const fileName = QDir(m_dir).filePath("bench_" + QString::number(_entries) + ".mst");
+        string errorMsg;
+        if (!CorpusGenerator(corpus).Generate(fileName.toStdString(), errorMsg))
+        {
+            _errorMsg = QString::fromStdString(errorMsg);
+            return false;
+        }
+        m_files[_entries] = fileName;
+    }
+
+    // Items of the new document are created before the old ones are deleted,
+    // so a different first item means the tree has been replaced
+    QTreeWidgetItem const* previous = m_tree->topLevelItem(0);
+
+    QElapsedTimer timer;
+    timer.start();
+    m_editor.passArgument(m_files[_entries].toStdString());
+    while (m_tree->topLevelItemCount() != static_cast<int>(_entries) || m_tree->topLevelItem(0) == previous)
+    {
+        if (timer.elapsed() > 300000)
+        {
+            _errorMsg = "Opening " + m_files[_entries] + " timed out";
+            return false;
+        }
+
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        QThread::msleep(1);
+    }
+    WaitIdle();
+    Record("open", timer);
+    return true;
+}
+
+//-----------------------------------------------------
+// Double-click a row to load it in the editor
+//-----------------------------------------------------
+bool GuiBench::Select
+(
+    int _row,
+    QString& _errorMsg
+)
+{
+    QTreeWidgetItem* item = m_tree->topLevelItem(_row);
+    if (!item)
+    {
+        _errorMsg = "No row " + QString::number(_row);
+        return false;
+    }
+
+    // Scrolling is not part of the measurement
+    m_tree->scrollToItem(item);
+    WaitIdle();
+    QPoint const center = m_tree->visualItemRect(item).center();
+
+    QElapsedTimer timer;
+    timer.start();
+    QTest::mouseDClick(m_tree->viewport(), Qt::LeftButton, Qt::NoModifier, center);
+    WaitIdle();
+    Record("select", timer);
+    return true;
+}
+
+//-----------------------------------------------------
+// Each character is its own event, the event carries the text
+// since keyClicks() drops anything outside Latin-1
+//-----------------------------------------------------
+void GuiBench::Type
+(
+    QString const& _text
+)
+{
+    m_textEditor->setFocus();
+    for (int i = 0; i < _text.size(); i++)
+    {
+        // Surrogate pairs are one character
+        int const length = (_text[i].isHighSurrogate() && i + 1 < _text.size()) ? 2 : 1;
+        QString const chr = _text.mid(i, length);
+        i += length - 1;
+
+        QElapsedTimer timer;
+        timer.start();
+        QTest::sendKeyEvent(QTest::Click, m_textEditor, Qt::Key_unknown, chr, Qt::NoModifier);
+        WaitIdle();
+        Record("keystroke", timer);
+    }
+}
+
+//-----------------------------------------------------
+// Backspaces count as keystrokes too
+//-----------------------------------------------------
+void GuiBench::Backspace
+(
+    int _count
+)
+{
+    m_textEditor->setFocus();
+    for (int i = 0; i < _count; i++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QTest::keyClick(m_textEditor, Qt::Key_Backspace);
+        WaitIdle();
+        Record("keystroke", timer);
+    }
+}
+
+//-----------------------------------------------------
+// Previous or next page button
+//-----------------------------------------------------
+void GuiBench::ChangePage
+(
+    bool _next
+)
+{
+    QToolButton* button = _next ? m_pageNext : m_pagePrev;
+    if (!button->isEnabled()) return;
+
+    QElapsedTimer timer;
+    timer.start();
+    QTest::mouseClick(button, Qt::LeftButton);
+    WaitIdle();
+    Record("page", timer);
+}
+
+//-----------------------------------------------------
+// Apply Changes button
+//-----------------------------------------------------
+void GuiBench::Apply()
+{
+    if (!m_apply->isEnabled()) return;
+
+    QElapsedTimer timer;
+    timer.start();
+    QTest::mouseClick(m_apply, Qt::LeftButton);
+    WaitIdle();
+    Record("apply", timer);
+}
+
+//-----------------------------------------------------
+// Russian mode check box
+//-----------------------------------------------------
+void GuiBench::ToggleRussian()
+{
+    QElapsedTimer timer;
+    timer.start();
+    QTest::mouseClick(m_russian, Qt::LeftButton);
+    WaitIdle();
+    Record("russian", timer);
+}
+
+//-----------------------------------------------------
+// Store time since the timer started
+//-----------------------------------------------------
+void GuiBench::Record
+(
+    QString const& _event,
+    QElapsedTimer const& _timer
+)
+{
+    m_latencies[_event].push_back(_timer.nsecsElapsed() / 1000000.0);
+}
+
+//-----------------------------------------------------
+// Handle everything that was posted, including paints
+//-----------------------------------------------------
+void GuiBench::WaitIdle()
+{
+    QCoreApplication::sendPostedEvents();
+    QCoreApplication::processEvents();
+}
+
+//-----------------------------------------------------
+// Nearest rank percentile of sorted values
+//-----------------------------------------------------
+double GuiBench::GetPercentile
+(
+    QVector<double> const& _sorted,
+    double _percentile
+)
+{
+    if (_sorted.isEmpty()) return 0.0;
+
+    int const rank = static_cast<int>(std::ceil(_percentile * _sorted.size()));
+    return _sorted[qBound(0, rank - 1, _sorted.size() - 1)];
+}
+
+namespace
+{
+
+// Used when no script file is given
+char const* const defaultScript =
+    "open 20000\n"
+    "select 10\n"
+    "type The quick brown fox jumps over the lazy dog\n"
+    "backspace 20\n"
+    "apply\n"
+    "select 5000\n"
+    "type \xE3\x81\x93\xE3\x82\x93\xE3\x81\xAB\xE3\x81\xA1\xE3\x81\xAF\xE4\xB8\x96\xE7\x95\x8C\n"
+    "page next\n"
+    "type Second page text\n"
+    "page prev\n"
+    "apply\n"
+    "russian\n"
+    "russian\n";
+
+void PrintUsage()
+{
+    fputs
+    (
+        "Usage: mstGuiBench [options] [script]\n"
+        "\n"
+        "  --repeat <n>     Replay the script n times (10)\n"
+        "  --script <name>  Text of generated files: japanese, latin, cyrillic or mixed (mixed)\n"
+        "  --tags <d>       Average tags per page of generated files (0.5)\n"
+        "  --seed <n>       Random seed of generated files (1)\n"
+        "\n"
+        "Run with QT_QPA_PLATFORM=offscreen on machines without a display.\n",
+        stdout
+    );
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+
+    CorpusGenerator::Options corpus;
+    corpus.m_script = CorpusGenerator::Script::Mixed;
+    int repeat = 10;
+    QString scriptFile;
+
+    QStringList const args = QCoreApplication::arguments();
+    for (int i = 1; i < args.size(); i++)
+    {
+        bool ok = true;
+        if (args[i] == "--repeat" && i + 1 < args.size())
+        {
+            repeat = args[++i].toInt(&ok);
+            ok &= repeat > 0;
+        }
+        else if (args[i] == "--script" && i + 1 < args.size())
+        {
+            ok = CorpusGenerator::GetScript(args[++i].toStdString(), corpus.m_script);
+        }
+        else if (args[i] == "--tags" && i + 1 < args.size())
+        {
+            corpus.m_tagDensity = args[++i].toDouble(&ok);
+        }
+        else if (args[i] == "--seed" && i + 1 < args.size())
+        {
+            corpus.m_seed = args[++i].toUInt(&ok);
+        }
+        else if (!args[i].startsWith("--") && scriptFile.isEmpty())
+        {
+            scriptFile = args[i];
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    QString script = QString::fromUtf8(defaultScript);
+    if (!scriptFile.isEmpty())
+    {
+        QFile file(scriptFile);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            fprintf(stderr, "Unable to open %s\n", scriptFile.toLocal8Bit().constData());
+            return 2;
+        }
+        script = QString::fromUtf8(file.readAll());
+    }
+
+    // Generated files and settings never touch the user's
+    QTemporaryDir dir;
+    if (!dir.isValid())
+    {
+        fprintf(stderr, "Unable to create temporary directory\n");
+        return 1;
+    }
+    // Native settings are the registry on Windows and can't be moved,
+    // the editor uses the default format so this makes it an ini file
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, dir.path());
+
+    mstEditor editor;
+    editor.show();
+    if (!QTest::qWaitForWindowExposed(&editor))
+    {
+        fprintf(stderr, "Window was never shown\n");
+        return 1;
+    }
+
+    DialogCloser dialogCloser;
+    GuiBench bench(editor, corpus, dir.path());
+
+    QStringList const lines = script.split('\n');
+    for (int i = 0; i < repeat; i++)
+    {
+        QString errorMsg;
+        if (!bench.RunScript(lines, errorMsg))
+        {
+            fprintf(stderr, "%s\n", errorMsg.toLocal8Bit().constData());
+            return 1;
+        }
+    }
+
+    bench.PrintReport();
+    return 0;
+}
@@ -0,0 +1,91 @@
+//-----------------------------------------------------
+// Name: guibench.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <QCheckBox>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QObject>
+#include <QPushButton>
+#include <QString>
+#include <QStringList>
+#include <QTextEdit>
+#include <QTimer>
+#include <QToolButton>
+#include <QTreeWidget>
+#include <QVector>
+
+#include "corpusgenerator.h"
+#include "msteditor.h"
+
+//-----------------------------------------------------
+// Answers every message box with its default button so
+// a script never waits on a modal dialog
+//-----------------------------------------------------
+class DialogCloser : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DialogCloser(QObject* parent = nullptr);
+
+private slots:
+    void CloseDialogs();
+
+private:
+    QTimer m_timer;
+};
+
+//-----------------------------------------------------
+// Replays an interaction script on the editor through
+// QTest input events and records how long each event
+// takes until the event queue is empty again, paints
+// included.
+//
+// Script commands, one per line, # for comments:
+//   open <entries>       Open a generated file
+//   select <row>         Double-click a tree row
+//   type <text>          One keystroke per character
+//   backspace <count>    Delete characters before the cursor
+//   page next|prev       Change page
+//   apply                Apply Changes
+//   russian              Toggle russian mode
+//-----------------------------------------------------
+class GuiBench
+{
+public:
+    GuiBench(mstEditor& _editor, CorpusGenerator::Options const& _corpus, QString const& _dir);
+
+    bool RunScript(QStringList const& _lines, QString& _errorMsg);
+    void PrintReport() const;
+
+private:
+    bool Open(unsigned int _entries, QString& _errorMsg);
+    bool Select(int _row, QString& _errorMsg);
+    void Type(QString const& _text);
+    void Backspace(int _count);
+    void ChangePage(bool _next);
+    void Apply();
+    void ToggleRussian();
+
+    void Record(QString const& _event, QElapsedTimer const& _timer);
+    static void WaitIdle();
+    static double GetPercentile(QVector<double> const& _sorted, double _percentile);
+
+private:
+    mstEditor& m_editor;
+    CorpusGenerator::Options m_corpus;
+    QString m_dir;
+
+    QTreeWidget* m_tree;
+    QTextEdit* m_textEditor;
+    QCheckBox* m_russian;
+    QPushButton* m_apply;
+    QToolButton* m_pageNext;
+    QToolButton* m_pagePrev;
+
+    QMap<unsigned int, QString> m_files;      // Generated file for each entry count
+    QMap<QString, QVector<double>> m_latencies; // Milliseconds for each event
+};
@@ -0,0 +1,33 @@
+#include "charmapdelegate.h"
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+CharMapDelegate::CharMapDelegate
+(
+    QMap<QChar, QChar> const& _charMap,
+    QObject* parent
+)
+    : QStyledItemDelegate(parent)
+    , m_charMap(_charMap)
+    , m_enabled(false)
+{
+}
+
+//-----------------------------------------------------
+// Convert the text right before it is painted or measured
+//-----------------------------------------------------
+void CharMapDelegate::initStyleOption
+(
+    QStyleOptionViewItem* option,
+    QModelIndex const& index
+) const
+{
+    QStyledItemDelegate::initStyleOption(option, index);
+    if (!m_enabled) return;
+
+    for (QChar& chr : option->text)
+    {
+        chr = m_charMap.value(chr, chr);
+    }
+}
@@ -0,0 +1,31 @@
+//-----------------------------------------------------
+// Name: charmapdelegate.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <QMap>
+#include <QStyledItemDelegate>
+
+//-----------------------------------------------------
+// Shows item text through a character map, e.g. russian.
+// The items keep the original text, only rows that are
+// painted get converted so switching is instant.
+//-----------------------------------------------------
+class CharMapDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit CharMapDelegate(QMap<QChar, QChar> const& _charMap, QObject* parent = nullptr);
+
+    void SetEnabled(bool _enabled) { m_enabled = _enabled; }
+    bool IsEnabled() const { return m_enabled; }
+
+protected:
+    void initStyleOption(QStyleOptionViewItem* option, QModelIndex const& index) const override;
+
+private:
+    QMap<QChar, QChar> m_charMap;
+    bool m_enabled;
+};
@@ -0,0 +1,676 @@
+#include "commandline.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "markupvalidator.h"
+#include "trace.h"
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+CommandLine::CommandLine
+(
+    Options const& _options
+)
+    : m_options(_options)
+{
+}
+
+//-----------------------------------------------------
+// Whether main() should run this instead of the editor
+//-----------------------------------------------------
+bool CommandLine::IsCommand
+(
+    QString const& _command
+)
+{
+    static QStringList const commands = QStringList() << "validate" << "export" << "import" << "search" << "stats" << "memory" << "repack" << "diff" << "merge" << "help";
+    return commands.contains(_command);
+}
+
+//-----------------------------------------------------
+// Parse arguments, run the command on every file and print results
+//-----------------------------------------------------
+int CommandLine::Run
+(
+    int argc,
+    char* argv[]
+)
+{
+    QStringList args;
+    for (int i = 1; i < argc; i++)
+    {
+        args << QString::fromLocal8Bit(argv[i]);
+    }
+
+    Options options;
+    QString errorMsg;
+    if (!ParseArguments(args, options, errorMsg))
+    {
+        fprintf(stderr, "%s\n\n", errorMsg.toLocal8Bit().constData());
+        PrintUsage();
+        return 2;
+    }
+
+    if (options.m_command == "help")
+    {
+        PrintUsage();
+        return 0;
+    }
+
+    if (options.m_threads > 0)
+    {
+        QThreadPool::globalInstance()->setMaxThreadCount(options.m_threads);
+    }
+
+    if (!options.m_outputDir.isEmpty() && !QDir().mkpath(options.m_outputDir))
+    {
+        fprintf(stderr, "Unable to create directory %s\n", options.m_outputDir.toLocal8Bit().constData());
+        return 2;
+    }
+
+    CommandLine const commandLine(options);
+    QStringList const files = commandLine.CollectFiles();
+    if (files.isEmpty())
+    {
+        fprintf(stderr, "No input files found!\n");
+        return 2;
+    }
+
+    Trace::SetEnabled(!options.m_traceFile.isEmpty());
+    QList<Result> const results = QtConcurrent::blockingMapped(files, commandLine);
+    Trace::SetEnabled(false);
+
+    int failed = 0;
+    for (Result const& result : results)
+    {
+        fputs(result.m_output.toUtf8().constData(), stdout);
+        if (!result.m_errorMsg.isEmpty())
+        {
+            fprintf(stderr, "%s: %s\n", result.m_fileName.toLocal8Bit().constData(), result.m_errorMsg.toLocal8Bit().constData());
+        }
+        failed += !result.m_success;
+    }
+
+    if (options.m_command == "stats")
+    {
+        PrintStats(results);
+    }
+    else if (options.m_command == "diff")
+    {
+        PrintDiffs(results);
+    }
+
+    if (files.size() > 1)
+    {
+        fprintf(stderr, "%d file(s), %d failed\n", files.size(), failed);
+    }
+
+    if (!options.m_traceFile.isEmpty())
+    {
+        string traceError;
+        if (!Trace::WriteChromeTrace(options.m_traceFile.toStdString(), traceError))
+        {
+            fprintf(stderr, "%s: %s\n", options.m_traceFile.toLocal8Bit().constData(), traceError.c_str());
+        }
+    }
+
+    fflush(stdout);
+    return failed ? 1 : 0;
+}
+
+//-----------------------------------------------------
+// Run the command on one file, called from the thread pool
+//-----------------------------------------------------
+CommandLine::Result CommandLine::operator()
+(
+    QString const& _fileName
+) const
+{
+    Result result;
+    result.m_fileName = _fileName;
+
+    if (m_options.m_command == "import")
+    {
+        Import(result);
+        return result;
+    }
+
+    mst file;
+    string errorMsg;
+    if (!file.Load(_fileName.toStdString(), errorMsg))
+    {
+        result.m_errorMsg = QString::fromStdString(errorMsg);
+        return result;
+    }
+
+    if (m_options.m_command == "validate")
+    {
+        Validate(file, result);
+    }
+    else if (m_options.m_command == "export")
+    {
+        Export(file, result);
+    }
+    else if (m_options.m_command == "search")
+    {
+        Search(file, result);
+    }
+    else if (m_options.m_command == "stats")
+    {
+        Stats(file, result);
+    }
+    else if (m_options.m_command == "memory")
+    {
+        Memory(file, result);
+    }
+    else if (m_options.m_command == "repack")
+    {
+        Repack(file, result);
+    }
+    else if (m_options.m_command == "diff")
+    {
+        Diff(file, result);
+    }
+    else if (m_options.m_command == "merge")
+    {
+        Merge(file, result);
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------
+// <command> [options] [search text] <files or directories>
+//-----------------------------------------------------
+bool CommandLine::ParseArguments
+(
+    QStringList const& _args,
+    Options& _options,
+    QString& _errorMsg
+)
+{
+    if (_args.isEmpty() || !IsCommand(_args[0]))
+    {
+        _errorMsg = "Unknown command!";
+        return false;
+    }
+
+    _options.m_command = _args[0];
+    for (int i = 1; i < _args.size(); i++)
+    {
+        QString const& arg = _args[i];
+        if (arg == "-o" || arg == "-j" || arg == "--trace")
+        {
+            if (i + 1 >= _args.size())
+            {
+                _errorMsg = arg + " needs a value!";
+                return false;
+            }
+
+            if (arg == "-o")
+            {
+                _options.m_outputDir = _args[++i];
+                continue;
+            }
+
+            if (arg == "--trace")
+            {
+                _options.m_traceFile = _args[++i];
+                continue;
+            }
+
+            bool ok = false;
+            _options.m_threads = _args[++i].toInt(&ok);
+            if (!ok || _options.m_threads < 1)
+            {
+                _errorMsg = "-j needs a positive number!";
+                return false;
+            }
+        }
+        else if (arg == "--russian")
+        {
+            _options.m_russian = true;
+        }
+        else if (_options.m_command == "search" && _options.m_searchText.isNull())
+        {
+            _options.m_searchText = arg;
+        }
+        else
+        {
+            _options.m_inputs << arg;
+        }
+    }
+
+    if (_options.m_command == "help") return true;
+
+    if (_options.m_command == "search" && _options.m_searchText.isEmpty())
+    {
+        _errorMsg = "Nothing to search for!";
+        return false;
+    }
+
+    if (_options.m_inputs.isEmpty())
+    {
+        _errorMsg = "No input files!";
+        return false;
+    }
+
+    if (_options.m_command == "diff" && _options.m_inputs.size() != 2)
+    {
+        _errorMsg = "diff needs an old and a new file or directory!";
+        return false;
+    }
+
+    if (_options.m_command == "merge" && _options.m_inputs.size() != 3)
+    {
+        _errorMsg = "merge needs a base, ours and theirs file or directory!";
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------
+// Print how to use the command line
+//-----------------------------------------------------
+void CommandLine::PrintUsage()
+{
+    fputs
+    (
+        "Usage: mstEditor <command> [options] <files or directories>\n"
+        "\n"
+        "Commands:\n"
+        "  validate             Check every entry for broken tags\n"
+        "  export               Write each .mst as .txt\n"
+        "  import               Write each exported .txt back as .mst\n"
+        "  search <text>        List entries with text in name, tags or subtitles\n"
+        "  stats                Entry, page, tag, button and duplicate counts as JSON\n"
+        "  memory               Report memory used by each loaded file\n"
+        "  repack               Load and save each .mst again\n"
+        "  diff <old> <new>     Added, removed, moved and changed entries as JSON,\n"
+        "                       directories compare the files of the same name\n"
+        "  merge <base> <ours> <theirs>\n"
+        "                       Three-way merge written over ours (or to -o),\n"
+        "                       conflicts keep ours and are listed\n"
+        "  help                 Show this message\n"
+        "\n"
+        "Options:\n"
+        "  -o <dir>             Write output files to dir instead of next to the input\n"
+        "  -j <threads>         Number of files handled at the same time\n"
+        "  --russian            Export and import subtitles in russian encoding\n"
+        "  --trace <file>       Write timing spans as a Chrome trace (chrome://tracing)\n"
+        "\n"
+        "Directories are searched for .mst files, or .txt files for import.\n",
+        stdout
+    );
+}
+
+//-----------------------------------------------------
+// Every loaded file then the totals, as one JSON object
+//-----------------------------------------------------
+void CommandLine::PrintStats
+(
+    QList<Result> const& _results
+)
+{
+    CorpusStats total;
+    string json = "{\n  \"files\": [";
+    bool first = true;
+    for (Result const& result : _results)
+    {
+        if (!result.m_success) continue;
+
+        json += first ? "\n" : ",\n";
+        json += "    {\"file\": \"" + CorpusStats::EscapeJson(result.m_fileName.toStdWString()) + "\", \"stats\": " + result.m_stats.ToJson("    ") + "}";
+        total.Merge(result.m_stats);
+        first = false;
+    }
+    json += first ? "],\n" : "\n  ],\n";
+    json += "  \"total\": " + total.ToJson("  ") + "\n}\n";
+
+    fputs(json.c_str(), stdout);
+}
+
+//-----------------------------------------------------
+// Every file compared by diff, then the totals of each change
+//-----------------------------------------------------
+void CommandLine::PrintDiffs
+(
+    QList<Result> const& _results
+)
+{
+    int counts[static_cast<int>(MstDiff::ChangeType::Count)] = {};
+    string json = "{\n  \"files\": [";
+    bool first = true;
+    for (Result const& result : _results)
+    {
+        if (!result.m_success) continue;
+
+        json += first ? "\n" : ",\n";
+        json += "    {\"old\": \"" + CorpusStats::EscapeJson(result.m_oldFileName.toStdWString()) + "\"";
+        json += ", \"new\": \"" + CorpusStats::EscapeJson(result.m_fileName.toStdWString()) + "\"";
+        json += ", \"diff\": " + result.m_diff.ToJson("    ") + "}";
+        for (int i = 0; i < static_cast<int>(MstDiff::ChangeType::Count); i++)
+        {
+            counts[i] += result.m_diff.GetCount(static_cast<MstDiff::ChangeType>(i));
+        }
+        first = false;
+    }
+    json += first ? "],\n" : "\n  ],\n";
+
+    json += "  \"total\": {";
+    for (int i = 0; i < static_cast<int>(MstDiff::ChangeType::Count); i++)
+    {
+        json += string(i ? ", " : "") + "\"" + MstDiff::ToString(static_cast<MstDiff::ChangeType>(i)) + "\": " + to_string(counts[i]);
+    }
+    json += "}\n}\n";
+
+    fputs(json.c_str(), stdout);
+}
+
+//-----------------------------------------------------
+// Expand directories to the files directly inside them
+//-----------------------------------------------------
+QStringList CommandLine::CollectFiles() const
+{
+    QString const filter = (m_options.m_command == "import") ? "*.txt" : "*.mst";
+
+    // diff and merge run on the new or our files, GetPairedFile finds the others
+    QStringList inputs = m_options.m_inputs;
+    if (m_options.m_command == "diff" || m_options.m_command == "merge")
+    {
+        inputs = QStringList() << inputs[1];
+    }
+
+    QStringList files;
+    for (QString const& input : inputs)
+    {
+        QFileInfo const info(input);
+        if (!info.isDir())
+        {
+            files << input;
+            continue;
+        }
+
+        QDir const dir(input);
+        for (QString const& fileName : dir.entryList(QStringList() << filter, QDir::Files, QDir::Name))
+        {
+            files << dir.filePath(fileName);
+        }
+    }
+    return files;
+}
+
+//-----------------------------------------------------
+// Same name with a different extension, in the output directory
+//-----------------------------------------------------
+QString CommandLine::GetOutputFile
+(
+    QString const& _fileName,
+    QString const& _suffix
+) const
+{
+    QFileInfo const info(_fileName);
+    QString const dir = m_options.m_outputDir.isEmpty() ? info.path() : m_options.m_outputDir;
+    return QDir(dir).filePath(info.completeBaseName() + _suffix);
+}
+
+//-----------------------------------------------------
+// Other version of a file for diff and merge, the file of
+// the same name if that input is a directory
+//-----------------------------------------------------
+QString CommandLine::GetPairedFile
+(
+    int _input,
+    QString const& _fileName
+) const
+{
+    QString const& input = m_options.m_inputs[_input];
+    if (!QFileInfo(input).isDir()) return input;
+
+    return QDir(input).filePath(QFileInfo(_fileName).fileName());
+}
+
+//-----------------------------------------------------
+// Tag and $ problems the editor would complain about
+//-----------------------------------------------------
+void CommandLine::Validate
+(
+    mst& _file,
+    Result& _result
+) const
+{
+    vector<mst::EntryPtr> entries;
+    _file.GetSnapshot().m_entries.ToVector(entries);
+
+    MarkupValidator::Report report;
+    MarkupValidator().Validate(entries, report);
+
+    for (MarkupValidator::Issue const& issue : report.m_issues)
+    {
+        if (!MarkupValidator::IsError(issue.m_type)) continue;
+        _result.m_output += QString("%1: entry %2 %3\n").arg(_result.m_fileName).arg(issue.m_entry).arg(MarkupValidator::ToString(issue));
+    }
+
+    _result.m_output += QString("%1: %2 entries, %3 issues, %4 hardcoded\n").arg(_result.m_fileName).arg(report.m_entryCount).arg(report.m_errorCount).arg(report.m_hardcodedCount);
+    _result.m_success = (report.m_errorCount == 0);
+}
+
+//-----------------------------------------------------
+// Export as .txt, same as File > Export
+//-----------------------------------------------------
+void CommandLine::Export
+(
+    mst& _file,
+    Result& _result
+) const
+{
+    QString const textFile = GetOutputFile(_result.m_fileName, ".txt");
+
+    string errorMsg;
+    if (!_file.Export(textFile.toStdString(), errorMsg, m_options.m_russian))
+    {
+        _result.m_errorMsg = QString::fromStdString(errorMsg);
+        return;
+    }
+
+    _result.m_output = _result.m_fileName + " -> " + textFile + "\n";
+    _result.m_success = true;
+}
+
+//-----------------------------------------------------
+// Turn an exported .txt back into .mst
+//-----------------------------------------------------
+void CommandLine::Import
+(
+    Result& _result
+) const
+{
+    mst file;
+    string errorMsg;
+    if (!file.Import(_result.m_fileName.toStdString(), errorMsg, m_options.m_russian))
+    {
+        _result.m_errorMsg = QString::fromStdString(errorMsg);
+        return;
+    }
+
+    QString const mstFile = GetOutputFile(_result.m_fileName, ".mst");
+    if (!file.Save(mstFile.toStdString(), errorMsg))
+    {
+        _result.m_errorMsg = QString::fromStdString(errorMsg);
+        return;
+    }
+
+    _result.m_output = _result.m_fileName + " -> " + mstFile + "\n";
+    _result.m_success = true;
+}
+
+//-----------------------------------------------------
+// Print file:index:name of every entry containing the text
+//-----------------------------------------------------
+void CommandLine::Search
+(
+    mst& _file,
+    Result& _result
+) const
+{
+    // Subtitles are UTF-16 code units, one per wchar_t
+    string const str = m_options.m_searchText.toStdString();
+    wstring wstr;
+    for (QChar const& chr : m_options.m_searchText)
+    {
+        wstr += static_cast<wchar_t>(chr.unicode());
+    }
+
+    set<int> found;
+    for (int index = _file.Search(str); index >= 0; index = _file.Search(str, index + 1))
+    {
+        found.insert(index);
+    }
+    for (int index = _file.Search(wstr); index >= 0; index = _file.Search(wstr, index + 1))
+    {
+        found.insert(index);
+    }
+
+    for (int index : found)
+    {
+        string const name = _file.GetEntry(static_cast<unsigned int>(index)).m_name;
+        _result.m_output += QString("%1:%2:%3\n").arg(_result.m_fileName).arg(index).arg(QString::fromStdString(name));
+    }
+    _result.m_success = true;
+}
+
+//-----------------------------------------------------
+// Counts of one file, printed with the others by PrintStats
+//-----------------------------------------------------
+void CommandLine::Stats
+(
+    mst& _file,
+    Result& _result
+) const
+{
+    _result.m_stats.Add(_file.GetSnapshot());
+    _result.m_success = true;
+}
+
+//-----------------------------------------------------
+// Memory one loaded file takes, allocator totals are for this file only
+// when files are not handled at the same time (-j 1)
+//-----------------------------------------------------
+void CommandLine::Memory
+(
+    mst& _file,
+    Result& _result
+) const
+{
+    MemoryUsage usage;
+    _file.GetMemoryUsage(usage);
+
+    _result.m_output = _result.m_fileName + ":\n";
+    for (QString const& line : QString::fromStdString(usage.ToString()).split('\n'))
+    {
+        if (line.isEmpty()) continue;
+        _result.m_output += "  " + line + "\n";
+    }
+    _result.m_success = true;
+}
+
+//-----------------------------------------------------
+// Load and save again, rewrites the file in a clean layout
+//-----------------------------------------------------
+void CommandLine::Repack
+(
+    mst& _file,
+    Result& _result
+) const
+{
+    QString const mstFile = GetOutputFile(_result.m_fileName, ".mst");
+
+    string errorMsg;
+    if (!_file.Save(mstFile.toStdString(), errorMsg))
+    {
+        _result.m_errorMsg = QString::fromStdString(errorMsg);
+        return;
+    }
+
+    _result.m_output = _result.m_fileName + " -> " + mstFile + "\n";
+    _result.m_success = true;
+}
+
+//-----------------------------------------------------
+// Compare with the old version, printed with the others by PrintDiffs
+//-----------------------------------------------------
+void CommandLine::Diff
+(
+    mst& _file,
+    Result& _result
+) const
+{
+    _result.m_oldFileName = GetPairedFile(0, _result.m_fileName);
+
+    mst oldFile;
+    string errorMsg;
+    if (!oldFile.Load(_result.m_oldFileName.toStdString(), errorMsg))
+    {
+        _result.m_errorMsg = _result.m_oldFileName + ": " + QString::fromStdString(errorMsg);
+        return;
+    }
+
+    _result.m_diff.Compare(oldFile.GetSnapshot(), _file.GetSnapshot());
+    _result.m_success = true;
+}
+
+//-----------------------------------------------------
+// Merge theirs into ours against the base, like the editor's File > Merge
+//-----------------------------------------------------
+void CommandLine::Merge
+(
+    mst& _file,
+    Result& _result
+) const
+{
+    QString const baseFileName = GetPairedFile(0, _result.m_fileName);
+    QString const theirsFileName = GetPairedFile(2, _result.m_fileName);
+
+    mst base;
+    mst theirs;
+    string errorMsg;
+    if (!base.Load(baseFileName.toStdString(), errorMsg))
+    {
+        _result.m_errorMsg = baseFileName + ": " + QString::fromStdString(errorMsg);
+        return;
+    }
+    if (!theirs.Load(theirsFileName.toStdString(), errorMsg))
+    {
+        _result.m_errorMsg = theirsFileName + ": " + QString::fromStdString(errorMsg);
+        return;
+    }
+
+    MstMerge merge;
+    merge.Merge(base.GetSnapshot(), _file.GetSnapshot(), theirs.GetSnapshot());
+    _file.SetEntries(merge.GetEntries());
+
+    QString const mstFile = GetOutputFile(_result.m_fileName, ".mst");
+    if (!_file.Save(mstFile.toStdString(), errorMsg))
+    {
+        _result.m_errorMsg = QString::fromStdString(errorMsg);
+        return;
+    }
+
+    for (MstMerge::Conflict const& conflict : merge.GetConflicts())
+    {
+        _result.m_output += QString("%1: conflict %2\n").arg(mstFile).arg(QString::fromStdString(MstMerge::ToString(conflict)));
+    }
+
+    QString summary = "%1 -> %2: %3 from theirs, %4 combined, %5 removed, %6 conflicts\n";
+    _result.m_output += summary.arg(_result.m_fileName).arg(mstFile).arg(merge.GetTheirsCount()).arg(merge.GetCombinedCount()).arg(merge.GetRemovedCount()).arg(static_cast<int>(merge.GetConflicts().size()));
+    _result.m_success = merge.GetConflicts().empty();
+}
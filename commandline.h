@@ -0,0 +1,82 @@
+//-----------------------------------------------------
+// Name: commandline.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <QString>
+#include <QStringList>
+
+#include "corpusstats.h"
+#include "mst.h"
+#include "mstdiff.h"
+#include "mstmerge.h"
+
+//-----------------------------------------------------
+// Batch commands run without any window, only QtCore is
+// used so it works on machines with no display. Every
+// input file is handled on the thread pool, the output is
+// printed in input order once they are all done.
+//-----------------------------------------------------
+class CommandLine
+{
+public:
+    struct Options
+    {
+        Options():m_russian(false),m_threads(0){}
+
+        QString m_command;
+        QStringList m_inputs;     // Files or directories
+        QString m_outputDir;      // Empty to write next to the input
+        QString m_searchText;
+        QString m_traceFile;      // Chrome trace of the run, empty for none
+        bool m_russian;
+        int m_threads;            // 0 for one per core
+    };
+
+    struct Result
+    {
+        Result():m_success(false){}
+
+        QString m_fileName;
+        QString m_output;         // Printed to stdout
+        QString m_errorMsg;       // Printed to stderr
+        CorpusStats m_stats;      // Merged and printed as JSON by stats
+        QString m_oldFileName;    // diff only, the file it was compared with
+        MstDiff m_diff;           // Printed as JSON by diff
+        bool m_success;
+    };
+    typedef Result result_type;
+
+public:
+    CommandLine(Options const& _options);
+
+    static bool IsCommand(QString const& _command);
+    static int Run(int argc, char* argv[]);
+
+    Result operator()(QString const& _fileName) const;
+
+private:
+    static bool ParseArguments(QStringList const& _args, Options& _options, QString& _errorMsg);
+    static void PrintUsage();
+    static void PrintStats(QList<Result> const& _results);
+    static void PrintDiffs(QList<Result> const& _results);
+    QStringList CollectFiles() const;
+    QString GetPairedFile(int _input, QString const& _fileName) const;
+    QString GetOutputFile(QString const& _fileName, QString const& _suffix) const;
+
+    // Subcommands, _file is already loaded except for import
+    void Validate(mst& _file, Result& _result) const;
+    void Export(mst& _file, Result& _result) const;
+    void Import(Result& _result) const;
+    void Search(mst& _file, Result& _result) const;
+    void Stats(mst& _file, Result& _result) const;
+    void Memory(mst& _file, Result& _result) const;
+    void Repack(mst& _file, Result& _result) const;
+    void Diff(mst& _file, Result& _result) const;
+    void Merge(mst& _file, Result& _result) const;
+
+private:
+    Options m_options;
+};
@@ -0,0 +1,344 @@
+//-----------------------------------------------------
+// Name: corpusstats.cpp
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#include "corpusstats.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+CorpusStats::CorpusStats()
+    : m_entryCount(0)
+    , m_pageCount(0)
+    , m_characterCount(0)
+    , m_emptyPageCount(0)
+    , m_untaggedCount(0)
+    , m_maxPageLength(0)
+{
+    fill(begin(m_tagCounts), end(m_tagCounts), 0);
+}
+
+//-----------------------------------------------------
+// Count every entry of a file
+//-----------------------------------------------------
+void CorpusStats::Add
+(
+    mst::Snapshot const& _snapshot
+)
+{
+    TRACE_SCOPE("CorpusStats::Add");
+
+    m_pages.reserve(m_pages.size() + _snapshot.m_entries.Size());
+    _snapshot.m_entries.ForEach(0, [this](unsigned int, mst::EntryPtr const& _entry) -> bool
+    {
+        Add(*_entry);
+        return true;
+    });
+}
+
+//-----------------------------------------------------
+// Count one entry, its pages and its tags
+//-----------------------------------------------------
+void CorpusStats::Add
+(
+    mst::TextEntry const& _entry
+)
+{
+    m_entryCount++;
+
+    long long tagMarkers = 0;
+    for (wstring const& subtitle : _entry.m_subtitles)
+    {
+        long long const length = GetTextLength(subtitle);
+        m_pageCount++;
+        m_characterCount += length;
+        m_emptyPageCount += subtitle.empty();
+        tagMarkers += count(subtitle.begin(), subtitle.end(), L'$');
+
+        if (length > m_maxPageLength)
+        {
+            m_maxPageLength = length;
+            m_maxPageEntry = _entry.m_name;
+        }
+
+        if (!subtitle.empty())
+        {
+            m_pages[subtitle]++;
+        }
+    }
+    m_untaggedCount += (_entry.m_tags.empty() && tagMarkers > 0);
+
+    string argument;
+    for (string const& tag : _entry.m_tags)
+    {
+        TagKind const kind = GetTagKind(tag, argument);
+        m_tagCounts[static_cast<int>(kind)]++;
+
+        if (kind == TagKind::Picture && argument.compare(0, 7, "button_") == 0)
+        {
+            m_buttons[argument]++;
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Add the counts of another file
+//-----------------------------------------------------
+void CorpusStats::Merge
+(
+    CorpusStats const& _other
+)
+{
+    m_entryCount += _other.m_entryCount;
+    m_pageCount += _other.m_pageCount;
+    m_characterCount += _other.m_characterCount;
+    m_emptyPageCount += _other.m_emptyPageCount;
+    m_untaggedCount += _other.m_untaggedCount;
+    for (int i = 0; i < static_cast<int>(TagKind::Count); i++)
+    {
+        m_tagCounts[i] += _other.m_tagCounts[i];
+    }
+
+    if (_other.m_maxPageLength > m_maxPageLength)
+    {
+        m_maxPageLength = _other.m_maxPageLength;
+        m_maxPageEntry = _other.m_maxPageEntry;
+    }
+
+    for (auto const& button : _other.m_buttons)
+    {
+        m_buttons[button.first] += button.second;
+    }
+
+    m_pages.reserve(m_pages.size() + _other.m_pages.size());
+    for (auto const& page : _other.m_pages)
+    {
+        m_pages[page.first] += page.second;
+    }
+}
+
+//-----------------------------------------------------
+// Distinct pages that appear more than once
+//-----------------------------------------------------
+long long CorpusStats::GetDuplicatePageCount() const
+{
+    long long duplicates = 0;
+    for (auto const& page : m_pages)
+    {
+        duplicates += (page.second > 1);
+    }
+    return duplicates;
+}
+
+//-----------------------------------------------------
+// Copies after the first of every page
+//-----------------------------------------------------
+long long CorpusStats::GetDuplicateCopyCount() const
+{
+    long long copies = 0;
+    for (auto const& page : m_pages)
+    {
+        copies += page.second - 1;
+    }
+    return copies;
+}
+
+//-----------------------------------------------------
+// Characters that would not need translating again
+//-----------------------------------------------------
+long long CorpusStats::GetDuplicateCharacterCount() const
+{
+    long long characters = 0;
+    for (auto const& page : m_pages)
+    {
+        characters += (page.second - 1) * GetTextLength(page.first);
+    }
+    return characters;
+}
+
+//-----------------------------------------------------
+// All counts as one JSON object
+//-----------------------------------------------------
+string CorpusStats::ToJson
+(
+    string const& _indent,
+    unsigned int _topDuplicates
+) const
+{
+    static char const* const tagNames[] = {"sound", "picture", "rgba", "color", "other"};
+
+    string const inner = _indent + "  ";
+    string json = "{\n";
+    json += inner + "\"entries\": " + to_string(m_entryCount) + ",\n";
+    json += inner + "\"pages\": " + to_string(m_pageCount) + ",\n";
+    json += inner + "\"empty_pages\": " + to_string(m_emptyPageCount) + ",\n";
+    json += inner + "\"characters\": " + to_string(m_characterCount) + ",\n";
+
+    char average[32];
+    snprintf(average, sizeof(average), "%.2f", GetAveragePageLength());
+    json += inner + "\"average_page_length\": " + average + ",\n";
+    json += inner + "\"max_page_length\": " + to_string(m_maxPageLength) + ",\n";
+    json += inner + "\"max_page_entry\": \"" + EscapeJson(m_maxPageEntry) + "\",\n";
+    json += inner + "\"hardcoded_entries\": " + to_string(m_untaggedCount) + ",\n";
+
+    json += inner + "\"tags\": {";
+    for (int i = 0; i < static_cast<int>(TagKind::Count); i++)
+    {
+        json += string(i ? ", " : "") + "\"" + tagNames[i] + "\": " + to_string(m_tagCounts[i]);
+    }
+    json += "},\n";
+
+    json += inner + "\"buttons\": {";
+    for (auto iter = m_buttons.begin(); iter != m_buttons.end(); iter++)
+    {
+        json += string(iter != m_buttons.begin() ? ", " : "") + "\"" + EscapeJson(iter->first) + "\": " + to_string(iter->second);
+    }
+    json += "},\n";
+
+    json += inner + "\"duplicate_pages\": " + to_string(GetDuplicatePageCount()) + ",\n";
+    json += inner + "\"duplicate_copies\": " + to_string(GetDuplicateCopyCount()) + ",\n";
+    json += inner + "\"duplicate_characters\": " + to_string(GetDuplicateCharacterCount()) + ",\n";
+
+    // Most repeated first, ties by text so the output is stable
+    vector<pair<wstring const*, long long>> top;
+    for (auto const& page : m_pages)
+    {
+        if (page.second > 1) top.push_back(make_pair(&page.first, page.second));
+    }
+    unsigned int const topCount = min(_topDuplicates, static_cast<unsigned int>(top.size()));
+    partial_sort(top.begin(), top.begin() + topCount, top.end(), [](pair<wstring const*, long long> const& _a, pair<wstring const*, long long> const& _b)
+    {
+        return _a.second != _b.second ? _a.second > _b.second : *_a.first < *_b.first;
+    });
+
+    json += inner + "\"top_duplicates\": [";
+    for (unsigned int i = 0; i < topCount; i++)
+    {
+        json += string(i ? "," : "") + "\n" + inner + "  {\"count\": " + to_string(top[i].second) + ", \"text\": \"" + EscapeJson(*top[i].first) + "\"}";
+    }
+    json += topCount ? "\n" + inner + "]\n" : "]\n";
+
+    json += _indent + "}";
+    return json;
+}
+
+//-----------------------------------------------------
+// Names and tags are Shift-JIS bytes, each byte past ASCII
+// is written as its own \u00XX so the output stays UTF-8
+//-----------------------------------------------------
+string CorpusStats::EscapeJson
+(
+    string const& _str
+)
+{
+    string escaped;
+    escaped.reserve(_str.size());
+    for (char const c : _str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20 || static_cast<unsigned char>(c) >= 0x80)
+        {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned char>(c));
+            escaped += buffer;
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+//-----------------------------------------------------
+// Subtitles are UTF-16 code units, anything past ASCII is
+// written as \uXXXX which is exactly what JSON expects,
+// code points past 0xFFFF as their surrogate pair
+//-----------------------------------------------------
+string CorpusStats::EscapeJson
+(
+    wstring const& _str
+)
+{
+    string escaped;
+    escaped.reserve(_str.size());
+    for (wchar_t const c : _str)
+    {
+        if (c == L'"' || c == L'\\')
+        {
+            escaped += '\\';
+            escaped += static_cast<char>(c);
+        }
+        else if (c == L'\n')
+        {
+            escaped += "\\n";
+        }
+        else if (static_cast<unsigned int>(c) > 0xFFFF)
+        {
+            unsigned int const code = static_cast<unsigned int>(c) - 0x10000;
+            char buffer[16];
+            snprintf(buffer, sizeof(buffer), "\\u%04x\\u%04x", 0xD800 + (code >> 10), 0xDC00 + (code & 0x3FF));
+            escaped += buffer;
+        }
+        else if (c < 0x20 || c >= 0x80)
+        {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned int>(c));
+            escaped += buffer;
+        }
+        else
+        {
+            escaped += static_cast<char>(c);
+        }
+    }
+    return escaped;
+}
+
+//-----------------------------------------------------
+// Characters shown in the text box, $ and new lines are not
+//-----------------------------------------------------
+long long CorpusStats::GetTextLength
+(
+    wstring const& _subtitle
+)
+{
+    long long length = 0;
+    for (wchar_t const c : _subtitle)
+    {
+        length += (c != L'$' && c != L'\n' && c != L'\r');
+    }
+    return length;
+}
+
+//-----------------------------------------------------
+// Kind of tag, and what is inside the brackets
+//-----------------------------------------------------
+CorpusStats::TagKind CorpusStats::GetTagKind
+(
+    string const& _tag,
+    string& _argument
+)
+{
+    _argument.clear();
+    if (_tag == "color") return TagKind::Color;
+
+    size_t const start = _tag.find('(');
+    if (start == string::npos || _tag.back() != ')') return TagKind::Other;
+
+    _argument = _tag.substr(start + 1, _tag.size() - start - 2);
+    if (_tag.compare(0, start, "sound") == 0) return TagKind::Sound;
+    if (_tag.compare(0, start, "picture") == 0) return TagKind::Picture;
+    if (_tag.compare(0, start, "rgba") == 0) return TagKind::RGBA;
+    return TagKind::Other;
+}
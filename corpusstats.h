@@ -0,0 +1,78 @@
+//-----------------------------------------------------
+// Name: corpusstats.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "mst.h"
+
+using namespace std;
+
+//-----------------------------------------------------
+// Counts gathered in one pass over the entries of a file.
+// Each file is counted on its own, possibly on another
+// thread, then merged into the totals. Duplicates are
+// whole pages with the exact same text, anywhere in the
+// files that were merged. Characters are the ones shown,
+// $ and new lines are not counted.
+//-----------------------------------------------------
+class CorpusStats
+{
+public:
+    enum class TagKind : int
+    {
+        Sound,
+        Picture,
+        RGBA,
+        Color,
+        Other,
+        Count
+    };
+
+public:
+    CorpusStats();
+
+    void Add(mst::Snapshot const& _snapshot);
+    void Add(mst::TextEntry const& _entry);
+    void Merge(CorpusStats const& _other);
+
+    long long GetEntryCount() const { return m_entryCount; }
+    long long GetPageCount() const { return m_pageCount; }
+    long long GetCharacterCount() const { return m_characterCount; }
+    long long GetTagCount(TagKind _kind) const { return m_tagCounts[static_cast<int>(_kind)]; }
+    double GetAveragePageLength() const { return m_pageCount ? double(m_characterCount) / m_pageCount : 0.0; }
+    long long GetMaxPageLength() const { return m_maxPageLength; }
+
+    // Pages seen more than once, how many extra copies and their characters
+    long long GetDuplicatePageCount() const;
+    long long GetDuplicateCopyCount() const;
+    long long GetDuplicateCharacterCount() const;
+
+    // _indent is prepended to every line after the first
+    string ToJson(string const& _indent = "", unsigned int _topDuplicates = 20) const;
+    static string EscapeJson(string const& _str);
+    static string EscapeJson(wstring const& _str);
+
+private:
+    static long long GetTextLength(wstring const& _subtitle);
+    static TagKind GetTagKind(string const& _tag, string& _argument);
+
+private:
+    long long m_entryCount;
+    long long m_pageCount;
+    long long m_characterCount;
+    long long m_emptyPageCount;
+    long long m_untaggedCount;      // Entries with $ but no tags, hardcoded text
+    long long m_tagCounts[static_cast<int>(TagKind::Count)];
+
+    long long m_maxPageLength;
+    string m_maxPageEntry;
+
+    map<string, long long> m_buttons;   // picture(button_*) argument to count
+    unordered_map<wstring, long long> m_pages;
+};
@@ -0,0 +1,414 @@
+//-----------------------------------------------------
+// Name: entrystore.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "persistentlist.h"
+
+using namespace std;
+
+//-----------------------------------------------------
+// Ordered entries with stable handles.
+// Each entry gets a handle that never changes while it
+// exists, no matter where it is moved to. Order is kept by
+// sparse labels so finding the index of a handle, insert,
+// erase and move are all O(log n). Copies are O(1) and
+// share nodes with the original.
+//-----------------------------------------------------
+template <class T>
+class EntryStore
+{
+public:
+    typedef unsigned int Handle;
+    static const Handle InvalidHandle = 0;
+
+public:
+    EntryStore() : m_nextHandle(1) {}
+
+    unsigned int Size() const { return m_order.Size(); }
+    bool Empty() const { return m_order.Empty(); }
+    void Clear() { m_order.Clear(); m_handles.Clear(); }
+
+    // Access
+    T const& At(unsigned int _index) const { return m_order.At(_index).m_value; }
+    Handle GetHandle(unsigned int _index) const;
+    int GetIndex(Handle _handle) const;
+    void ToVector(vector<T>& _values) const;
+    template <class F> bool ForEach(unsigned int _start, F _func) const;
+    template <class F> bool ForEachHandle(F _func) const;
+    size_t GetNodeBytes() const { return Size() * (PersistentList<Slot>::GetNodeBytes() + PersistentList<HandleSlot>::GetNodeBytes()); }
+
+    // Modifiers
+    void Assign(vector<T> const& _values);
+    void Set(unsigned int _index, T const& _value);
+    Handle Insert(unsigned int _index, T const& _value);
+    Handle PushBack(T const& _value) { return Insert(Size(), _value); }
+    void Erase(unsigned int _index);
+    void Move(unsigned int _from, unsigned int _to);
+    bool Move(vector<unsigned int> const& _from, vector<unsigned int> const& _to);
+
+    // Go back to an older copy, handles are never handed out twice
+    void Restore(EntryStore const& _other);
+
+private:
+    typedef unsigned long long Label;
+    static const Label LabelGap = 1ull << 32;
+
+    // Sorted by label, this is the document order
+    struct Slot
+    {
+        Label m_label;
+        Handle m_handle;
+        T m_value;
+    };
+
+    // Sorted by handle, where to find it in m_order
+    struct HandleSlot
+    {
+        Handle m_handle;
+        Label m_label;
+    };
+
+    unsigned int FindHandle(Handle _handle) const;
+    Label GetInsertLabel(unsigned int _index);
+    void Relabel();
+
+private:
+    PersistentList<Slot> m_order;
+    PersistentList<HandleSlot> m_handles;
+    Handle m_nextHandle;
+};
+
+//-----------------------------------------------------
+// Handle of entry at index
+//-----------------------------------------------------
+template <class T>
+typename EntryStore<T>::Handle EntryStore<T>::GetHandle
+(
+    unsigned int _index
+) const
+{
+    if (_index >= Size()) return InvalidHandle;
+    return m_order.At(_index).m_handle;
+}
+
+//-----------------------------------------------------
+// Current index of a handle, -1 if it doesn't exist
+//-----------------------------------------------------
+template <class T>
+int EntryStore<T>::GetIndex
+(
+    Handle _handle
+) const
+{
+    unsigned int handleIndex = FindHandle(_handle);
+    if (handleIndex == m_handles.Size()) return -1;
+
+    Label const label = m_handles.At(handleIndex).m_label;
+    return static_cast<int>(m_order.LowerBound([label](Slot const& _slot) { return _slot.m_label < label; }));
+}
+
+//-----------------------------------------------------
+// Copy all values in order
+//-----------------------------------------------------
+template <class T>
+void EntryStore<T>::ToVector
+(
+    vector<T>& _values
+) const
+{
+    _values.clear();
+    _values.reserve(Size());
+    ForEach(0, [&_values](unsigned int, T const& _value) -> bool
+    {
+        _values.push_back(_value);
+        return true;
+    });
+}
+
+//-----------------------------------------------------
+// Visit (index, value) in order from _start
+//-----------------------------------------------------
+template <class T>
+template <class F>
+bool EntryStore<T>::ForEach
+(
+    unsigned int _start,
+    F _func
+) const
+{
+    return m_order.ForEach(_start, [&_func](unsigned int _index, Slot const& _slot) -> bool
+    {
+        return _func(_index, _slot.m_value);
+    });
+}
+
+//-----------------------------------------------------
+// Visit (handle, value) in order, no lookups needed
+//-----------------------------------------------------
+template <class T>
+template <class F>
+bool EntryStore<T>::ForEachHandle
+(
+    F _func
+) const
+{
+    return m_order.ForEach(0, [&_func](unsigned int, Slot const& _slot) -> bool
+    {
+        return _func(_slot.m_handle, _slot.m_value);
+    });
+}
+
+//-----------------------------------------------------
+// Replace all values, every value gets a new handle
+//-----------------------------------------------------
+template <class T>
+void EntryStore<T>::Assign
+(
+    vector<T> const& _values
+)
+{
+    vector<Slot> slots(_values.size());
+    vector<HandleSlot> handles(_values.size());
+    for (unsigned int i = 0; i < _values.size(); i++)
+    {
+        slots[i].m_label = (i + 1) * LabelGap;
+        slots[i].m_handle = m_nextHandle++;
+        slots[i].m_value = _values[i];
+
+        // Handles are increasing so this is sorted too
+        handles[i].m_handle = slots[i].m_handle;
+        handles[i].m_label = slots[i].m_label;
+    }
+
+    m_order.Assign(slots);
+    m_handles.Assign(handles);
+}
+
+//-----------------------------------------------------
+// Replace value at index, handle stays the same
+//-----------------------------------------------------
+template <class T>
+void EntryStore<T>::Set
+(
+    unsigned int _index,
+    T const& _value
+)
+{
+    if (_index >= Size()) return;
+
+    Slot slot = m_order.At(_index);
+    slot.m_value = _value;
+    m_order.Set(_index, slot);
+}
+
+//-----------------------------------------------------
+// Insert value before index and return its new handle
+//-----------------------------------------------------
+template <class T>
+typename EntryStore<T>::Handle EntryStore<T>::Insert
+(
+    unsigned int _index,
+    T const& _value
+)
+{
+    _index = min(_index, Size());
+
+    Slot slot;
+    slot.m_label = GetInsertLabel(_index);
+    slot.m_handle = m_nextHandle++;
+    slot.m_value = _value;
+    m_order.Insert(_index, slot);
+
+    // Newest handle is always the largest
+    HandleSlot handleSlot;
+    handleSlot.m_handle = slot.m_handle;
+    handleSlot.m_label = slot.m_label;
+    m_handles.PushBack(handleSlot);
+
+    return slot.m_handle;
+}
+
+//-----------------------------------------------------
+// Remove value at index, its handle becomes invalid
+//-----------------------------------------------------
+template <class T>
+void EntryStore<T>::Erase
+(
+    unsigned int _index
+)
+{
+    if (_index >= Size()) return;
+
+    Handle const handle = m_order.At(_index).m_handle;
+    m_order.Erase(_index);
+    m_handles.Erase(FindHandle(handle));
+}
+
+//-----------------------------------------------------
+// Same as erasing _from then inserting at _to, keeps the handle
+//-----------------------------------------------------
+template <class T>
+void EntryStore<T>::Move
+(
+    unsigned int _from,
+    unsigned int _to
+)
+{
+    if (_from >= Size() || _from == _to) return;
+
+    // Take it out of both lists first, finding a label may relabel everything
+    Slot slot = m_order.At(_from);
+    unsigned int handleIndex = FindHandle(slot.m_handle);
+    m_order.Erase(_from);
+    m_handles.Erase(handleIndex);
+
+    _to = min(_to, Size());
+    slot.m_label = GetInsertLabel(_to);
+    m_order.Insert(_to, slot);
+
+    HandleSlot handleSlot;
+    handleSlot.m_handle = slot.m_handle;
+    handleSlot.m_label = slot.m_label;
+    m_handles.Insert(handleIndex, handleSlot);
+}
+
+//-----------------------------------------------------
+// Move many entries at once, _from[i] ends up at _to[i] and
+// everything else keeps its relative order. Only the moved
+// entries are taken out and put back, O(k log n).
+//-----------------------------------------------------
+template <class T>
+bool EntryStore<T>::Move
+(
+    vector<unsigned int> const& _from,
+    vector<unsigned int> const& _to
+)
+{
+    unsigned int const size = Size();
+    unsigned int const count = static_cast<unsigned int>(_from.size());
+    if (_to.size() != count) return false;
+
+    // Moved entries in the order they are now and the order they go
+    vector<unsigned int> byFrom(count);
+    vector<unsigned int> byTo(count);
+    iota(byFrom.begin(), byFrom.end(), 0);
+    iota(byTo.begin(), byTo.end(), 0);
+    sort(byFrom.begin(), byFrom.end(), [&_from](unsigned int _a, unsigned int _b) { return _from[_a] < _from[_b]; });
+    sort(byTo.begin(), byTo.end(), [&_to](unsigned int _a, unsigned int _b) { return _to[_a] < _to[_b]; });
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (_from[byFrom[i]] >= size || _to[byTo[i]] >= size) return false;
+        if (i > 0 && (_from[byFrom[i]] == _from[byFrom[i - 1]] || _to[byTo[i]] == _to[byTo[i - 1]])) return false;
+    }
+
+    // Take them out from the bottom so the remaining indices stay valid
+    vector<Slot> slots(count);
+    for (unsigned int i = count; i-- > 0;)
+    {
+        unsigned int const m = byFrom[i];
+        slots[m] = m_order.At(_from[m]);
+        m_order.Erase(_from[m]);
+        m_handles.Erase(FindHandle(slots[m].m_handle));
+    }
+
+    // Put them back from the top, every index before a target is then final
+    for (unsigned int const m : byTo)
+    {
+        Slot& slot = slots[m];
+        slot.m_label = GetInsertLabel(_to[m]);
+        m_order.Insert(_to[m], slot);
+
+        HandleSlot handleSlot;
+        handleSlot.m_handle = slot.m_handle;
+        handleSlot.m_label = slot.m_label;
+        Handle const handle = slot.m_handle;
+        m_handles.Insert(m_handles.LowerBound([handle](HandleSlot const& _slot) { return _slot.m_handle < handle; }), handleSlot);
+    }
+    return true;
+}
+
+//-----------------------------------------------------
+// Go back to an older copy
+//-----------------------------------------------------
+template <class T>
+void EntryStore<T>::Restore
+(
+    EntryStore const& _other
+)
+{
+    m_order = _other.m_order;
+    m_handles = _other.m_handles;
+    m_nextHandle = max(m_nextHandle, _other.m_nextHandle);
+}
+
+//-----------------------------------------------------
+// Index of handle in m_handles, Size() if not found
+//-----------------------------------------------------
+template <class T>
+unsigned int EntryStore<T>::FindHandle
+(
+    Handle _handle
+) const
+{
+    unsigned int index = m_handles.LowerBound([_handle](HandleSlot const& _slot) { return _slot.m_handle < _handle; });
+    if (index < m_handles.Size() && m_handles.At(index).m_handle == _handle)
+    {
+        return index;
+    }
+    return m_handles.Size();
+}
+
+//-----------------------------------------------------
+// Label that fits before _index, relabel all when out of space
+//-----------------------------------------------------
+template <class T>
+typename EntryStore<T>::Label EntryStore<T>::GetInsertLabel
+(
+    unsigned int _index
+)
+{
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        Label const low = _index > 0 ? m_order.At(_index - 1).m_label : 0;
+        Label const high = _index < Size() ? m_order.At(_index).m_label : low + 2 * LabelGap;
+        if (high > low + 1)
+        {
+            return low + (high - low) / 2;
+        }
+
+        // Repeated inserts at the same spot used up the gap
+        Relabel();
+    }
+
+    return 0;
+}
+
+//-----------------------------------------------------
+// Spread labels evenly again, O(n) but rarely needed
+//-----------------------------------------------------
+template <class T>
+void EntryStore<T>::Relabel()
+{
+    vector<Slot> slots;
+    m_order.ToVector(slots);
+
+    vector<HandleSlot> handles(slots.size());
+    for (unsigned int i = 0; i < slots.size(); i++)
+    {
+        slots[i].m_label = (i + 1) * LabelGap;
+        handles[i].m_handle = slots[i].m_handle;
+        handles[i].m_label = slots[i].m_label;
+    }
+    sort(handles.begin(), handles.end(), [](HandleSlot const& _a, HandleSlot const& _b) { return _a.m_handle < _b.m_handle; });
+
+    m_order.Assign(slots);
+    m_handles.Assign(handles);
+}
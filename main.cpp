@@ -1,9 +1,29 @@
 #include "msteditor.h"
+#include "commandline.h"
 #include <string>
 #include <QApplication>
 
+#ifdef _WIN32
+#include <cstdio>
+#include <windows.h>
+#endif
+
 int main(int argc, char *argv[])
 {
+    // Batch commands never create a window
+    if (argc > 1 && CommandLine::IsCommand(QString::fromLocal8Bit(argv[1])))
+    {
+#ifdef _WIN32
+        // GUI executable, print to the console that started it
+        if (AttachConsole(ATTACH_PARENT_PROCESS))
+        {
+            freopen("CONOUT$", "w", stdout);
+            freopen("CONOUT$", "w", stderr);
+        }
+#endif
+        return CommandLine::Run(argc, argv);
+    }
+
     QApplication a(argc, argv);
     mstEditor w;
     w.show();
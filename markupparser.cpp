@@ -0,0 +1,289 @@
+#include "markupparser.h"
+
+#include <QStringList>
+
+//-----------------------------------------------------
+// Parse the tags and every page of an entry
+//-----------------------------------------------------
+void MarkupParser::Parse
+(
+    mst::TextEntry const& _entry,
+    Document& _document
+)
+{
+    _document.m_tags.clear();
+    _document.m_tags.reserve(static_cast<int>(_entry.m_tags.size()));
+    for (string const& tag : _entry.m_tags)
+    {
+        _document.m_tags.push_back(ParseTag(tag));
+    }
+
+    QVector<QString> pages;
+    pages.reserve(static_cast<int>(_entry.m_subtitles.size()));
+    for (wstring const& subtitle : _entry.m_subtitles)
+    {
+        pages.push_back(QString::fromStdWString(subtitle));
+    }
+    Parse(pages, _document);
+}
+
+//-----------------------------------------------------
+// Build the tree of every page, _document.m_tags must be filled
+//-----------------------------------------------------
+void MarkupParser::Parse
+(
+    QVector<QString> const& _pages,
+    Document& _document
+)
+{
+    QVector<TagInfo>& tags = _document.m_tags;
+    for (TagInfo& tag : tags)
+    {
+        tag.m_page = -1;
+        tag.m_partner = -1;
+    }
+
+    _document.m_tagStarts.resize(_pages.size() + 1);
+    _document.m_tagStarts[0] = 0;
+    for (int i = 0; i < _pages.size(); i++)
+    {
+        _document.m_tagStarts[i + 1] = _document.m_tagStarts[i] + _pages[i].count('$');
+    }
+    int const tagCount = _document.m_tagStarts.back();
+    _document.m_hardcoded = tags.isEmpty() && tagCount > 0;
+    _document.m_tagCountMismatch = !_document.m_hardcoded && tags.size() != tagCount;
+
+    _document.m_pages.clear();
+    _document.m_pages.reserve(_pages.size());
+
+    int tagID = 0;
+    for (int page = 0; page < _pages.size(); page++)
+    {
+        QVector<Node> nodes;
+
+        // Color nodes still open, innermost last. Only the innermost list
+        // grows while they are open so the pointers stay valid.
+        QVector<Node*> open;
+        auto current = [&nodes, &open]() -> QVector<Node>&
+        {
+            return open.isEmpty() ? nodes : open.back()->m_children;
+        };
+
+        QString text;
+        auto flushText = [&text, &current]()
+        {
+            if (text.isEmpty()) return;
+
+            Node node;
+            node.m_text = text;
+            current().push_back(node);
+            text.clear();
+        };
+
+        for (QChar const& chr : _pages[page])
+        {
+            if (chr != '$' || _document.m_hardcoded)
+            {
+                text += chr;
+                continue;
+            }
+
+            if (_document.m_tagCountMismatch) continue;
+            flushText();
+
+            int const t = tagID++;
+            TagInfo& tag = tags[t];
+            tag.m_page = page;
+
+            Node node;
+            node.m_tag = t;
+            if (tag.m_type == Tag::RGBA && tag.m_valid)
+            {
+                node.m_type = NodeType::Color;
+                node.m_color = tag.m_color;
+
+                QVector<Node>& parent = current();
+                parent.push_back(node);
+                open.push_back(&parent.back());
+                continue;
+            }
+
+            if (tag.m_type == Tag::Color && !open.isEmpty())
+            {
+                Node* color = open.back();
+                open.pop_back();
+                color->m_endTag = t;
+                tag.m_partner = color->m_tag;
+                tags[color->m_tag].m_partner = t;
+                continue;
+            }
+
+            if (tag.m_type == Tag::Sound || tag.m_type == Tag::Picture)
+            {
+                node.m_type = (tag.m_type == Tag::Sound) ? NodeType::Sound : NodeType::Picture;
+                node.m_text = tag.m_value;
+            }
+            else
+            {
+                // Broken rgba or color with nothing to close
+                node.m_type = NodeType::Picture;
+                node.m_text = "button_a";
+            }
+            current().push_back(node);
+        }
+        flushText();
+
+        // Not closed on this page, what it colored moves up a level.
+        // An open color is always the last node of its parent.
+        while (!open.isEmpty())
+        {
+            Node* color = open.back();
+            open.pop_back();
+
+            QVector<Node> children;
+            children.swap(color->m_children);
+            color->m_type = NodeType::Picture;
+            color->m_text = "button_a";
+            current() += children;
+        }
+
+        _document.m_pages.push_back(nodes);
+    }
+}
+
+//-----------------------------------------------------
+// Walk a page in order, spans are added before what they color
+//-----------------------------------------------------
+void MarkupParser::Flatten
+(
+    QVector<Node> const& _nodes,
+    QString& _text,
+    QVector<Node const*>& _tagNodes,
+    QVector<Span>& _spans
+)
+{
+    for (Node const& node : _nodes)
+    {
+        switch (node.m_type)
+        {
+        case NodeType::Text:
+            _text += node.m_text;
+            break;
+        case NodeType::Sound:
+        case NodeType::Picture:
+            _text += '$';
+            _tagNodes.push_back(&node);
+            break;
+        case NodeType::Color:
+        {
+            int const index = _spans.size();
+            _spans.push_back(Span());
+            _spans[index].m_color = node.m_color;
+            _spans[index].m_start = _text.size();
+
+            Flatten(node.m_children, _text, _tagNodes, _spans);
+            _spans[index].m_end = _text.size() - 1;
+            break;
+        }
+        }
+    }
+}
+
+//-----------------------------------------------------
+// "sound(x)", "picture(x)", "rgba(r,g,b[,a])" or "color"
+//-----------------------------------------------------
+MarkupParser::TagInfo MarkupParser::ParseTag
+(
+    string const& _tag
+)
+{
+    if (_tag == "color")
+    {
+        return MakeTag(Tag::Color, "color");
+    }
+
+    size_t const start = _tag.find('(');
+    if (start == string::npos || _tag.back() != ')')
+    {
+        // Treated as a picture like the editor always has
+        TagInfo info = MakeTag(Tag::Picture, QString::fromStdString(_tag));
+        info.m_known = false;
+        info.m_valid = false;
+        return info;
+    }
+
+    string const type = _tag.substr(0, start);
+    QString const value = QString::fromStdString(_tag.substr(start + 1, _tag.size() - start - 2));
+    if (type == "sound") return MakeTag(Tag::Sound, value);
+    if (type == "rgba") return MakeTag(Tag::RGBA, value);
+
+    TagInfo info = MakeTag(Tag::Picture, value);
+    info.m_known = (type == "picture");
+    return info;
+}
+
+//-----------------------------------------------------
+// Tag from its type and value, rgba numbers are checked
+//-----------------------------------------------------
+MarkupParser::TagInfo MarkupParser::MakeTag
+(
+    Tag _type,
+    QString const& _value
+)
+{
+    TagInfo info;
+    info.m_type = _type;
+    info.m_value = _value;
+
+    if (_type == Tag::RGBA)
+    {
+        int numbers[4] = {0, 0, 0, 255};
+        QStringList const rgbaStr = _value.split(",");
+        info.m_valid = (rgbaStr.size() == 3 || rgbaStr.size() == 4);
+        for (int i = 0; i < rgbaStr.size() && info.m_valid; i++)
+        {
+            numbers[i] = rgbaStr[i].toInt(&info.m_valid);
+        }
+
+        if (info.m_valid)
+        {
+            info.m_color = QColor(numbers[0], numbers[1], numbers[2], numbers[3]);
+        }
+    }
+
+    return info;
+}
+
+//-----------------------------------------------------
+// Tag string as stored in the file
+//-----------------------------------------------------
+string MarkupParser::ToString
+(
+    Tag _type,
+    QString const& _value
+)
+{
+    switch (_type)
+    {
+    case Tag::Sound: return "sound(" + _value.toStdString() + ")";
+    case Tag::RGBA: return "rgba(" + _value.toStdString() + ")";
+    case Tag::Color: return "color";
+    default: return "picture(" + _value.toStdString() + ")";
+    }
+}
+
+//-----------------------------------------------------
+// "r,g,b", alpha is only written when it is not 255
+//-----------------------------------------------------
+QString MarkupParser::ToRGBAValue
+(
+    QColor const& _color
+)
+{
+    QString str = QString::number(_color.red()) + "," + QString::number(_color.green()) + "," + QString::number(_color.blue());
+    if (_color.alpha() != 255)
+    {
+        str += "," + QString::number(_color.alpha());
+    }
+    return str;
+}
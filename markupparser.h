@@ -0,0 +1,100 @@
+//-----------------------------------------------------
+// Name: markupparser.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <QColor>
+#include <QString>
+#include <QVector>
+
+#include "mst.h"
+
+// Tag Type enum
+enum Tag : int {
+    Sound,
+    Picture,
+    RGBA,
+    Color
+};
+
+//-----------------------------------------------------
+// Turns the $ of a subtitle and its tag list into a small
+// tree in one pass. Each $ takes the next tag, rgba opens
+// a color span and color closes the innermost open one,
+// so spans never cross a page. Unpaired or broken colors
+// are shown as the A button, the same as everywhere else.
+//-----------------------------------------------------
+class MarkupParser
+{
+public:
+    // What one tag of the entry turned out to be
+    struct TagInfo
+    {
+        TagInfo():m_type(Tag::Picture),m_known(true),m_valid(true),m_page(-1),m_partner(-1){}
+
+        Tag m_type;
+        QString m_value;    // Inside the brackets, "color" for color
+        QColor m_color;     // RGBA only
+        bool m_known;       // sound, picture, rgba or color
+        bool m_valid;       // Brackets and rgba numbers are fine
+        int m_page;         // Page of its $, -1 when there are more tags than $
+        int m_partner;      // Matching rgba or color on the same page, -1 if none
+    };
+
+    enum class NodeType : int
+    {
+        Text,
+        Sound,
+        Picture,
+        Color
+    };
+
+    struct Node
+    {
+        Node():m_type(NodeType::Text),m_tag(-1),m_endTag(-1){}
+
+        NodeType m_type;
+        QString m_text;             // Text run, or the sound or picture name
+        QColor m_color;             // Color only
+        int m_tag;                  // Index in the tags, -1 for text
+        int m_endTag;               // Color only, the color tag closing it
+        QVector<Node> m_children;   // Color only, what it colors
+    };
+
+    struct Document
+    {
+        Document():m_hardcoded(false),m_tagCountMismatch(false){}
+
+        QVector<TagInfo> m_tags;
+        QVector<QVector<Node>> m_pages;
+        QVector<int> m_tagStarts;   // Number of $ before each page, one extra for the total
+        bool m_hardcoded;           // $ but no tags, every $ stays as text
+        bool m_tagCountMismatch;    // Tags are left out of the pages and their $ dropped
+    };
+
+    // Color span of a flattened page, characters m_start to m_end inclusive
+    struct Span
+    {
+        Span():m_start(0),m_end(0){}
+
+        QColor m_color;
+        int m_start;
+        int m_end;
+    };
+
+public:
+    static void Parse(mst::TextEntry const& _entry, Document& _document);
+    static void Parse(QVector<QString> const& _pages, Document& _document);
+
+    // Page text with one $ for every sound and picture, those nodes
+    // in order, and the color spans in the order they open
+    static void Flatten(QVector<Node> const& _nodes, QString& _text, QVector<Node const*>& _tagNodes, QVector<Span>& _spans);
+
+    // Between tag strings and TagInfo
+    static TagInfo ParseTag(string const& _tag);
+    static TagInfo MakeTag(Tag _type, QString const& _value);
+    static string ToString(Tag _type, QString const& _value);
+    static QString ToRGBAValue(QColor const& _color);
+};
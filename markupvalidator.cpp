@@ -0,0 +1,152 @@
+#include "markupvalidator.h"
+
+#include "markupparser.h"
+#include "trace.h"
+
+//-----------------------------------------------------
+// Check every entry of a file
+//-----------------------------------------------------
+void MarkupValidator::Validate
+(
+    vector<mst::EntryPtr> const& _entries,
+    Report& _report
+) const
+{
+    TRACE_SCOPE("MarkupValidator::Validate");
+
+    for (unsigned int i = 0; i < _entries.size(); i++)
+    {
+        Validate(*_entries[i], static_cast<int>(i), _report);
+    }
+}
+
+//-----------------------------------------------------
+// Check one entry, same rules LoadSubtitle applies
+//-----------------------------------------------------
+void MarkupValidator::Validate
+(
+    mst::TextEntry const& _entry,
+    int _index,
+    Report& _report
+) const
+{
+    _report.m_entryCount++;
+
+    Issue issue;
+    issue.m_name = QString::fromStdString(_entry.m_name);
+    issue.m_entry = _index;
+
+    auto addIssue = [&](IssueType _type, int _page, int _tag, QString const& _detail)
+    {
+        issue.m_type = _type;
+        issue.m_page = _page;
+        issue.m_tag = _tag;
+        issue.m_detail = _detail;
+        _report.m_issues.push_back(issue);
+        _report.m_errorCount += IsError(_type);
+    };
+
+    MarkupParser::Document document;
+    MarkupParser::Parse(_entry, document);
+    int const tagCount = document.m_tagStarts.back();
+    int const tagSize = document.m_tags.size();
+
+    if (document.m_hardcoded)
+    {
+        _report.m_hardcodedCount++;
+        addIssue(IssueType::Hardcoded, -1, -1, QString::number(tagCount));
+        return;
+    }
+
+    // Tags are not on any page then, pairing them means nothing
+    if (document.m_tagCountMismatch)
+    {
+        addIssue(IssueType::TagCount, -1, -1, QString("%1 tags but %2 $").arg(tagSize).arg(tagCount));
+    }
+
+    for (int t = 0; t < tagSize; t++)
+    {
+        MarkupParser::TagInfo const& tag = document.m_tags[t];
+        QString const tagStr = QString::fromStdString(_entry.m_tags[t]);
+        bool const paired = document.m_tagCountMismatch || tag.m_partner >= 0;
+        if (!tag.m_known)
+        {
+            addIssue(IssueType::UnknownTag, tag.m_page, t, tagStr);
+        }
+        else if (tag.m_type == Tag::RGBA && !tag.m_valid)
+        {
+            addIssue(IssueType::BrokenRGBA, tag.m_page, t, tagStr);
+        }
+        else if (tag.m_type == Tag::RGBA && !paired)
+        {
+            addIssue(IssueType::RGBAWithoutColor, tag.m_page, t, tagStr);
+        }
+        else if (tag.m_type == Tag::Color && !paired)
+        {
+            addIssue(IssueType::ColorWithoutRGBA, tag.m_page, t, tagStr);
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Load and validate a file, for running over a directory
+//-----------------------------------------------------
+MarkupValidator::Report MarkupValidator::operator()
+(
+    QString const& _fileName
+) const
+{
+    Report report;
+    report.m_fileName = _fileName;
+
+    mst file;
+    string errorMsg;
+    if (!file.Load(_fileName.toStdString(), errorMsg))
+    {
+        report.m_errorMsg = QString::fromStdString(errorMsg);
+        return report;
+    }
+
+    vector<mst::EntryPtr> entries;
+    file.GetSnapshot().m_entries.ToVector(entries);
+    Validate(entries, report);
+    return report;
+}
+
+//-----------------------------------------------------
+// Readable description of an issue
+//-----------------------------------------------------
+QString MarkupValidator::ToString
+(
+    Issue const& _issue
+)
+{
+    QString str = _issue.m_name;
+    if (_issue.m_page >= 0)
+    {
+        str += " page " + QString::number(_issue.m_page + 1);
+    }
+
+    switch (_issue.m_type)
+    {
+    case IssueType::TagCount:
+        str += " has " + _issue.m_detail;
+        break;
+    case IssueType::Hardcoded:
+        str += " has " + _issue.m_detail + " $ but no tags (hardcoded)";
+        break;
+    case IssueType::UnknownTag:
+        str += ": unknown tag " + _issue.m_detail;
+        break;
+    case IssueType::BrokenRGBA:
+        str += ": broken " + _issue.m_detail;
+        break;
+    case IssueType::RGBAWithoutColor:
+        str += ": " + _issue.m_detail + " has no color after it on its page";
+        break;
+    case IssueType::ColorWithoutRGBA:
+        str += ": color has no rgba before it on its page";
+        break;
+    }
+    return str;
+}
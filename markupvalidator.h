@@ -0,0 +1,65 @@
+//-----------------------------------------------------
+// Name: markupvalidator.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <QString>
+#include <QVector>
+
+#include "mst.h"
+
+//-----------------------------------------------------
+// Finds the tag problems the editor would otherwise only
+// notice when an entry is opened: $ and tag counts that
+// differ, unknown or broken tags and rgba/color tags with
+// no partner on their page. Stateless, so one instance
+// can be mapped over a whole directory.
+//-----------------------------------------------------
+class MarkupValidator
+{
+public:
+    enum class IssueType : int
+    {
+        TagCount,       // Number of $ and tags differ
+        Hardcoded,      // $ but no tags, editing is restricted
+        UnknownTag,
+        BrokenRGBA,
+        RGBAWithoutColor,
+        ColorWithoutRGBA
+    };
+
+    struct Issue
+    {
+        Issue():m_type(IssueType::TagCount),m_entry(-1),m_page(-1),m_tag(-1){}
+
+        IssueType m_type;
+        QString m_name;
+        int m_entry;
+        int m_page;     // -1 when it is not about one page
+        int m_tag;      // -1 when it is not about one tag
+        QString m_detail;
+    };
+
+    struct Report
+    {
+        Report():m_entryCount(0),m_errorCount(0),m_hardcodedCount(0){}
+
+        QString m_fileName;
+        QVector<Issue> m_issues;
+        int m_entryCount;
+        int m_errorCount;
+        int m_hardcodedCount;
+        QString m_errorMsg;
+    };
+    typedef Report result_type;
+
+public:
+    void Validate(vector<mst::EntryPtr> const& _entries, Report& _report) const;
+    void Validate(mst::TextEntry const& _entry, int _index, Report& _report) const;
+    Report operator()(QString const& _fileName) const;
+
+    static bool IsError(IssueType _type) { return _type != IssueType::Hardcoded; }
+    static QString ToString(Issue const& _issue);
+};
@@ -0,0 +1,63 @@
+//-----------------------------------------------------
+// Name: memoryusage.cpp
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#include "memoryusage.h"
+
+#include <cstdio>
+
+atomic<long long> MemoryCounter::m_bytes[static_cast<int>(MemoryCategory::Count)];
+atomic<long long> MemoryCounter::m_allocations[static_cast<int>(MemoryCategory::Count)];
+
+namespace
+{
+
+string FormatBytes
+(
+    long long _bytes
+)
+{
+    char buffer[32];
+    if (_bytes >= 1024 * 1024)
+    {
+        snprintf(buffer, sizeof(buffer), "%.2f MB", _bytes / (1024.0 * 1024.0));
+    }
+    else if (_bytes >= 1024)
+    {
+        snprintf(buffer, sizeof(buffer), "%.1f KB", _bytes / 1024.0);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), "%lld B", _bytes);
+    }
+    return buffer;
+}
+
+}
+
+//-----------------------------------------------------
+// One line per category, then the allocator totals
+//-----------------------------------------------------
+string MemoryUsage::ToString() const
+{
+    string str;
+    str += "Entries: " + to_string(m_entryCount) + "\n";
+    str += "Names: " + FormatBytes(m_names) + "\n";
+    str += "Subtitles: " + FormatBytes(m_subtitles) + "\n";
+    str += "Tags: " + FormatBytes(m_tags) + "\n";
+    str += "Containers: " + FormatBytes(m_containers) + "\n";
+    if (m_treeItems > 0)
+    {
+        str += "Tree items: " + FormatBytes(m_treeItems) + "\n";
+    }
+    str += "Total: " + FormatBytes(GetTotal()) + "\n";
+
+    // Includes every open document and the undo history
+    str += "Allocated entries (process): " + FormatBytes(MemoryCounter::GetBytes(MemoryCategory::Entries));
+    str += " in " + to_string(MemoryCounter::GetAllocations(MemoryCategory::Entries)) + " blocks\n";
+    str += "Allocated store nodes (process): " + FormatBytes(MemoryCounter::GetBytes(MemoryCategory::StoreNodes));
+    str += " in " + to_string(MemoryCounter::GetAllocations(MemoryCategory::StoreNodes)) + " blocks\n";
+    return str;
+}
@@ -0,0 +1,102 @@
+//-----------------------------------------------------
+// Name: memoryusage.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+// What an allocation is for
+enum class MemoryCategory : int
+{
+    Entries,      // TextEntry and its shared_ptr block
+    StoreNodes,   // PersistentList nodes of EntryStore
+    Count
+};
+
+//-----------------------------------------------------
+// Live bytes and allocations for each category, shared
+// by every document including undo history
+//-----------------------------------------------------
+class MemoryCounter
+{
+public:
+    static void Add(MemoryCategory _category, long long _bytes, long long _allocations)
+    {
+        m_bytes[static_cast<int>(_category)].fetch_add(_bytes, memory_order_relaxed);
+        m_allocations[static_cast<int>(_category)].fetch_add(_allocations, memory_order_relaxed);
+    }
+
+    static long long GetBytes(MemoryCategory _category) { return m_bytes[static_cast<int>(_category)].load(memory_order_relaxed); }
+    static long long GetAllocations(MemoryCategory _category) { return m_allocations[static_cast<int>(_category)].load(memory_order_relaxed); }
+
+private:
+    static atomic<long long> m_bytes[static_cast<int>(MemoryCategory::Count)];
+    static atomic<long long> m_allocations[static_cast<int>(MemoryCategory::Count)];
+};
+
+//-----------------------------------------------------
+// std allocator that reports to MemoryCounter, used with
+// allocate_shared so the shared_ptr block is counted too
+//-----------------------------------------------------
+template <class T>
+class CountingAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit CountingAllocator(MemoryCategory _category) : m_category(_category) {}
+    template <class U> CountingAllocator(CountingAllocator<U> const& _other) : m_category(_other.GetCategory()) {}
+
+    T* allocate(size_t _count)
+    {
+        MemoryCounter::Add(m_category, static_cast<long long>(_count * sizeof(T)), 1);
+        return allocator<T>().allocate(_count);
+    }
+
+    void deallocate(T* _pointer, size_t _count)
+    {
+        MemoryCounter::Add(m_category, -static_cast<long long>(_count * sizeof(T)), -1);
+        allocator<T>().deallocate(_pointer, _count);
+    }
+
+    MemoryCategory GetCategory() const { return m_category; }
+
+    template <class U> bool operator==(CountingAllocator<U> const& _other) const { return m_category == _other.GetCategory(); }
+    template <class U> bool operator!=(CountingAllocator<U> const& _other) const { return m_category != _other.GetCategory(); }
+
+private:
+    MemoryCategory m_category;
+};
+
+//-----------------------------------------------------
+// Bytes used by one document, filled by mst and the editor
+//-----------------------------------------------------
+struct MemoryUsage
+{
+    MemoryUsage():m_entryCount(0),m_names(0),m_subtitles(0),m_tags(0),m_containers(0),m_treeItems(0){}
+
+    long long m_entryCount;
+    long long m_names;        // Characters of entry names
+    long long m_subtitles;    // Characters of subtitles
+    long long m_tags;         // Characters of tags
+    long long m_containers;   // Entries, vectors, strings and store nodes themselves
+    long long m_treeItems;    // Qt tree items, editor only
+
+    long long GetTotal() const { return m_names + m_subtitles + m_tags + m_containers + m_treeItems; }
+    string ToString() const;
+
+    // Heap bytes of a string, 0 when it fits in the string itself
+    template <class S> static long long GetHeapBytes(S const& _str)
+    {
+        char const* data = reinterpret_cast<char const*>(_str.data());
+        char const* object = reinterpret_cast<char const*>(&_str);
+        bool const local = (data >= object && data < object + sizeof(S));
+        return local ? 0 : static_cast<long long>((_str.capacity() + 1) * sizeof(typename S::value_type));
+    }
+};
@@ -5,6 +5,7 @@
 //-----------------------------------------------------
 
 #include "mst.h"
+#include "trace.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -15,8 +16,26 @@
 #include <sstream>
 #include <fstream>
 #include <iostream>
-#include <codecvt>
-#include <locale>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+// MSVC functions used by the reader and writer
+static int fopen_s(FILE** _file, char const* _fileName, char const* _mode)
+{
+    *_file = fopen(_fileName, _mode);
+    return *_file ? 0 : errno;
+}
+static unsigned int _byteswap_ulong(unsigned int _value) { return __builtin_bswap32(_value); }
+static unsigned short _byteswap_ushort(unsigned short _value) { return __builtin_bswap16(_value); }
+#endif
 
 //-----------------------------------------------------
 // Constructor
@@ -32,6 +51,7 @@ mst::mst()
     }
 
     m_loaded = false;
+    m_nameIndexValid = false;
 }
 
 //-----------------------------------------------------
@@ -41,18 +61,40 @@ mst::~mst()
 {
 }
 
+//-----------------------------------------------------
+// Exchange the loaded document with another one
+//-----------------------------------------------------
+void mst::Swap
+(
+    mst & _other
+)
+{
+    std::swap(m_loaded, _other.m_loaded);
+    std::swap(m_fileSize, _other.m_fileSize);
+    m_tableName.swap(_other.m_tableName);
+    std::swap(m_entries, _other.m_entries);
+    m_nameIndex.swap(_other.m_nameIndex);
+    std::swap(m_nameIndexValid, _other.m_nameIndexValid);
+}
+
 //-----------------------------------------------------
 // Load an fco file, return false if fail
 //-----------------------------------------------------
 bool mst::Load
 (
     string const & _fileName,
-    string & _errorMsg
+    string & _errorMsg,
+    ProgressCallback const & _progress
 )
 {
+    TRACE_SCOPE("mst::Load");
+    TRACE_PHASE("mst::Load header");
+
     m_fileSize = 0;
     m_tableName.clear();
-    m_entries.clear();
+    m_entries.Clear();
+    m_nameIndex.clear();
+    m_nameIndexValid = false;
     m_loaded = false;
 
     FILE* mstFile;
@@ -67,6 +109,7 @@ bool mst::Load
     fseek(mstFile, 0, SEEK_END);
     if (m_fileSize != (unsigned int)ftell(mstFile))
     {
+        fclose(mstFile);
         _errorMsg = "File size does not match the one stated in the file!";
         return false;
     }
@@ -82,6 +125,7 @@ bool mst::Load
     string verify1 = ReadAscii(mstFile, 6);
     if (verify1 != "1BBINA")
     {
+        fclose(mstFile);
         _errorMsg = "File is not 06 .mst file";
         return false;
     }
@@ -93,6 +137,7 @@ bool mst::Load
     string verify2 = ReadAscii(mstFile, 4);
     if (verify2 != "WTXT")
     {
+        fclose(mstFile);
         _errorMsg = "File is not 06 .mst file";
         return false;
     }
@@ -108,16 +153,39 @@ bool mst::Load
     fseek(mstFile, rootAddress + 0x08, SEEK_SET);
     unsigned int entryCount = ReadInt(mstFile);
 
+    // Each record is 3 addresses, check before allocating for them
+    if (entryCount > m_fileSize / 12)
+    {
+        fclose(mstFile);
+        _errorMsg = "Unexpected file size!";
+        return false;
+    }
+
+    // Read all records first, they are next to each other
+    TRACE_NEXT_PHASE("mst::Load records");
+    vector<unsigned int> records(entryCount * 3);
+    for (unsigned int i = 0; i < records.size(); ++i)
+    {
+        records[i] = ReadInt(mstFile);
+    }
+
     // Read individual entries
-    unsigned int currentAddress = ftell(mstFile);
-    m_entries.reserve(entryCount);
+    TRACE_NEXT_PHASE("mst::Load strings");
+    vector<EntryPtr> entries;
+    entries.reserve(entryCount);
     for (unsigned int i = 0; i < entryCount; ++i)
     {
+        if (_progress && !_progress(i, entryCount))
+        {
+            fclose(mstFile);
+            _errorMsg = "Loading cancelled!";
+            return false;
+        }
+
         TextEntry newEntry;
-        unsigned int nameAddress = ReadInt(mstFile);
-        unsigned int subtitlesAddress = ReadInt(mstFile);
-        unsigned int tagsAddress = ReadInt(mstFile);
-        currentAddress = ftell(mstFile);
+        unsigned int nameAddress = records[i * 3];
+        unsigned int subtitlesAddress = records[i * 3 + 1];
+        unsigned int tagsAddress = records[i * 3 + 2];
 
         // Read name
         fseek(mstFile, rootAddress + nameAddress, SEEK_SET);
@@ -195,12 +263,13 @@ bool mst::Load
             }
         }
 
-        m_entries.push_back(newEntry);
-
-        // Go back to the offset reading address
-        fseek(mstFile, currentAddress, SEEK_SET);
+        entries.push_back(MakeEntry(std::move(newEntry)));
     }
 
+    // Build the entry tree in one go
+    TRACE_NEXT_PHASE("mst::Load build");
+    m_entries.Assign(entries);
+
     // Skip the offset table
     fseek(mstFile, rootAddress + offsetTableAddress, SEEK_SET);
     fseek(mstFile, offsetTableSize, SEEK_CUR);
@@ -208,6 +277,7 @@ bool mst::Load
     // We should reach the end of the file
     if (m_fileSize != (unsigned int)ftell(mstFile))
     {
+        fclose(mstFile);
         _errorMsg = "Unexpected file size!";
         return false;
     }
@@ -286,14 +356,14 @@ wstring mst::ReadUTF16
     bool valid = false;
     while (ftell(_file) < (long)m_fileSize)
     {
-        wchar_t symbol;
+        unsigned short symbol;
         fread(&symbol, 2, 1, _file);
         symbol = _byteswap_ushort(symbol);
 
         // Append wchat_t to wstring or exit
         if (symbol)
         {
-            str += symbol;
+            str += static_cast<wchar_t>(symbol);
         }
         else
         {
@@ -320,8 +390,57 @@ bool mst::Save
         return false;
     }
 
+    return Save(GetSnapshot(), _fileName, _errorMsg);
+}
+
+//-----------------------------------------------------
+// Take a snapshot of the current entries, no entry is copied
+//-----------------------------------------------------
+mst::Snapshot mst::GetSnapshot()
+{
+    Snapshot snapshot;
+    snapshot.m_tableName = m_tableName;
+    snapshot.m_entries = m_entries;
+    return snapshot;
+}
+
+//-----------------------------------------------------
+// Go back to a previously taken snapshot
+//-----------------------------------------------------
+void mst::RestoreSnapshot
+(
+    Snapshot const & _snapshot
+)
+{
+    m_tableName = _snapshot.m_tableName;
+    m_entries.Restore(_snapshot.m_entries);
+    m_nameIndexValid = false;
+}
+
+//-----------------------------------------------------
+// Save a snapshot to a temp file then replace the target,
+// the target is never left half-written
+//-----------------------------------------------------
+bool mst::Save
+(
+    Snapshot const & _snapshot,
+    string const & _fileName,
+    string & _errorMsg
+)
+{
+    TRACE_SCOPE("mst::Save");
+
+    vector<EntryPtr> entries;
+    _snapshot.m_entries.ToVector(entries);
+
+    string const tempFileName = _fileName + ".tmp";
     FILE* output;
-    fopen_s(&output, _fileName.c_str(), "wb");
+    fopen_s(&output, tempFileName.c_str(), "wb");
+    if (!output)
+    {
+        _errorMsg = "Unable to write file!";
+        return false;
+    }
 
     // SKIPPED: File size, offset table address, offset table size
 
@@ -340,7 +459,7 @@ bool mst::Save
 
     // Write number of entries
     fseek(output, 0x28, SEEK_SET);
-    WriteInt(output, m_entries.size());
+    WriteInt(output, entries.size());
 
     // SKIPPED: Entry name, subtitles and tags address
     struct EntryAddresses
@@ -349,16 +468,16 @@ bool mst::Save
         unsigned int m_subtitlesAddress;
         unsigned int m_tagsAddress;
     };
-    vector<EntryAddresses> addresses(m_entries.size());
+    vector<EntryAddresses> addresses(entries.size());
 
     // Write subtitles
-    fseek(output, 0x0C * m_entries.size(), SEEK_CUR);
-    for (unsigned int i = 0; i < m_entries.size(); ++i)
+    fseek(output, 0x0C * entries.size(), SEEK_CUR);
+    for (unsigned int i = 0; i < entries.size(); ++i)
     {
         // Save subtitle address for this entry
         addresses[i].m_subtitlesAddress = ftell(output) - rootAddress;
 
-        TextEntry const& entry = m_entries[i];
+        TextEntry const& entry = *entries[i];
         for (unsigned int s = 0; s < entry.m_subtitles.size(); ++s)
         {
             wstring const& subtitle = entry.m_subtitles[s];
@@ -381,12 +500,12 @@ bool mst::Save
     fseek(output, 0x24, SEEK_SET);
     WriteInt(output, currentAddress - rootAddress);
     fseek(output, currentAddress, SEEK_SET);
-    WriteAscii(output, m_tableName);
+    WriteAscii(output, _snapshot.m_tableName);
 
     // Write entry name and tags
-    for (unsigned int i = 0; i < m_entries.size(); ++i)
+    for (unsigned int i = 0; i < entries.size(); ++i)
     {
-        TextEntry const& entry = m_entries[i];
+        TextEntry const& entry = *entries[i];
 
         // Write and save name address for this entry
         addresses[i].m_nameAddress = ftell(output) - rootAddress;
@@ -436,9 +555,9 @@ bool mst::Save
     // 'A': Skip "WTXT"
     // 'B': Skip table name offset and entry count
     string offsetTable = "AB";
-    for (unsigned int i = 0; i < m_entries.size(); ++i)
+    for (unsigned int i = 0; i < entries.size(); ++i)
     {
-        TextEntry const& entry = m_entries[i];
+        TextEntry const& entry = *entries[i];
         if (entry.m_tags.empty())
         {
             offsetTable += "AB";
@@ -452,6 +571,8 @@ bool mst::Save
     // Resize by -1 because last offset is not needed
     if (offsetTable.empty())
     {
+        fclose(output);
+        remove(tempFileName.c_str());
         _errorMsg = "Empty offset table...?";
         return false;
     }
@@ -485,10 +606,68 @@ bool mst::Save
     // Finally go back and write file size
     fseek(output, 0x00, SEEK_SET);
     WriteInt(output, currentAddress);
-    m_fileSize = currentAddress;
 
-    fclose(output);
+    // Only replace the target once everything is on disk
+    bool const writeFailed = ferror(output) != 0 || !SyncFile(output);
+    if (fclose(output) != 0 || writeFailed)
+    {
+        remove(tempFileName.c_str());
+        _errorMsg = "Failed to write file!";
+        return false;
+    }
+
+    if (!CommitFile(tempFileName, _fileName))
+    {
+        remove(tempFileName.c_str());
+        _errorMsg = "Unable to replace the existing file!";
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------
+// Flush a file past the OS cache, without it a power loss
+// can leave the renamed file empty or truncated
+//-----------------------------------------------------
+bool mst::SyncFile
+(
+    FILE * _file
+)
+{
+    if (fflush(_file) != 0) return false;
+#ifdef _WIN32
+    return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(_file)))) != 0;
+#else
+    return fsync(fileno(_file)) == 0;
+#endif
+}
+
+//-----------------------------------------------------
+// Atomically move a file over another one
+//-----------------------------------------------------
+bool mst::CommitFile
+(
+    string const & _from,
+    string const & _to
+)
+{
+#ifdef _WIN32
+    return MoveFileExA(_from.c_str(), _to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(_from.c_str(), _to.c_str()) != 0) return false;
+
+    // The rename itself is only durable once its directory is synced
+    size_t const slash = _to.find_last_of('/');
+    string const directory = (slash == string::npos) ? "." : (slash == 0 ? "/" : _to.substr(0, slash));
+    int const fd = open(directory.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
     return true;
+#endif
 }
 
 //-----------------------------------------------------
@@ -514,21 +693,8 @@ void mst::WriteAscii
     bool _termination
 )
 {
-    // Covert string to char*
-    unsigned int stringLength = _writeString.size();
-    char *stringBuffer = new char[stringLength + 2];
-    strcpy_s(stringBuffer, stringLength + 1, _writeString.c_str());
-
-    // Add null termination
-    if (_termination)
-    {
-        stringBuffer[stringLength + 1] = stringBuffer[stringLength];
-        stringBuffer[stringLength] = 0;
-    }
-
-    // Write bytes
-    fwrite(stringBuffer, 1, stringLength + _termination, _file);
-    delete[] stringBuffer;
+    // c_str() already ends with the null termination
+    fwrite(_writeString.c_str(), 1, _writeString.size() + _termination, _file);
 }
 
 //-----------------------------------------------------
@@ -541,58 +707,57 @@ void mst::WriteUTF16
     bool _termination
 )
 {
-    // Covert wstring to wchar_t*
-    unsigned int stringLength = _writeString.size();
-    wchar_t *stringBuffer = new wchar_t[stringLength + 2];
-    wcscpy_s(stringBuffer, stringLength + 1, _writeString.c_str());
-
-    // Swap all byte pairs
-    for (unsigned int i = 0; i < stringLength; ++i)
-    {
-        stringBuffer[i] = _byteswap_ushort(stringBuffer[i]);
-    }
-
-    // Add null termination
-    if (_termination)
+    // Always 2 bytes per character, wchar_t is not on every platform
+    vector<unsigned short> buffer(_writeString.size() + 1, 0);
+    for (size_t i = 0; i < _writeString.size(); ++i)
     {
-        stringBuffer[stringLength + 1] = stringBuffer[stringLength];
-        stringBuffer[stringLength] = 0;
+        // Swap all byte pairs
+        buffer[i] = _byteswap_ushort(static_cast<unsigned short>(_writeString[i]));
     }
 
-    // Write bytes
-    fwrite(stringBuffer, sizeof(wchar_t), stringLength + _termination, _file);
-    delete[] stringBuffer;
+    // Write bytes, last one is the null termination
+    fwrite(buffer.data(), 2, _writeString.size() + _termination, _file);
 }
 
 //-----------------------------------------------------
 // Save a text file
 //-----------------------------------------------------
-void mst::Export
+bool mst::Export
 (
     string const & _fileName,
+    string & _errorMsg,
     bool _russian
 )
 {
+    TRACE_SCOPE("mst::Export");
+
     if (!m_loaded)
     {
-        return;
+        _errorMsg = "File not loaded!";
+        return false;
     }
 
+    // Text mode, new lines are written the platform's way
     FILE* output;
-    fopen_s(&output, _fileName.c_str(), "w+,ccs=UTF-8");
+    fopen_s(&output, _fileName.c_str(), "w");
+    if (!output)
+    {
+        _errorMsg = "Unable to write file!";
+        return false;
+    }
+
+    // Byte order mark, same as what "ccs=UTF-8" used to write
+    fputs("\xEF\xBB\xBF", output);
 
     // Table Name
-    wstring tableName;
-    tableName.assign(m_tableName.begin(), m_tableName.end());
-    fwprintf_s(output, L"Table Name: %s\n\n", tableName.c_str());
+    fprintf(output, "Table Name: %s\n\n", ToUTF8(Widen(m_tableName)).c_str());
 
-    for (size_t i = 0; i < m_entries.size(); ++i)
+    vector<EntryPtr> entries;
+    m_entries.ToVector(entries);
+    for (size_t i = 0; i < entries.size(); ++i)
     {
-        TextEntry const& entry = m_entries[i];
-
-        wstring name;
-        name.assign(entry.m_name.begin(), entry.m_name.end());
-        fwprintf_s(output, L"-------------[%s]-------------\n", name.c_str());
+        TextEntry const& entry = *entries[i];
+        fprintf(output, "-------------[%s]-------------\n", ToUTF8(Widen(entry.m_name)).c_str());
 
         for (unsigned int s = 0; s < entry.m_subtitles.size(); ++s)
         {
@@ -607,32 +772,505 @@ void mst::Export
                     }
                 }
             }
-            fwprintf_s(output, L"%s\n\n", subtitle.c_str());
+            fprintf(output, "%s\n\n", ToUTF8(EscapePage(subtitle)).c_str());
         }
 
         if (!entry.m_tags.empty())
         {
-            fwprintf_s(output, L"Tags: ");
+            fputs("Tags: ", output);
             for (size_t t = 0; t < entry.m_tags.size(); ++t)
             {
-                string const& tag = entry.m_tags[t];
-                wstring wtag;
-                wtag.assign(tag.begin(), tag.end());
-                fwprintf_s(output, L"%s", wtag.c_str());
+                fputs(ToUTF8(Widen(entry.m_tags[t])).c_str(), output);
 
                 if (t != entry.m_tags.size() - 1)
                 {
-                    fwprintf_s(output, L", ");
+                    fputs(", ", output);
                 }
             }
 
-            fwprintf_s(output, L"\n");
+            fputs("\n", output);
         }
 
-        fwprintf_s(output, L"\n");
+        fputs("\n", output);
     }
 
+    bool const success = !ferror(output);
     fclose(output);
+    if (!success)
+    {
+        _errorMsg = "Unable to write file!";
+    }
+    return success;
+}
+
+//-----------------------------------------------------
+// Read back a text file written by Export
+//-----------------------------------------------------
+bool mst::Import
+(
+    string const & _fileName,
+    string & _errorMsg,
+    bool _russian
+)
+{
+    TRACE_SCOPE("mst::Import");
+
+    ifstream input(_fileName, ios::binary);
+    if (!input)
+    {
+        _errorMsg = "Unable to open file!";
+        return false;
+    }
+
+    stringstream buffer;
+    buffer << input.rdbuf();
+    string bytes = buffer.str();
+    if (bytes.compare(0, 3, "\xEF\xBB\xBF") == 0)
+    {
+        bytes.erase(0, 3);
+    }
+
+    wstring text;
+    size_t badOffset = 0;
+    if (!FromUTF8(bytes, text, badOffset))
+    {
+        // Offset in the file, the byte order mark included
+        if (buffer.str().size() != bytes.size())
+        {
+            badOffset += 3;
+        }
+        _errorMsg = "Invalid UTF-8 at byte " + to_string(badOffset) + "!";
+        return false;
+    }
+
+    // Files exported on Windows have \r\n
+    text.erase(remove(text.begin(), text.end(), L'\r'), text.end());
+
+    wstring const tableHeader = L"Table Name: ";
+    size_t const tableEnd = text.find(L'\n');
+    if (text.compare(0, tableHeader.size(), tableHeader) != 0 || tableEnd == wstring::npos)
+    {
+        _errorMsg = "File is not an exported text file!";
+        return false;
+    }
+
+    string const tableName = Narrow(text.substr(tableHeader.size(), tableEnd - tableHeader.size()));
+
+    // -------------[name]-------------
+    // page\n\n for every page, escaped so it has no blank line
+    // Tags: tag, tag\n if there is any
+    // \n
+    wstring const nameStart = L"-------------[";
+    wstring const nameEnd = L"]-------------\n";
+    wstring const tagsStart = L"\n\nTags: ";
+
+    vector<EntryPtr> entries;
+    size_t pos = text.find(nameStart, tableEnd);
+    while (pos != wstring::npos)
+    {
+        size_t const nameClose = text.find(nameEnd, pos);
+        if (nameClose == wstring::npos)
+        {
+            _errorMsg = "Broken entry name after entry " + to_string(entries.size()) + "!";
+            return false;
+        }
+
+        TextEntry entry;
+        entry.m_name = Narrow(text.substr(pos + nameStart.size(), nameClose - pos - nameStart.size()));
+
+        // Entry runs until the next name at the start of a line
+        size_t const bodyStart = nameClose + nameEnd.size();
+        size_t const next = text.find(L'\n' + nameStart, bodyStart);
+        size_t const bodyEnd = (next == wstring::npos) ? text.size() : next + 1;
+        wstring body = text.substr(bodyStart, bodyEnd - bodyStart);
+        pos = (next == wstring::npos) ? wstring::npos : next + 1;
+
+        // Blank line after every entry
+        if (body.empty() || body.back() != L'\n')
+        {
+            _errorMsg = "Entry " + entry.m_name + " is not terminated!";
+            return false;
+        }
+        body.pop_back();
+
+        // Tags are on the last line, right after the last page
+        size_t const tagsLine = body.rfind(tagsStart);
+        if (tagsLine != wstring::npos && !body.empty() && body.back() == L'\n' && body.find(L'\n', tagsLine + 2) == body.size() - 1)
+        {
+            size_t const tagsBegin = tagsLine + tagsStart.size();
+            string const tags = Narrow(body.substr(tagsBegin, body.size() - 1 - tagsBegin));
+            body.erase(tagsLine + 2);
+
+            size_t indexPrev = 0;
+            size_t index = tags.find(", ");
+            while (index != string::npos)
+            {
+                entry.m_tags.push_back(tags.substr(indexPrev, index - indexPrev));
+                indexPrev = index + 2;
+                index = tags.find(", ", indexPrev);
+            }
+            entry.m_tags.push_back(tags.substr(indexPrev));
+        }
+
+        // Pages are separated by a blank line, like in the tree view
+        if (!body.empty())
+        {
+            if (body.size() < 2 || body.compare(body.size() - 2, 2, L"\n\n") != 0)
+            {
+                _errorMsg = "Entry " + entry.m_name + " has a broken page!";
+                return false;
+            }
+            body.erase(body.size() - 2);
+
+            size_t indexPrev = 0;
+            size_t index = body.find(L"\n\n");
+            while (index != wstring::npos)
+            {
+                entry.m_subtitles.push_back(body.substr(indexPrev, index - indexPrev));
+                indexPrev = index + 2;
+                index = body.find(L"\n\n", indexPrev);
+            }
+            entry.m_subtitles.push_back(body.substr(indexPrev));
+
+            for (wstring& subtitle : entry.m_subtitles)
+            {
+                subtitle = UnescapePage(subtitle);
+            }
+        }
+
+        if (_russian)
+        {
+            for (wstring& subtitle : entry.m_subtitles)
+            {
+                for(wchar_t& chr : subtitle)
+                {
+                    if (m_russianToUnicode.find(chr) != m_russianToUnicode.end())
+                    {
+                        chr = m_russianToUnicode[chr];
+                    }
+                }
+            }
+        }
+
+        entries.push_back(MakeEntry(std::move(entry)));
+    }
+
+    m_tableName = tableName;
+    m_entries.Assign(entries);
+    m_nameIndexValid = false;
+    m_loaded = true;
+    return true;
+}
+
+//-----------------------------------------------------
+// Allocate an entry, counted as MemoryCategory::Entries
+//-----------------------------------------------------
+mst::EntryPtr mst::MakeEntry
+(
+    TextEntry _entry
+)
+{
+    return allocate_shared<TextEntry>(CountingAllocator<TextEntry>(MemoryCategory::Entries), std::move(_entry));
+}
+
+//-----------------------------------------------------
+// Index every entry by name
+//-----------------------------------------------------
+void mst::BuildNameIndex()
+{
+    TRACE_SCOPE("mst::BuildNameIndex");
+
+    m_nameIndex.clear();
+    m_nameIndex.reserve(m_entries.Size());
+    m_entries.ForEachHandle([this](Handle _handle, EntryPtr const& _entry) -> bool
+    {
+        m_nameIndex.emplace(_entry->m_name, _handle);
+        return true;
+    });
+    m_nameIndexValid = true;
+}
+
+//-----------------------------------------------------
+// Add a name, nothing to do if the index is rebuilt later anyway
+//-----------------------------------------------------
+void mst::IndexName
+(
+    string const & _name,
+    Handle _handle
+)
+{
+    if (!m_nameIndexValid) return;
+    m_nameIndex.emplace(_name, _handle);
+}
+
+//-----------------------------------------------------
+// Remove a name
+//-----------------------------------------------------
+void mst::UnindexName
+(
+    string const & _name,
+    Handle _handle
+)
+{
+    if (!m_nameIndexValid) return;
+
+    auto const range = m_nameIndex.equal_range(_name);
+    for (auto iter = range.first; iter != range.second; iter++)
+    {
+        if (iter->second == _handle)
+        {
+            m_nameIndex.erase(iter);
+            return;
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Names and tags are bytes, keep each one as a character
+//-----------------------------------------------------
+wstring mst::Widen
+(
+    string const & _str
+)
+{
+    wstring str;
+    str.reserve(_str.size());
+    for (char chr : _str)
+    {
+        str += static_cast<wchar_t>(static_cast<unsigned char>(chr));
+    }
+    return str;
+}
+
+//-----------------------------------------------------
+// Undo Widen
+//-----------------------------------------------------
+string mst::Narrow
+(
+    wstring const & _str
+)
+{
+    string str;
+    str.reserve(_str.size());
+    for (wchar_t chr : _str)
+    {
+        str += static_cast<char>(chr < 0x100 ? chr : L'?');
+    }
+    return str;
+}
+
+//-----------------------------------------------------
+// Subtitles are UTF-16 code units on every platform, even where
+// wchar_t is 32 bits, a lone surrogate is written as U+FFFD
+//-----------------------------------------------------
+string mst::ToUTF8
+(
+    wstring const & _str
+)
+{
+    string str;
+    str.reserve(_str.size());
+    for (size_t i = 0; i < _str.size(); ++i)
+    {
+        unsigned int code = static_cast<unsigned int>(_str[i]) & 0xFFFF;
+        if (code >= 0xD800 && code <= 0xDFFF)
+        {
+            unsigned int const low = i + 1 < _str.size() ? static_cast<unsigned int>(_str[i + 1]) & 0xFFFF : 0;
+            if (code <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF)
+            {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            }
+            else
+            {
+                code = 0xFFFD;
+            }
+        }
+
+        if (code < 0x80)
+        {
+            str += static_cast<char>(code);
+        }
+        else if (code < 0x800)
+        {
+            str += static_cast<char>(0xC0 | (code >> 6));
+            str += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000)
+        {
+            str += static_cast<char>(0xE0 | (code >> 12));
+            str += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            str += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else
+        {
+            str += static_cast<char>(0xF0 | (code >> 18));
+            str += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            str += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            str += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+    return str;
+}
+
+//-----------------------------------------------------
+// Undo ToUTF8, stops at the first invalid sequence and
+// gives its byte offset
+//-----------------------------------------------------
+bool mst::FromUTF8
+(
+    string const & _bytes,
+    wstring & _str,
+    size_t & _badOffset
+)
+{
+    _str.clear();
+    _str.reserve(_bytes.size());
+    size_t i = 0;
+    while (i < _bytes.size())
+    {
+        unsigned char const lead = static_cast<unsigned char>(_bytes[i]);
+        unsigned int code = 0;
+        size_t length = 0;
+        unsigned int minimum = 0;
+        if (lead < 0x80)
+        {
+            code = lead;
+            length = 1;
+        }
+        else if ((lead & 0xE0) == 0xC0)
+        {
+            code = lead & 0x1F;
+            length = 2;
+            minimum = 0x80;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+            code = lead & 0x0F;
+            length = 3;
+            minimum = 0x800;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            code = lead & 0x07;
+            length = 4;
+            minimum = 0x10000;
+        }
+        else
+        {
+            _badOffset = i;
+            return false;
+        }
+
+        if (i + length > _bytes.size())
+        {
+            _badOffset = i;
+            return false;
+        }
+
+        for (size_t c = 1; c < length; ++c)
+        {
+            unsigned char const next = static_cast<unsigned char>(_bytes[i + c]);
+            if ((next & 0xC0) != 0x80)
+            {
+                _badOffset = i;
+                return false;
+            }
+            code = (code << 6) | (next & 0x3F);
+        }
+
+        // Overlong forms, surrogates and anything past U+10FFFF
+        if (code < minimum || (code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF)
+        {
+            _badOffset = i;
+            return false;
+        }
+
+        if (code >= 0x10000)
+        {
+            code -= 0x10000;
+            _str += static_cast<wchar_t>(0xD800 + (code >> 10));
+            _str += static_cast<wchar_t>(0xDC00 + (code & 0x3FF));
+        }
+        else
+        {
+            _str += static_cast<wchar_t>(code);
+        }
+        i += length;
+    }
+    return true;
+}
+
+//-----------------------------------------------------
+// Pages in text files are split on blank lines, so new lines
+// that would make one or start a page are written as \n and
+// lines that look like an entry name get a \ in front
+//-----------------------------------------------------
+wstring mst::EscapePage
+(
+    wstring const & _page
+)
+{
+    wstring const nameStart = L"-------------[";
+
+    wstring page;
+    page.reserve(_page.size());
+    for (size_t i = 0; i < _page.size(); i++)
+    {
+        wchar_t const chr = _page[i];
+        bool const lineStart = i == 0 || _page[i - 1] == L'\n';
+        bool const lineEdge = i == 0 || i + 1 == _page.size() || _page[i - 1] == L'\n' || _page[i + 1] == L'\n';
+        if (chr == L'\\')
+        {
+            page += L"\\\\";
+        }
+        else if (chr == L'\r')
+        {
+            page += L"\\r";
+        }
+        else if (chr == L'\n' && lineEdge)
+        {
+            page += L"\\n";
+        }
+        else if (lineStart && _page.compare(i, nameStart.size(), nameStart) == 0)
+        {
+            page += L"\\-";
+        }
+        else
+        {
+            page += chr;
+        }
+    }
+    return page;
+}
+
+//-----------------------------------------------------
+// Undo EscapePage, other \ are kept for older text files
+//-----------------------------------------------------
+wstring mst::UnescapePage
+(
+    wstring const & _page
+)
+{
+    wstring page;
+    page.reserve(_page.size());
+    for (size_t i = 0; i < _page.size(); i++)
+    {
+        wchar_t chr = _page[i];
+        if (chr == L'\\' && i + 1 < _page.size())
+        {
+            switch (_page[i + 1])
+            {
+            case L'\\': chr = L'\\'; i++; break;
+            case L'n': chr = L'\n'; i++; break;
+            case L'r': chr = L'\r'; i++; break;
+            case L'-': chr = L'-'; i++; break;
+            default: break;
+            }
+        }
+        page += chr;
+    }
+    return page;
 }
 
 //-----------------------------------------------------
@@ -644,14 +1282,18 @@ int mst::Search
     unsigned int _start
 )
 {
-    for (unsigned int i = _start; i < m_entries.size(); i++)
+    TRACE_SCOPE("mst::Search(name)");
+
+    int found = -1;
+    m_entries.ForEach(_start, [&](unsigned int _index, EntryPtr const& _entry) -> bool
     {
-        TextEntry const& entry = m_entries[i];
+        TextEntry const& entry = *_entry;
 
         // Search in name
         if (entry.m_name.find(_str.c_str()) != string::npos)
         {
-            return (int)i;
+            found = (int)_index;
+            return false;
         }
 
         // Search in tags
@@ -659,12 +1301,61 @@ int mst::Search
         {
             if (tag.find(_str.c_str()) != string::npos)
             {
-                return (int)i;
+                found = (int)_index;
+                return false;
+            }
+        }
+
+        return true;
+    });
+
+    return found;
+}
+
+//-----------------------------------------------------
+// Handle of the entry with exactly this name, the first
+// one in order if the name is used more than once
+//-----------------------------------------------------
+mst::Handle mst::FindHandle
+(
+    string const & _name
+)
+{
+    if (!m_nameIndexValid)
+    {
+        BuildNameIndex();
+    }
+
+    auto const range = m_nameIndex.equal_range(_name);
+    if (range.first == range.second) return InvalidHandle;
+
+    Handle handle = range.first->second;
+    if (next(range.first) != range.second)
+    {
+        int firstIndex = m_entries.GetIndex(handle);
+        for (auto iter = next(range.first); iter != range.second; iter++)
+        {
+            int const index = m_entries.GetIndex(iter->second);
+            if (index < firstIndex)
+            {
+                firstIndex = index;
+                handle = iter->second;
             }
         }
     }
+    return handle;
+}
 
-    return -1;
+//-----------------------------------------------------
+// Index of the entry with exactly this name, -1 if none
+//-----------------------------------------------------
+int mst::FindEntry
+(
+    string const & _name
+)
+{
+    Handle const handle = FindHandle(_name);
+    return (handle == InvalidHandle) ? -1 : m_entries.GetIndex(handle);
 }
 
 //-----------------------------------------------------
@@ -676,21 +1367,25 @@ int mst::Search
     unsigned int _start
 )
 {
-    for (unsigned int i = _start; i < m_entries.size(); i++)
-    {
-        TextEntry const& entry = m_entries[i];
+    TRACE_SCOPE("mst::Search(text)");
 
+    int found = -1;
+    m_entries.ForEach(_start, [&](unsigned int _index, EntryPtr const& _entry) -> bool
+    {
         // Search in subtitle
-        for (wstring const& subtitle : entry.m_subtitles)
+        for (wstring const& subtitle : _entry->m_subtitles)
         {
             if (subtitle.find(_str.c_str()) != wstring::npos)
             {
-                return (int)i;
+                found = (int)_index;
+                return false;
             }
         }
-    }
 
-    return -1;
+        return true;
+    });
+
+    return found;
 }
 
 //-----------------------------------------------------
@@ -701,14 +1396,15 @@ void mst::GetAllEntries
     vector<TextEntry>& _textEntries
 )
 {
-    if (m_entries.empty()) return;
+    if (m_entries.Empty()) return;
 
     _textEntries.clear();
-    _textEntries.reserve(m_entries.size());
-    for (TextEntry const& entry : m_entries)
+    _textEntries.reserve(m_entries.Size());
+    m_entries.ForEach(0, [&_textEntries](unsigned int, EntryPtr const& _entry) -> bool
     {
-        _textEntries.push_back(entry);
-    }
+        _textEntries.push_back(*_entry);
+        return true;
+    });
 }
 
 //-----------------------------------------------------
@@ -719,13 +1415,46 @@ mst::TextEntry mst::GetEntry
     unsigned int _id
 )
 {
-    if (_id >= m_entries.size())
+    if (_id >= m_entries.Size())
     {
         assert(false);
         return mst::TextEntry();
     }
 
-    return m_entries[_id];
+    return *m_entries.At(_id);
+}
+
+//-----------------------------------------------------
+// Bytes used by the current entries, shared entries are counted once per document
+//-----------------------------------------------------
+void mst::GetMemoryUsage
+(
+    MemoryUsage& _usage
+)
+{
+    _usage.m_entryCount += m_entries.Size();
+    _usage.m_names += MemoryUsage::GetHeapBytes(m_tableName);
+    _usage.m_containers += static_cast<long long>(m_entries.GetNodeBytes());
+
+    m_entries.ForEach(0, [&_usage](unsigned int, EntryPtr const& _entry) -> bool
+    {
+        TextEntry const& entry = *_entry;
+
+        // The entry and its shared_ptr block, then the vector buffers
+        _usage.m_containers += static_cast<long long>(sizeof(TextEntry) + 2 * sizeof(void*));
+        _usage.m_containers += static_cast<long long>(entry.m_subtitles.capacity() * sizeof(wstring) + entry.m_tags.capacity() * sizeof(string));
+
+        _usage.m_names += MemoryUsage::GetHeapBytes(entry.m_name);
+        for (wstring const& subtitle : entry.m_subtitles)
+        {
+            _usage.m_subtitles += MemoryUsage::GetHeapBytes(subtitle);
+        }
+        for (string const& tag : entry.m_tags)
+        {
+            _usage.m_tags += MemoryUsage::GetHeapBytes(tag);
+        }
+        return true;
+    });
 }
 
 //-----------------------------------------------------
@@ -736,8 +1465,8 @@ int mst::AddNewEntry()
     TextEntry entry;
     entry.m_name = "DUMMY_NAME";
     entry.m_subtitles.push_back(L"DUMMY_SUBTITLE");
-    m_entries.push_back(entry);
-    return m_entries.size() - 1;
+    IndexName(entry.m_name, m_entries.PushBack(MakeEntry(entry)));
+    return m_entries.Size() - 1;
 }
 
 //-----------------------------------------------------
@@ -748,8 +1477,9 @@ void mst::RemoveEntry
     unsigned int _id
 )
 {
-    if (_id >= m_entries.size()) return;
-    m_entries.erase(m_entries.begin() + _id);
+    if (_id >= m_entries.Size()) return;
+    UnindexName(m_entries.At(_id)->m_name, m_entries.GetHandle(_id));
+    m_entries.Erase(_id);
 }
 
 //-----------------------------------------------------
@@ -761,8 +1491,16 @@ void mst::ModifyEntry
     TextEntry const & _entry
 )
 {
-    if (_id >= m_entries.size()) return;
-    m_entries[_id] = _entry;
+    if (_id >= m_entries.Size()) return;
+
+    string const& oldName = m_entries.At(_id)->m_name;
+    if (oldName != _entry.m_name)
+    {
+        Handle const handle = m_entries.GetHandle(_id);
+        UnindexName(oldName, handle);
+        IndexName(_entry.m_name, handle);
+    }
+    m_entries.Set(_id, MakeEntry(_entry));
 }
 
 //-----------------------------------------------------
@@ -774,7 +1512,31 @@ void mst::MoveEntry
     unsigned int _to
 )
 {
-    TextEntry temp = m_entries.at(_from);
-    m_entries.erase(m_entries.begin() + (int)_from);
-    m_entries.insert(m_entries.begin() + (int)_to, temp);
+    // Handles do not change, the name index stays valid
+    m_entries.Move(_from, _to);
+}
+
+//-----------------------------------------------------
+// Move many entries at once, _from[i] ends up at _to[i]
+//-----------------------------------------------------
+bool mst::MoveEntries
+(
+    vector<unsigned int> const & _from,
+    vector<unsigned int> const & _to
+)
+{
+    return m_entries.Move(_from, _to);
+}
+
+//-----------------------------------------------------
+// Replace every entry, e.g. with the result of a merge
+//-----------------------------------------------------
+void mst::SetEntries
+(
+    vector<EntryPtr> const & _entries
+)
+{
+    // Fresh handles, none of the old ones point anywhere after this
+    m_entries.Assign(_entries);
+    m_nameIndexValid = false;
 }
@@ -5,9 +5,15 @@
 //-----------------------------------------------------
 
 #pragma once
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+
+#include "entrystore.h"
+#include "memoryusage.h"
 
 using namespace std;
 
@@ -21,30 +27,62 @@ public:
         vector<string> m_tags;
     };
 
+    // Entries are immutable once stored, edits replace the pointer
+    typedef shared_ptr<TextEntry const> EntryPtr;
+    static EntryPtr MakeEntry(TextEntry _entry);
+
+    // Stable reference to an entry, survives reordering
+    typedef EntryStore<EntryPtr>::Handle Handle;
+    static const Handle InvalidHandle = EntryStore<EntryPtr>::InvalidHandle;
+
+    // Read-only view of a document, O(1) to take and shares all entries
+    // with the live document, safe to use from any thread
+    struct Snapshot
+    {
+        string m_tableName;
+        EntryStore<EntryPtr> m_entries;
+    };
+
+    // Called with (current, total) entries read, return false to cancel
+    typedef function<bool(unsigned int, unsigned int)> ProgressCallback;
+
 public:
     mst();
     ~mst();
 
     bool IsLoaded() { return m_loaded; }
+    void Swap(mst& _other);
 
     // Load & Save
-    bool Load(string const& _fileName, string& _errorMsg);
+    bool Load(string const& _fileName, string& _errorMsg, ProgressCallback const& _progress = nullptr);
     bool Save(string const& _fileName, string& _errorMsg);
+    static bool Save(Snapshot const& _snapshot, string const& _fileName, string& _errorMsg);
+    Snapshot GetSnapshot();
+    void RestoreSnapshot(Snapshot const& _snapshot);
 
-    // Export plain text
-    void Export(string const& _fileName, bool _russian = false);
+    // Export & Import plain text
+    bool Export(string const& _fileName, string& _errorMsg, bool _russian = false);
+    bool Import(string const& _fileName, string& _errorMsg, bool _russian = false);
 
     // Helpers
+    unsigned int GetEntryCount() { return m_entries.Size(); }
+    Handle GetHandle(unsigned int _id) { return m_entries.GetHandle(_id); }
+    int GetIndex(Handle _handle) { return m_entries.GetIndex(_handle); }
     int Search(string const& _str, unsigned int _start = 0);
     int Search(wstring const& _str, unsigned int _start = 0);
+    Handle FindHandle(string const& _name);
+    int FindEntry(string const& _name);
     void GetAllEntries(vector<TextEntry>& _textEntries);
     TextEntry GetEntry(unsigned int _id);
+    void GetMemoryUsage(MemoryUsage& _usage);
 
     // Modifiers
     int AddNewEntry();
     void RemoveEntry(unsigned int _id);
     void ModifyEntry(unsigned int _id, TextEntry const& _entry);
     void MoveEntry(unsigned int _from, unsigned int _to);
+    bool MoveEntries(vector<unsigned int> const& _from, vector<unsigned int> const& _to);
+    void SetEntries(vector<EntryPtr> const& _entries);
 
 private:
     // Reading from bytes
@@ -53,16 +91,33 @@ private:
     wstring ReadUTF16(FILE* _file);
 
     // Writing bytes
-    void WriteInt(FILE* _file, unsigned int _writeInt);
-    void WriteAscii(FILE* _file, string _writeString, bool _termination = true);
-    void WriteUTF16(FILE* _file, wstring _writeString, bool _termination = true);
+    static void WriteInt(FILE* _file, unsigned int _writeInt);
+    static void WriteAscii(FILE* _file, string _writeString, bool _termination = true);
+    static void WriteUTF16(FILE* _file, wstring _writeString, bool _termination = true);
+    static bool SyncFile(FILE* _file);
+    static bool CommitFile(string const& _from, string const& _to);
+
+    // Names and tags in text files
+    static wstring Widen(string const& _str);
+    static string Narrow(wstring const& _str);
+    static string ToUTF8(wstring const& _str);
+    static bool FromUTF8(string const& _bytes, wstring& _str, size_t& _badOffset);
+    static wstring EscapePage(wstring const& _page);
+    static wstring UnescapePage(wstring const& _page);
+
+    // Name index, built on first use after a load or undo
+    void BuildNameIndex();
+    void IndexName(string const& _name, Handle _handle);
+    void UnindexName(string const& _name, Handle _handle);
 
 private:
     bool m_loaded;
     unsigned int m_fileSize;
 
     string m_tableName;
-    vector<TextEntry> m_entries;
+    EntryStore<EntryPtr> m_entries;
+    unordered_multimap<string, Handle> m_nameIndex;
+    bool m_nameIndexValid;
 
     map<wchar_t, wchar_t> m_unicodeToRussian;
     map<wchar_t, wchar_t> m_russianToUnicode;
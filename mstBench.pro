@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# Benchmarks of the mst reader and writer on
+# generated files, no Qt needed
+#
+#-------------------------------------------------
+
+TARGET = mstBench
+TEMPLATE = app
+
+CONFIG += console c++14
+CONFIG -= app_bundle qt
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    bench/benchmain.cpp \
+    bench/corpusgenerator.cpp \
+    corpusstats.cpp \
+    memoryusage.cpp \
+    mst.cpp \
+    mstdiff.cpp \
+    mstmerge.cpp \
+    trace.cpp
+
+HEADERS += \
+    bench/corpusgenerator.h \
+    corpusstats.h \
+    entrystore.h \
+    memoryusage.h \
+    mst.h \
+    mstdiff.h \
+    mstmerge.h \
+    persistentlist.h \
+    trace.h
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -26,13 +26,39 @@ DEFINES += QT_DEPRECATED_WARNINGS
 SOURCES += \
         main.cpp \
         msteditor.cpp \
+    charmapdelegate.cpp \
+    commandline.cpp \
+    corpusstats.cpp \
+    markupparser.cpp \
+    markupvalidator.cpp \
+    memoryusage.cpp \
     mst.cpp \
-    mytreewidget.cpp
+    mstdiff.cpp \
+    mstmerge.cpp \
+    mytreewidget.cpp \
+    overflowanalyzer.cpp \
+    previewrenderer.cpp \
+    subtitlepreview.cpp \
+    trace.cpp
 
 HEADERS += \
         msteditor.h \
+    charmapdelegate.h \
+    commandline.h \
+    corpusstats.h \
+    entrystore.h \
+    markupparser.h \
+    markupvalidator.h \
+    memoryusage.h \
     mst.h \
-    mytreewidget.h
+    mstdiff.h \
+    mstmerge.h \
+    mytreewidget.h \
+    overflowanalyzer.h \
+    persistentlist.h \
+    previewrenderer.h \
+    subtitlepreview.h \
+    trace.h
 
 FORMS += \
         msteditor.ui
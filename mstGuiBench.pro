@@ -0,0 +1,64 @@
+#-------------------------------------------------
+#
+# Interaction latency of the editor, replays scripts
+# with QTest, run with QT_QPA_PLATFORM=offscreen
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent widgets testlib
+
+TARGET = mstGuiBench
+TEMPLATE = app
+
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += $$PWD $$PWD/bench
+
+SOURCES += \
+    bench/corpusgenerator.cpp \
+    bench/guibench.cpp \
+    charmapdelegate.cpp \
+    commandline.cpp \
+    corpusstats.cpp \
+    markupparser.cpp \
+    markupvalidator.cpp \
+    msteditor.cpp \
+    memoryusage.cpp \
+    mst.cpp \
+    mstdiff.cpp \
+    mstmerge.cpp \
+    mytreewidget.cpp \
+    overflowanalyzer.cpp \
+    previewrenderer.cpp \
+    subtitlepreview.cpp \
+    trace.cpp
+
+HEADERS += \
+    bench/corpusgenerator.h \
+    bench/guibench.h \
+    charmapdelegate.h \
+    commandline.h \
+    corpusstats.h \
+    entrystore.h \
+    markupparser.h \
+    markupvalidator.h \
+    memoryusage.h \
+    msteditor.h \
+    mst.h \
+    mstdiff.h \
+    mstmerge.h \
+    mytreewidget.h \
+    overflowanalyzer.h \
+    persistentlist.h \
+    previewrenderer.h \
+    subtitlepreview.h \
+    trace.h
+
+FORMS += \
+    msteditor.ui
+
+RESOURCES += \
+    resource.qrc
@@ -0,0 +1,330 @@
+//-----------------------------------------------------
+// Name: mstdiff.cpp
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#include "mstdiff.h"
+#include "corpusstats.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+MstDiff::MstDiff()
+    : m_unchangedCount(0)
+    , m_oldCount(0)
+    , m_newCount(0)
+{
+    fill(begin(m_counts), end(m_counts), 0);
+}
+
+//-----------------------------------------------------
+// Compare every entry of two files
+//-----------------------------------------------------
+void MstDiff::Compare
+(
+    mst::Snapshot const& _old,
+    mst::Snapshot const& _new
+)
+{
+    vector<mst::EntryPtr> oldEntries;
+    vector<mst::EntryPtr> newEntries;
+    _old.m_entries.ToVector(oldEntries);
+    _new.m_entries.ToVector(newEntries);
+    Compare(oldEntries, newEntries);
+}
+
+//-----------------------------------------------------
+// Match by name, then hash, then the longest run kept in order
+//-----------------------------------------------------
+void MstDiff::Compare
+(
+    vector<mst::EntryPtr> const& _old,
+    vector<mst::EntryPtr> const& _new
+)
+{
+    TRACE_SCOPE("MstDiff::Compare");
+
+    m_changes.clear();
+    fill(begin(m_counts), end(m_counts), 0);
+    m_unchangedCount = 0;
+    m_oldCount = static_cast<int>(_old.size());
+    m_newCount = static_cast<int>(_new.size());
+
+    // Old entries of the same name chained in order, the map has the next one to take
+    unordered_map<string, int> nextByName;
+    nextByName.reserve(_old.size());
+    vector<int> nextOld(_old.size(), -1);
+    for (int i = m_oldCount - 1; i >= 0; i--)
+    {
+        auto const inserted = nextByName.insert(make_pair(_old[i]->m_name, i));
+        if (!inserted.second)
+        {
+            nextOld[i] = inserted.first->second;
+            inserted.first->second = i;
+        }
+    }
+
+    vector<int> oldOfNew(_new.size(), -1);
+    vector<bool> oldMatched(_old.size(), false);
+    vector<int> matched;    // New indices that have an old entry, in order
+    matched.reserve(_new.size());
+    for (int i = 0; i < m_newCount; i++)
+    {
+        auto const iter = nextByName.find(_new[i]->m_name);
+        if (iter == nextByName.end() || iter->second < 0) continue;
+
+        int const oldIndex = iter->second;
+        iter->second = nextOld[oldIndex];
+        oldOfNew[i] = oldIndex;
+        oldMatched[oldIndex] = true;
+        matched.push_back(i);
+    }
+
+    // Longest run of matched entries whose old indices increase, those
+    // stayed in place and everything else moved
+    vector<int> tails;      // Position in matched ending the best run of each length
+    vector<int> previous(matched.size(), -1);
+    for (int m = 0; m < static_cast<int>(matched.size()); m++)
+    {
+        int const oldIndex = oldOfNew[matched[m]];
+        auto const iter = lower_bound(tails.begin(), tails.end(), oldIndex, [&](int _tail, int _index)
+        {
+            return oldOfNew[matched[_tail]] < _index;
+        });
+        if (iter != tails.begin())
+        {
+            previous[m] = *(iter - 1);
+        }
+
+        if (iter == tails.end())
+        {
+            tails.push_back(m);
+        }
+        else
+        {
+            *iter = m;
+        }
+    }
+
+    vector<bool> stayed(_new.size(), false);
+    for (int m = tails.empty() ? -1 : tails.back(); m >= 0; m = previous[m])
+    {
+        stayed[matched[m]] = true;
+    }
+
+    // Removed entries are listed before the first kept entry after them
+    int nextRemoved = 0;
+    auto flushRemoved = [&](int _end)
+    {
+        for (; nextRemoved < _end; nextRemoved++)
+        {
+            if (oldMatched[nextRemoved]) continue;
+
+            EntryChange change;
+            change.m_type = ChangeType::Removed;
+            change.m_name = _old[nextRemoved]->m_name;
+            change.m_oldIndex = nextRemoved;
+            ComparePages(*_old[nextRemoved], mst::TextEntry(), change);
+            m_changes.push_back(change);
+            m_counts[static_cast<int>(ChangeType::Removed)]++;
+        }
+    };
+
+    for (int i = 0; i < m_newCount; i++)
+    {
+        int const oldIndex = oldOfNew[i];
+        if (stayed[i])
+        {
+            flushRemoved(oldIndex);
+            nextRemoved = max(nextRemoved, oldIndex + 1);
+        }
+
+        EntryChange change;
+        change.m_name = _new[i]->m_name;
+        change.m_oldIndex = oldIndex;
+        change.m_newIndex = i;
+        if (oldIndex < 0)
+        {
+            change.m_type = ChangeType::Added;
+            ComparePages(mst::TextEntry(), *_new[i], change);
+        }
+        else if (_old[oldIndex] != _new[i] && (HashEntry(*_old[oldIndex]) != HashEntry(*_new[i]) || !IsSameContent(*_old[oldIndex], *_new[i])))
+        {
+            change.m_type = ChangeType::Changed;
+            change.m_moved = !stayed[i];
+            ComparePages(*_old[oldIndex], *_new[i], change);
+        }
+        else if (!stayed[i])
+        {
+            change.m_type = ChangeType::Moved;
+            change.m_moved = true;
+        }
+        else
+        {
+            m_unchangedCount++;
+            continue;
+        }
+
+        m_changes.push_back(change);
+        m_counts[static_cast<int>(change.m_type)]++;
+    }
+    flushRemoved(m_oldCount);
+}
+
+//-----------------------------------------------------
+// Changes as one JSON object
+//-----------------------------------------------------
+string MstDiff::ToJson
+(
+    string const& _indent
+) const
+{
+    string const inner = _indent + "  ";
+    string json = "{\n";
+    json += inner + "\"old_entries\": " + to_string(m_oldCount) + ",\n";
+    json += inner + "\"new_entries\": " + to_string(m_newCount) + ",\n";
+    json += inner + "\"unchanged\": " + to_string(m_unchangedCount) + ",\n";
+    for (int i = 0; i < static_cast<int>(ChangeType::Count); i++)
+    {
+        json += inner + "\"" + ToString(static_cast<ChangeType>(i)) + "\": " + to_string(m_counts[i]) + ",\n";
+    }
+
+    json += inner + "\"changes\": [";
+    for (unsigned int i = 0; i < m_changes.size(); i++)
+    {
+        EntryChange const& change = m_changes[i];
+        json += string(i ? "," : "") + "\n" + inner + "  {\"type\": \"" + ToString(change.m_type) + "\"";
+        json += ", \"name\": \"" + CorpusStats::EscapeJson(change.m_name) + "\"";
+        json += ", \"old_index\": " + (change.m_oldIndex >= 0 ? to_string(change.m_oldIndex) : "null");
+        json += ", \"new_index\": " + (change.m_newIndex >= 0 ? to_string(change.m_newIndex) : "null");
+        json += string(", \"moved\": ") + (change.m_moved ? "true" : "false");
+
+        json += ", \"pages\": [";
+        for (unsigned int p = 0; p < change.m_pages.size(); p++)
+        {
+            PageChange const& page = change.m_pages[p];
+            json += string(p ? ", " : "") + "{\"page\": " + to_string(page.m_page);
+            json += ", \"old\": " + (page.m_inOld ? "\"" + CorpusStats::EscapeJson(page.m_old) + "\"" : "null");
+            json += ", \"new\": " + (page.m_inNew ? "\"" + CorpusStats::EscapeJson(page.m_new) + "\"" : "null") + "}";
+        }
+
+        json += "], \"tags\": [";
+        for (unsigned int t = 0; t < change.m_tags.size(); t++)
+        {
+            TagChange const& tag = change.m_tags[t];
+            json += string(t ? ", " : "") + "{\"tag\": " + to_string(tag.m_tag);
+            json += ", \"old\": " + (tag.m_inOld ? "\"" + CorpusStats::EscapeJson(tag.m_old) + "\"" : "null");
+            json += ", \"new\": " + (tag.m_inNew ? "\"" + CorpusStats::EscapeJson(tag.m_new) + "\"" : "null") + "}";
+        }
+        json += "]}";
+    }
+    json += m_changes.empty() ? "]\n" : "\n" + inner + "]\n";
+
+    json += _indent + "}";
+    return json;
+}
+
+//-----------------------------------------------------
+// Name of a change in the JSON output
+//-----------------------------------------------------
+char const* MstDiff::ToString
+(
+    ChangeType _type
+)
+{
+    switch (_type)
+    {
+    case ChangeType::Added: return "added";
+    case ChangeType::Removed: return "removed";
+    case ChangeType::Changed: return "changed";
+    case ChangeType::Moved: return "moved";
+    default: return "";
+    }
+}
+
+//-----------------------------------------------------
+// Hash of the pages and tags, counts are mixed in so moving
+// text from one page to the next changes it
+//-----------------------------------------------------
+size_t MstDiff::HashEntry
+(
+    mst::TextEntry const& _entry
+)
+{
+    size_t seed = _entry.m_subtitles.size() * 31 + _entry.m_tags.size();
+    auto combine = [&seed](size_t _hash)
+    {
+        seed ^= _hash + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+
+    for (wstring const& subtitle : _entry.m_subtitles)
+    {
+        combine(hash<wstring>()(subtitle));
+    }
+    for (string const& tag : _entry.m_tags)
+    {
+        combine(hash<string>()(tag));
+    }
+    return seed;
+}
+
+//-----------------------------------------------------
+// Same pages and tags, names are not compared
+//-----------------------------------------------------
+bool MstDiff::IsSameContent
+(
+    mst::TextEntry const& _a,
+    mst::TextEntry const& _b
+)
+{
+    return _a.m_subtitles == _b.m_subtitles && _a.m_tags == _b.m_tags;
+}
+
+//-----------------------------------------------------
+// Pages and tags at the same index that differ
+//-----------------------------------------------------
+void MstDiff::ComparePages
+(
+    mst::TextEntry const& _old,
+    mst::TextEntry const& _new,
+    EntryChange& _change
+)
+{
+    size_t const pageCount = max(_old.m_subtitles.size(), _new.m_subtitles.size());
+    for (size_t p = 0; p < pageCount; p++)
+    {
+        bool const inOld = p < _old.m_subtitles.size();
+        bool const inNew = p < _new.m_subtitles.size();
+        if (inOld && inNew && _old.m_subtitles[p] == _new.m_subtitles[p]) continue;
+
+        PageChange page;
+        page.m_page = static_cast<int>(p);
+        page.m_inOld = inOld;
+        page.m_inNew = inNew;
+        if (inOld) page.m_old = _old.m_subtitles[p];
+        if (inNew) page.m_new = _new.m_subtitles[p];
+        _change.m_pages.push_back(page);
+    }
+
+    size_t const tagCount = max(_old.m_tags.size(), _new.m_tags.size());
+    for (size_t t = 0; t < tagCount; t++)
+    {
+        bool const inOld = t < _old.m_tags.size();
+        bool const inNew = t < _new.m_tags.size();
+        if (inOld && inNew && _old.m_tags[t] == _new.m_tags[t]) continue;
+
+        TagChange tag;
+        tag.m_tag = static_cast<int>(t);
+        tag.m_inOld = inOld;
+        tag.m_inNew = inNew;
+        if (inOld) tag.m_old = _old.m_tags[t];
+        if (inNew) tag.m_new = _new.m_tags[t];
+        _change.m_tags.push_back(tag);
+    }
+}
@@ -0,0 +1,100 @@
+//-----------------------------------------------------
+// Name: mstdiff.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <string>
+#include <vector>
+
+#include "mst.h"
+
+using namespace std;
+
+//-----------------------------------------------------
+// Differences between two versions of a file. Entries are
+// matched by name, the n-th entry of a name with the n-th
+// of the other file, and compared by a hash of their pages
+// and tags so only the ones that differ are looked into.
+// Moved entries are the fewest that explain the new order.
+//-----------------------------------------------------
+class MstDiff
+{
+public:
+    enum class ChangeType : int
+    {
+        Added,
+        Removed,
+        Changed,
+        Moved,      // Same content, only the order changed
+        Count
+    };
+
+    // Page or tag that differs, missing on one side past its end
+    struct PageChange
+    {
+        PageChange():m_page(0),m_inOld(false),m_inNew(false){}
+
+        int m_page;
+        bool m_inOld;
+        bool m_inNew;
+        wstring m_old;
+        wstring m_new;
+    };
+
+    struct TagChange
+    {
+        TagChange():m_tag(0),m_inOld(false),m_inNew(false){}
+
+        int m_tag;
+        bool m_inOld;
+        bool m_inNew;
+        string m_old;
+        string m_new;
+    };
+
+    struct EntryChange
+    {
+        EntryChange():m_type(ChangeType::Changed),m_oldIndex(-1),m_newIndex(-1),m_moved(false){}
+
+        ChangeType m_type;
+        string m_name;
+        int m_oldIndex;     // -1 when added
+        int m_newIndex;     // -1 when removed
+        bool m_moved;       // Changed entries can have moved too
+        vector<PageChange> m_pages;
+        vector<TagChange> m_tags;
+    };
+
+public:
+    MstDiff();
+
+    // Changes are in the order of the new file, removed entries
+    // next to where they were
+    void Compare(mst::Snapshot const& _old, mst::Snapshot const& _new);
+    void Compare(vector<mst::EntryPtr> const& _old, vector<mst::EntryPtr> const& _new);
+
+    vector<EntryChange> const& GetChanges() const { return m_changes; }
+    int GetCount(ChangeType _type) const { return m_counts[static_cast<int>(_type)]; }
+    int GetUnchangedCount() const { return m_unchangedCount; }
+    bool IsEmpty() const { return m_changes.empty(); }
+
+    // _indent is prepended to every line after the first
+    string ToJson(string const& _indent = "") const;
+    static char const* ToString(ChangeType _type);
+
+    // Same pages and tags give the same hash, the name is not included
+    static size_t HashEntry(mst::TextEntry const& _entry);
+    static bool IsSameContent(mst::TextEntry const& _a, mst::TextEntry const& _b);
+
+private:
+    static void ComparePages(mst::TextEntry const& _old, mst::TextEntry const& _new, EntryChange& _change);
+
+private:
+    vector<EntryChange> m_changes;
+    int m_counts[static_cast<int>(ChangeType::Count)];
+    int m_unchangedCount;
+    int m_oldCount;
+    int m_newCount;
+};
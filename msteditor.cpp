@@ -54,6 +54,10 @@ mstEditor::mstEditor(QWidget *parent) :
     m_buttonToString[Button::DPAD] = "button_dpad";
     m_buttonToString[Button::LSTICK] = "button_lstick";
     m_buttonToString[Button::RSTICK] = "button_rstick";
+    m_buttonIcons.resize(Button::COUNT);
+
+    // Tags are decoded once and shared across refreshes
+    m_tagCodec = QTextCodec::codecForName("Shift-JIS");
 
     // Unicode to russian encoding
     QString unicode = "¨ÀÁÂÃÄÅÆÇÈÉÊËÌÍÎÏÐÑÒÓÔÕÖ×ØÙÚÛÜÝÞßàáâãäåæçèéêëìíîïðñòóôõö÷øùúûüýþÿ¸";
@@ -70,24 +74,26 @@ mstEditor::mstEditor(QWidget *parent) :
     ui->LE_SubtitleName->setValidator(v);
     ui->LE_Sound->setValidator(v);
 
+    // Text editor changes are handled as deltas
+    connect(ui->TE_TextEditor->document(), SIGNAL(contentsChange(int,int,int)), this, SLOT(TextEditorContentsChange(int,int,int)));
+
     // Tree view
     ui->TW_TreeWidget->setColumnWidth(0, 150);
+    m_russianDelegate = new CharMapDelegate(m_unicodeToRussian, this);
+    ui->TW_TreeWidget->setItemDelegateForColumn(1, m_russianDelegate);
     ui->TW_TreeWidget->setColumnWidth(1, 320);
 
     // Create a label layout on top of the subtitle background
     QFontDatabase::addApplicationFont(":/resources/FOT-RodinCattleyaPro-DB.otf");
     QFontDatabase::addApplicationFont(":/resources/Nintendo_NTLG-DB_002.ttf");
-    m_previewLabel = new QLabel(ui->L_Preview);
-    m_previewLabel->move(76,31);
-    m_previewLabel->setStyleSheet("font: 27px \"FOT-RodinCattleya Pro DB\"; color: white;");
-    m_previewLabel->setTextFormat(Qt::TextFormat::RichText);
-    QSize previewSize = QSize(792,108);
-    m_previewLabel->setMinimumSize(previewSize);
-    m_previewLabel->setMaximumSize(previewSize);
-    m_previewLabel->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+    m_preview = new SubtitlePreview(ui->L_Preview);
+    m_preview->move(76,31);
+    m_preview->setFixedSize(QSize(792,108));
+    m_preview->SetFont(GetPreviewFont(false));
 
     // Load previous path and window size
-    m_settings = new QSettings("brianuuu", "mstEditor", this);
+    // Native format unless the GUI benchmark changed the default
+    m_settings = new QSettings(QSettings::defaultFormat(), QSettings::UserScope, "brianuuu", "mstEditor", this);
     m_path = m_settings->value("DefaultDirectory", QString()).toString();
     this->resize(m_settings->value("DefaultSize", QSize(1145, 720)).toSize());
 
@@ -99,6 +105,108 @@ mstEditor::mstEditor(QWidget *parent) :
     QShortcut *find = new QShortcut(QKeySequence("Ctrl+F"), this);
     connect(find, SIGNAL(activated()), this, SLOT(on_Shortcut_Find()));
 
+    // Background saving
+    m_fileRevision = 0;
+    m_saveRevision = 0;
+    connect(&m_saveWatcher, SIGNAL(finished()), this, SLOT(SaveFileFinished()));
+
+    // Background loading
+    m_loadProgress = Q_NULLPTR;
+    m_loadShowSuccess = false;
+    m_loadCancelled = false;
+    m_loadResultTaken = true;
+    connect(&m_loadWatcher, SIGNAL(finished()), this, SLOT(LoadFileFinished()));
+
+    // Markup issues, shown below everything once there are some
+    m_issueList = new QTreeWidget(this);
+    m_issueList->setColumnCount(4);
+    m_issueList->setHeaderLabels(QStringList() << "File" << "Entry" << "Page" << "Issue");
+    m_issueList->setRootIsDecorated(false);
+    m_issueList->setUniformRowHeights(true);
+    m_issueList->setColumnWidth(0, 150);
+    m_issueList->setColumnWidth(1, 150);
+    m_issueList->setColumnWidth(2, 50);
+    connect(m_issueList, SIGNAL(itemActivated(QTreeWidgetItem*,int)), this, SLOT(IssueItemActivated(QTreeWidgetItem*,int)));
+    m_issueDock = new QDockWidget("Issues", this);
+    m_issueDock->setObjectName("IssueDock");
+    m_issueDock->setWidget(m_issueList);
+    addDockWidget(Qt::BottomDockWidgetArea, m_issueDock);
+    m_issueDock->hide();
+    m_pendingIssueEntry = -1;
+    m_pendingIssuePage = 0;
+
+    // Folder markup validation
+    m_validateProgress = Q_NULLPTR;
+    connect(&m_validateWatcher, SIGNAL(finished()), this, SLOT(ValidateFolderFinished()));
+
+    // Folder overflow check
+    m_overflowProgress = Q_NULLPTR;
+    connect(&m_overflowWatcher, SIGNAL(finished()), this, SLOT(CheckFolderOverflowFinished()));
+
+    // Differences, changed entries on the left and the two versions of the selected one
+    m_diffList = new QTreeWidget(this);
+    m_diffList->setColumnCount(3);
+    m_diffList->setHeaderLabels(QStringList() << "Change" << "Entry" << "Detail");
+    m_diffList->setRootIsDecorated(false);
+    m_diffList->setUniformRowHeights(true);
+    m_diffList->setColumnWidth(0, 70);
+    m_diffList->setColumnWidth(1, 150);
+    connect(m_diffList, SIGNAL(currentItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)), this, SLOT(DiffItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)));
+    connect(m_diffList, SIGNAL(itemActivated(QTreeWidgetItem*,int)), this, SLOT(DiffItemActivated(QTreeWidgetItem*,int)));
+    m_diffOld = new QTextBrowser(this);
+    m_diffNew = new QTextBrowser(this);
+    QSplitter* diffSplitter = new QSplitter(this);
+    diffSplitter->addWidget(m_diffList);
+    diffSplitter->addWidget(m_diffOld);
+    diffSplitter->addWidget(m_diffNew);
+    m_diffDock = new QDockWidget("Differences", this);
+    m_diffDock->setObjectName("DiffDock");
+    m_diffDock->setWidget(diffSplitter);
+    addDockWidget(Qt::BottomDockWidgetArea, m_diffDock);
+    m_diffDock->hide();
+
+    // Merge conflicts, the list and all three versions of the selected entry
+    m_conflictList = new QTreeWidget(this);
+    m_conflictList->setColumnCount(2);
+    m_conflictList->setHeaderLabels(QStringList() << "Entry" << "Conflict");
+    m_conflictList->setRootIsDecorated(false);
+    m_conflictList->setUniformRowHeights(true);
+    m_conflictList->setColumnWidth(0, 50);
+    connect(m_conflictList, SIGNAL(currentItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)), this, SLOT(ConflictItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)));
+    connect(m_conflictList, SIGNAL(itemActivated(QTreeWidgetItem*,int)), this, SLOT(ConflictItemActivated(QTreeWidgetItem*,int)));
+    m_conflictBase = new QTextBrowser(this);
+    m_conflictOurs = new QTextBrowser(this);
+    m_conflictTheirs = new QTextBrowser(this);
+    QSplitter* conflictSplitter = new QSplitter(this);
+    conflictSplitter->addWidget(m_conflictList);
+    conflictSplitter->addWidget(m_conflictBase);
+    conflictSplitter->addWidget(m_conflictOurs);
+    conflictSplitter->addWidget(m_conflictTheirs);
+    QPushButton* conflictKeep = new QPushButton("Keep Current", this);
+    QPushButton* conflictTheirs = new QPushButton("Use Theirs", this);
+    connect(conflictKeep, SIGNAL(clicked()), this, SLOT(ConflictKeepClicked()));
+    connect(conflictTheirs, SIGNAL(clicked()), this, SLOT(ConflictUseTheirsClicked()));
+    QHBoxLayout* conflictButtons = new QHBoxLayout();
+    conflictButtons->addStretch();
+    conflictButtons->addWidget(conflictKeep);
+    conflictButtons->addWidget(conflictTheirs);
+    QWidget* conflictWidget = new QWidget(this);
+    QVBoxLayout* conflictLayout = new QVBoxLayout(conflictWidget);
+    conflictLayout->addWidget(conflictSplitter);
+    conflictLayout->addLayout(conflictButtons);
+    m_conflictDock = new QDockWidget("Merge Conflicts", this);
+    m_conflictDock->setObjectName("ConflictDock");
+    m_conflictDock->setWidget(conflictWidget);
+    addDockWidget(Qt::BottomDockWidgetArea, m_conflictDock);
+    m_conflictDock->hide();
+
+    // Batch preview rendering
+    m_renderProgress = Q_NULLPTR;
+    connect(&m_renderWatcher, SIGNAL(finished()), this, SLOT(RenderPreviewsFinished()));
+
+    // Text editor changes that are not edits
+    m_convertingText = false;
+
     // Restart
     ResetProgram();
 
@@ -111,8 +219,34 @@ mstEditor::mstEditor(QWidget *parent) :
 //---------------------------------------------------------------------------
 mstEditor::~mstEditor()
 {
+    // Don't leave the worker running on a destroyed editor, the items it
+    // built are still ours if LoadFileFinished hasn't taken them
+    m_loadCancelled = true;
+    m_loadWatcher.waitForFinished();
+    if (!m_loadResultTaken)
+    {
+        qDeleteAll(m_loadWatcher.result().m_items);
+    }
+
+    // Let the pending save commit its file
+    m_saveWatcher.waitForFinished();
+
+    // Stop rendering after the images in progress
+    m_renderWatcher.cancel();
+    m_renderWatcher.waitForFinished();
+
+    // Folder checks stop after the files in progress
+    m_validateWatcher.cancel();
+    m_validateWatcher.waitForFinished();
+    m_overflowWatcher.cancel();
+    m_overflowWatcher.waitForFinished();
+
     m_settings->setValue("DefaultDirectory", m_path);
     m_settings->setValue("DefaultSize", this->size());
+
+    // Unused rows have no parent layout, their widgets belong to the window
+    qDeleteAll(m_buttonRowPool);
+    qDeleteAll(m_colorRowPool);
     delete ui;
 }
 
@@ -121,105 +255,61 @@ mstEditor::~mstEditor()
 //---------------------------------------------------------------------------
 bool mstEditor::eventFilter(QObject *object, QEvent *event)
 {
+    // Only color rows install this filter, find which one was hit
+    QWidget* widget = qobject_cast<QWidget*>(object);
+    ColorWidget const colorWidget = m_colorWidgets.value(widget);
+
     // Changing a color of a color block
-    if (event->type() == QEvent::FocusIn)
+    if (event->type() == QEvent::FocusIn && colorWidget.m_row >= 0)
     {
-        QWidget* widget = qobject_cast<QWidget*>(object);
-        for (int i = 0; i < ui->VL_Colors->layout()->count(); i++)
+        if (colorWidget.m_role == ColorRole::Color)
         {
-            QLayoutItem* colorLayoutItem = ui->VL_Colors->layout()->itemAt(i);
-            if (colorLayoutItem->layout()->itemAt(1)->widget() == widget)
+            widget->clearFocus();
+            QPalette pal = widget->palette();
+            QColor color = pal.color(QPalette::Base);
+            QColor newColor = QColorDialog::getColor(color, this, "Pick a Color");
+            if (newColor.isValid())
             {
-                widget->clearFocus();
-                QPalette pal = widget->palette();
-                QColor color = pal.color(QPalette::Base);
-                QColor newColor = QColorDialog::getColor(color, this, "Pick a Color");
-                if (newColor.isValid())
-                {
-                    // Update color
-                    pal.setColor(QPalette::Base, newColor);
-                    m_colorBlocks[i].m_color.setRgb(newColor.rgb());
-                    widget->setPalette(pal);
-
-                    // Save & Reset buttons
-                    UpdateSubtitlePreview();
-                    SetSubtitleEdited(true);
-                }
-                return true;
+                // Update color
+                pal.setColor(QPalette::Base, newColor);
+                m_colorBlocks[colorWidget.m_row].m_color.setRgb(newColor.rgb());
+                widget->setPalette(pal);
+
+                // Save & Reset buttons
+                UpdateSubtitlePreview();
+                SetSubtitleEdited(true);
             }
+            return true;
         }
 
-        for (int i = 0; i < ui->VL_Colors->layout()->count(); i++)
+        // Look for start or end
+        if (colorWidget.m_role == ColorRole::Start || colorWidget.m_role == ColorRole::End)
         {
-            // Look for start or end
-            QLayoutItem* colorLayoutItem = ui->VL_Colors->layout()->itemAt(i);
-            if (colorLayoutItem->layout()->itemAt(4)->widget() == widget)
-            {
-                UpdateStartEndLimits(i);
-                break;
-            }
-            else if (colorLayoutItem->layout()->itemAt(6)->widget() == widget)
-            {
-                UpdateStartEndLimits(i);
-                break;
-            }
+            UpdateStartEndLimits(colorWidget.m_row);
         }
     }
 
     // Dragging spin boxes
     if (!m_dragSpinBox && event->type() == QEvent::MouseButtonPress)
     {
-        QWidget* widget = qobject_cast<QWidget*>(object);
         m_dragScale = 0;
-        int index = -1;
-        for (int i = 0; i < ui->VL_Colors->layout()->count(); i++)
-        {
-            // Look for alpha
-            QLayoutItem* colorLayoutItem = ui->VL_Colors->layout()->itemAt(i);
-            if (colorLayoutItem->layout()->itemAt(2)->widget() == widget)
-            {
-                index = i;
-                break;
-            }
-        }
-
-        if (index != -1)
+        if (colorWidget.m_role == ColorRole::Alpha)
         {
             m_dragScale = 1;
         }
-        else
+        else if (colorWidget.m_role == ColorRole::Start || colorWidget.m_role == ColorRole::End)
         {
-            index = -1;
-            for (int i = 0; i < ui->VL_Colors->layout()->count(); i++)
-            {
-                // Look for start or end
-                QLayoutItem* colorLayoutItem = ui->VL_Colors->layout()->itemAt(i);
-                if (colorLayoutItem->layout()->itemAt(4)->widget() == widget)
-                {
-                    index = i;
-                    break;
-                }
-                else if (colorLayoutItem->layout()->itemAt(6)->widget() == widget)
-                {
-                    index = i;
-                    break;
-                }
-            }
-
-            if (index != -1)
-            {
-                m_dragScale = 6;
-            }
+            m_dragScale = 6;
         }
 
-        if (m_dragScale != 0)
+        if (colorWidget.m_row >= 0 && m_dragScale != 0)
         {
             QMouseEvent *e = reinterpret_cast<QMouseEvent*>(event);
             m_mouseY = e->y();
             m_dragSpinBox = reinterpret_cast<QSpinBox*>(widget);
             m_initValue = m_dragSpinBox->value();
 
-            UpdateStartEndLimits(index);
+            UpdateStartEndLimits(colorWidget.m_row);
         }
     }
     else if (m_dragSpinBox && event->type() == QEvent::MouseButtonRelease)
@@ -313,50 +403,166 @@ void mstEditor::on_actionOpen_triggered()
 }
 
 //---------------------------------------------------------------------------
-// Opening .mst file
+// Opening .mst file, loading happens in the background
 //---------------------------------------------------------------------------
 void mstEditor::OpenFile(QString const& mstFile, bool showSuccess)
 {
-    if (mstFile.endsWith(".mst"))
+    if (!mstFile.endsWith(".mst"))
     {
-        // Save directory
-        QFileInfo info(mstFile);
-        m_path = info.dir().absolutePath();
+        QMessageBox::critical(this, "Error", "Unsupported format!", QMessageBox::Ok);
+        return;
+    }
 
-        // Load fco file
-        string errorMsg;
-        if (!m_mst.Load(mstFile.toStdString(), errorMsg))
+    // Only one file can be opened at a time, including one whose
+    // result is still waiting for LoadFileFinished
+    if (!m_loadResultTaken) return;
+
+    // Save directory
+    QFileInfo info(mstFile);
+    m_path = info.dir().absolutePath();
+
+    m_loadFileName = mstFile;
+    m_loadShowSuccess = showSuccess;
+    m_loadCancelled = false;
+    m_loadResultTaken = false;
+
+    // Current document stays untouched until the new one is ready
+    m_loadProgress = new QProgressDialog("Opening " + info.fileName() + "...", "Cancel", 0, 100, this);
+    m_loadProgress->setWindowTitle("Open");
+    m_loadProgress->setWindowModality(Qt::WindowModal);
+    m_loadProgress->setMinimumDuration(250);
+    m_loadProgress->setAutoClose(false);
+    m_loadProgress->setAutoReset(false);
+    m_loadProgress->setValue(0);
+    connect(m_loadProgress, SIGNAL(canceled()), this, SLOT(LoadFileCancelled()));
+
+    m_loadWatcher.setFuture(QtConcurrent::run(this, &mstEditor::LoadFileWorker, mstFile));
+}
+
+//---------------------------------------------------------------------------
+// Load file and build tree items, runs on a worker thread
+//---------------------------------------------------------------------------
+mstEditor::LoadResult mstEditor::LoadFileWorker(QString const& _mstFile)
+{
+    LoadResult result;
+    result.m_mst.reset(new mst());
+
+    // Reading entries is the first half of the progress, tree items the second
+    int lastPercent = 0;
+    auto reportProgress = [&](unsigned int _current, unsigned int _total, int _offset) -> bool
+    {
+        int const percent = _offset + (_total ? static_cast<int>(50ull * _current / _total) : 50);
+        if (percent != lastPercent)
         {
-            ResetProgram();
-            QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
+            lastPercent = percent;
+            QMetaObject::invokeMethod(m_loadProgress, "setValue", Qt::QueuedConnection, Q_ARG(int, percent));
         }
-        else
+        return !m_loadCancelled;
+    };
+
+    string errorMsg;
+    mst::ProgressCallback loadProgress = [&](unsigned int _current, unsigned int _total) -> bool
+    {
+        return reportProgress(_current, _total, 0);
+    };
+    if (!result.m_mst->Load(_mstFile.toStdString(), errorMsg, loadProgress))
+    {
+        result.m_cancelled = m_loadCancelled;
+        result.m_errorMsg = QString::fromStdString(errorMsg);
+        return result;
+    }
+
+    vector<mst::TextEntry> entries;
+    result.m_mst->GetAllEntries(entries);
+
+    result.m_validation.m_fileName = _mstFile;
+    MarkupValidator const validator;
+
+    result.m_items.reserve(static_cast<int>(entries.size()));
+    for (unsigned int i = 0; i < entries.size(); i++)
+    {
+        if (!reportProgress(i, entries.size(), 50))
         {
-            ResetProgram();
+            result.m_cancelled = true;
+            return result;
+        }
 
-            // Update local entries and tree view
-            TW_Refresh();
+        // Not attached to the tree yet, safe to fill outside GUI thread
+        QTreeWidgetItem* item = new QTreeWidgetItem();
+        TW_SetItemText(item, entries[i]);
+        result.m_items.push_back(item);
 
-            m_fileName = mstFile;
-            int index = m_fileName.lastIndexOf('\\');
-            if (index == -1) index = m_fileName.lastIndexOf('/');
-            ui->L_FileName->setText("File Name: " + m_fileName.mid(index + 1));
+        validator.Validate(entries[i], static_cast<int>(i), result.m_validation);
+    }
 
-            // Enable search
-            ui->LE_Find->setEnabled(true);
-            ui->RB_Top->setEnabled(true);
-            ui->RB_Current->setEnabled(true);
-            ui->PB_Find->setEnabled(true);
+    result.m_success = true;
+    return result;
+}
 
-            if (showSuccess)
-            {
-                QMessageBox::information(this, "Open", "File load successful!", QMessageBox::Ok);
-            }
+//---------------------------------------------------------------------------
+// Cancel button pressed on the loading progress dialog
+//---------------------------------------------------------------------------
+void mstEditor::LoadFileCancelled()
+{
+    m_loadCancelled = true;
+}
+
+//---------------------------------------------------------------------------
+// Background loading finished, swap in the new document
+//---------------------------------------------------------------------------
+void mstEditor::LoadFileFinished()
+{
+    LoadResult result = m_loadWatcher.result();
+    m_loadResultTaken = true;
+
+    m_loadProgress->deleteLater();
+    m_loadProgress = Q_NULLPTR;
+
+    if (result.m_cancelled || !result.m_success)
+    {
+        // Keep the current document
+        qDeleteAll(result.m_items);
+        m_pendingIssueName.clear();
+        if (!result.m_cancelled)
+        {
+            QMessageBox::critical(this, "Error", result.m_errorMsg, QMessageBox::Ok);
         }
+        return;
     }
-    else
+
+    ResetProgram();
+
+    // Update local entries and tree view
+    m_mst.Swap(*result.m_mst);
+    ui->TW_TreeWidget->clear();
+    ui->TW_TreeWidget->addTopLevelItems(result.m_items);
+    ui->PB_SubtitleAdd->setEnabled(!result.m_items.isEmpty());
+
+    m_fileName = m_loadFileName;
+    int index = m_fileName.lastIndexOf('\\');
+    if (index == -1) index = m_fileName.lastIndexOf('/');
+    ui->L_FileName->setText("File Name: " + m_fileName.mid(index + 1));
+
+    // Enable search
+    ui->LE_Find->setEnabled(true);
+    ui->RB_Top->setEnabled(true);
+    ui->RB_Current->setEnabled(true);
+    ui->PB_Find->setEnabled(true);
+
+    if (!m_pendingIssueName.isEmpty())
     {
-        QMessageBox::critical(this, "Error", "Unsupported format!", QMessageBox::Ok);
+        // Opened from the issue list, keep the list and go to the issue
+        GoToIssue(m_pendingIssueName, m_pendingIssueEntry, m_pendingIssuePage);
+        m_pendingIssueName.clear();
+    }
+    else if (SetIssues(QList<MarkupValidator::Report>() << result.m_validation) > 0)
+    {
+        statusBar()->showMessage(QString::number(result.m_validation.m_issues.size()) + " markup issues found, see the issue list.", 5000);
+    }
+
+    if (m_loadShowSuccess)
+    {
+        QMessageBox::information(this, "Open", "File load successful!", QMessageBox::Ok);
     }
 }
 
@@ -376,16 +582,7 @@ void mstEditor::on_actionSave_triggered()
     }
 
     // Save fco file
-    string errorMsg;
-    if (!m_mst.Save(m_fileName.toStdString(), errorMsg))
-    {
-        QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
-    }
-    else
-    {
-        m_fileEdited = false;
-        QMessageBox::information(this, "Save", "File save successful!", QMessageBox::Ok);
-    }
+    SaveFile(m_fileName, "Save");
 }
 
 //---------------------------------------------------------------------------
@@ -417,16 +614,57 @@ void mstEditor::on_actionSave_as_triggered()
     m_path = info.dir().absolutePath();
 
     // Save fco file
-    string errorMsg;
-    if (!m_mst.Save(mstFile.toStdString(), errorMsg))
+    SaveFile(mstFile, "Save As");
+}
+
+//---------------------------------------------------------------------------
+// Save a snapshot of the entries in the background, editing can continue
+//---------------------------------------------------------------------------
+void mstEditor::SaveFile(QString const& _mstFile, QString const& _title)
+{
+    if (m_saveWatcher.isRunning())
     {
-        QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
+        QMessageBox::warning(this, _title, "Another save is still in progress, please try again later.", QMessageBox::Ok);
+        return;
     }
-    else
+
+    m_saveTitle = _title;
+    m_saveRevision = m_fileRevision;
+
+    mst::Snapshot const snapshot = m_mst.GetSnapshot();
+    string const fileName = _mstFile.toStdString();
+    m_saveWatcher.setFuture(QtConcurrent::run([snapshot, fileName]() -> SaveResult
+    {
+        SaveResult result;
+        string errorMsg;
+        result.m_success = mst::Save(snapshot, fileName, errorMsg);
+        result.m_errorMsg = QString::fromStdString(errorMsg);
+        return result;
+    }));
+
+    statusBar()->showMessage("Saving " + QFileInfo(_mstFile).fileName() + "...");
+}
+
+//---------------------------------------------------------------------------
+// Background saving finished
+//---------------------------------------------------------------------------
+void mstEditor::SaveFileFinished()
+{
+    SaveResult const result = m_saveWatcher.result();
+    statusBar()->clearMessage();
+
+    if (!result.m_success)
+    {
+        QMessageBox::critical(this, "Error", result.m_errorMsg, QMessageBox::Ok);
+        return;
+    }
+
+    // Edits made while saving are not in the file
+    if (m_saveRevision == m_fileRevision)
     {
-        m_fileEdited = false;
-        QMessageBox::information(this, "Save As", "File save successful!", QMessageBox::Ok);
+        SetFileEdited(false);
     }
+    QMessageBox::information(this, m_saveTitle, "File save successful!", QMessageBox::Ok);
 }
 
 //---------------------------------------------------------------------------
@@ -447,7 +685,13 @@ void mstEditor::on_actionExport_triggered()
     int index = m_fileName.indexOf(".mst");
     QString fullTextFileName = m_fileName.mid(0, index) + ".txt";
 
-    m_mst.Export(fullTextFileName.toStdString(), ui->CB_Russian->isChecked());
+    string errorMsg;
+    if (!m_mst.Export(fullTextFileName.toStdString(), errorMsg, ui->CB_Russian->isChecked()))
+    {
+        QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
+        return;
+    }
+
     QString fileName = fullTextFileName.mid(m_fileName.lastIndexOf('/') + 1);
     QMessageBox::information(this, "Export", fileName + " has been exported at the same directory!", QMessageBox::Ok);
 
@@ -456,139 +700,953 @@ void mstEditor::on_actionExport_triggered()
 }
 
 //---------------------------------------------------------------------------
-// Close application
+// Render every page of the current file to PNG
 //---------------------------------------------------------------------------
-void mstEditor::on_actionClose_triggered()
+void mstEditor::on_actionRenderPreviews_triggered()
 {
-    if (m_mst.IsLoaded())
+    if (!m_mst.IsLoaded() || m_renderWatcher.isRunning())
     {
-        if (!DiscardSaveMessage("Close", "Quit without saving?", true))
+        return;
+    }
+
+    if (!DiscardSaveMessage("Render Previews", "You have not applied changes yet, continue without applying?", false))
+    {
+        return;
+    }
+
+    QString outputDir = QFileDialog::getExistingDirectory(this, tr("Render Previews To"), m_pngPath.isEmpty() ? m_path : m_pngPath);
+    if (outputDir.isEmpty()) return;
+    m_pngPath = outputDir;
+
+    // Snapshot shares all entries, editing can continue while rendering
+    mst::Snapshot const snapshot = m_mst.GetSnapshot();
+    QString const fileDir = outputDir + "/" + QFileInfo(m_fileName).completeBaseName();
+
+    // Small batches so all threads are busy and cancel is quick
+    int const batchSize = 32;
+    QList<PreviewRenderer::Job> jobs;
+    snapshot.m_entries.ForEach(0, [&](unsigned int _index, mst::EntryPtr const& _entry) -> bool
+    {
+        if (_index % batchSize == 0)
         {
-            return;
+            PreviewRenderer::Job job;
+            job.m_firstIndex = static_cast<int>(_index);
+            job.m_outputDir = fileDir;
+            jobs.push_back(job);
         }
-    }
+        jobs.back().m_entries.push_back(_entry);
+        return true;
+    });
 
-    QApplication::quit();
+    RenderPreviews(jobs, fileDir);
 }
 
 //---------------------------------------------------------------------------
-// About mstEditor
+// Render every page of every file in a folder to PNG
 //---------------------------------------------------------------------------
-void mstEditor::on_actionAbout_mstEditor_triggered()
+void mstEditor::on_actionRenderFolderPreviews_triggered()
 {
-    QString message = "mstEditor - Sonic the Hedgehog (2006) Subtitle Editor v2.2";
-    message += "\nCreated by brianuuu 2025";
-    message += "\nYoutube: brianuuuSonic";
-    message += "\nSpecial Thanks: N69vid - Beta testing, Russian mapping";
-    message += "\n\nv1.0 - Initial Release";
-    message += "\nv2.0 - Added Color Support";
-    message += "\nv2.1 - Bug Fix on able to add color to sound before";
-    message += "\nv2.2 - Allow drag reorder, mapped d-pad";
-    QMessageBox::information(this, "About mstEditor", message, QMessageBox::Ok);
-}
+    if (m_renderWatcher.isRunning()) return;
 
-//---------------------------------------------------------------------------
-// About Qt
-//---------------------------------------------------------------------------
-void mstEditor::on_actionAbout_Qt_triggered()
-{
-    QMessageBox::aboutQt(this, "About Qt");
+    QString inputDir = QFileDialog::getExistingDirectory(this, tr("Render Previews From"), m_path);
+    if (inputDir.isEmpty()) return;
+
+    QStringList mstFiles = QDir(inputDir).entryList(QStringList() << "*.mst", QDir::Files, QDir::Name);
+    if (mstFiles.isEmpty())
+    {
+        QMessageBox::warning(this, "Render Previews", "No .mst files found in " + inputDir, QMessageBox::Ok);
+        return;
+    }
+
+    QString outputDir = QFileDialog::getExistingDirectory(this, tr("Render Previews To"), m_pngPath.isEmpty() ? inputDir : m_pngPath);
+    if (outputDir.isEmpty()) return;
+    m_pngPath = outputDir;
+
+    // Each file is loaded and rendered on its own thread
+    QList<PreviewRenderer::Job> jobs;
+    for (QString const& mstFile : mstFiles)
+    {
+        PreviewRenderer::Job job;
+        job.m_fileName = inputDir + "/" + mstFile;
+        job.m_outputDir = outputDir + "/" + QFileInfo(mstFile).completeBaseName();
+        jobs.push_back(job);
+    }
+
+    RenderPreviews(jobs, outputDir);
 }
 
 //---------------------------------------------------------------------------
-// Closing application
+// Mark entries in the current file that don't fit in the text box
 //---------------------------------------------------------------------------
-void mstEditor::closeEvent (QCloseEvent *event)
+void mstEditor::on_actionCheckOverflow_triggered()
 {
-    if (m_mst.IsLoaded())
+    if (!m_mst.IsLoaded()) return;
+
+    // Kept so entries edited later are checked again with the same settings
+    m_overflowAnalyzer.reset(new OverflowAnalyzer(GetOverflowOptions()));
+
+    OverflowAnalyzer::Report report;
+    vector<mst::EntryPtr> entries;
+    m_mst.GetSnapshot().m_entries.ToVector(entries);
+    m_overflowAnalyzer->Analyze(entries, report);
+
+    QMap<int, QStringList> entryIssues;
+    for (OverflowAnalyzer::Issue const& issue : report.m_issues)
     {
-        if (!DiscardSaveMessage("Close", "Quit without saving?", true))
+        entryIssues[issue.m_entry].push_back(OverflowAnalyzer::ToString(issue));
+    }
+
+    for (int i = 0; i < ui->TW_TreeWidget->topLevelItemCount(); i++)
+    {
+        TW_SetItemOverflow(ui->TW_TreeWidget->topLevelItem(i), entryIssues.value(i));
+    }
+
+    QString message = QString::number(report.m_pageCount) + " pages checked, ";
+    message += QString::number(entryIssues.size()) + " subtitles don't fit in the text box.";
+    QMessageBox messageBox(entryIssues.isEmpty() ? QMessageBox::Information : QMessageBox::Warning, "Check Text Overflow", message, QMessageBox::Ok, this);
+    if (!entryIssues.isEmpty())
+    {
+        QStringList lines;
+        for (OverflowAnalyzer::Issue const& issue : report.m_issues)
         {
-            event->ignore();
-            return;
+            lines.push_back(OverflowAnalyzer::ToString(issue));
         }
+        messageBox.setDetailedText(lines.join("\n"));
     }
-
-    event->accept();
+    messageBox.exec();
 }
 
 //---------------------------------------------------------------------------
-// Alt+S
+// Check every file in a folder, one file per thread
 //---------------------------------------------------------------------------
-void mstEditor::on_Shortcut_ApplyChanges()
+void mstEditor::on_actionCheckFolderOverflow_triggered()
 {
-    if (ui->PB_Save->isEnabled())
+    if (m_overflowWatcher.isRunning()) return;
+
+    QString inputDir = QFileDialog::getExistingDirectory(this, tr("Check Text Overflow"), m_path);
+    if (inputDir.isEmpty()) return;
+
+    QStringList mstFiles;
+    for (QString const& mstFile : QDir(inputDir).entryList(QStringList() << "*.mst", QDir::Files, QDir::Name))
     {
-        on_PB_Save_clicked();
+        mstFiles.push_back(inputDir + "/" + mstFile);
     }
+
+    m_overflowProgress = new QProgressDialog("Checking text overflow...", "Cancel", 0, mstFiles.size(), this);
+    m_overflowProgress->setWindowTitle("Check Text Overflow");
+    m_overflowProgress->setWindowModality(Qt::WindowModal);
+    m_overflowProgress->setMinimumDuration(250);
+    m_overflowProgress->setAutoClose(false);
+    m_overflowProgress->setAutoReset(false);
+    m_overflowProgress->setValue(0);
+    connect(&m_overflowWatcher, SIGNAL(progressValueChanged(int)), m_overflowProgress, SLOT(setValue(int)));
+    connect(m_overflowProgress, SIGNAL(canceled()), &m_overflowWatcher, SLOT(cancel()));
+
+    m_overflowWatcher.setFuture(QtConcurrent::mapped(mstFiles, OverflowAnalyzer(GetOverflowOptions())));
 }
 
 //---------------------------------------------------------------------------
-// Alt+R
+// All files of the folder are checked or cancelled
 //---------------------------------------------------------------------------
-void mstEditor::on_Shortcut_ResetSubtitle()
+void mstEditor::CheckFolderOverflowFinished()
 {
-    if (ui->PB_Reset->isEnabled())
+    m_overflowProgress->deleteLater();
+    m_overflowProgress = Q_NULLPTR;
+
+    // Files that finished before cancelling still have their results
+    QList<OverflowAnalyzer::Report> const reports = m_overflowWatcher.future().results();
+    int pageCount = 0;
+    int issueCount = 0;
+    QStringList lines;
+    for (OverflowAnalyzer::Report const& report : reports)
     {
-        on_PB_Reset_clicked();
+        QString const fileName = QFileInfo(report.m_fileName).fileName();
+        if (!report.m_errorMsg.isEmpty())
+        {
+            lines.push_back(fileName + ": " + report.m_errorMsg);
+        }
+
+        pageCount += report.m_pageCount;
+        issueCount += report.m_issues.size();
+        for (OverflowAnalyzer::Issue const& issue : report.m_issues)
+        {
+            lines.push_back(fileName + ": " + OverflowAnalyzer::ToString(issue));
+        }
+    }
+
+    QString message = QString::number(reports.size()) + " files and " + QString::number(pageCount) + " pages checked, ";
+    message += QString::number(issueCount) + " lines or pages don't fit in the text box.";
+    if (m_overflowWatcher.isCanceled())
+    {
+        message = "Check cancelled, " + message;
+    }
+    QMessageBox messageBox(lines.isEmpty() ? QMessageBox::Information : QMessageBox::Warning, "Check Text Overflow", message, QMessageBox::Ok, this);
+    if (!lines.isEmpty())
+    {
+        messageBox.setDetailedText(lines.join("\n"));
     }
+    messageBox.exec();
 }
 
 //---------------------------------------------------------------------------
-// Ctrl+F
+// Check the markup of every entry in the current file again
 //---------------------------------------------------------------------------
-void mstEditor::on_Shortcut_Find()
+void mstEditor::on_actionValidate_triggered()
 {
-    if (ui->LE_Find->isEnabled())
+    if (!m_mst.IsLoaded()) return;
+
+    MarkupValidator::Report report;
+    report.m_fileName = m_fileName;
+    vector<mst::EntryPtr> entries;
+    m_mst.GetSnapshot().m_entries.ToVector(entries);
+    MarkupValidator().Validate(entries, report);
+
+    if (SetIssues(QList<MarkupValidator::Report>() << report) == 0)
     {
-        ui->LE_Find->setFocus();
-        ui->LE_Find->selectAll();
+        QMessageBox::information(this, "Validate Markup", QString::number(report.m_entryCount) + " subtitles checked, no issues found.", QMessageBox::Ok);
     }
 }
 
 //---------------------------------------------------------------------------
-// Resetting all buttons and data
+// Check every file in a folder, one file per thread
 //---------------------------------------------------------------------------
-void mstEditor::ResetProgram()
+void mstEditor::on_actionValidateFolder_triggered()
 {
-    m_fileEdited = false;
+    if (m_validateWatcher.isRunning()) return;
 
-    ui->L_FileName->setText("File Name: ---");
+    QString inputDir = QFileDialog::getExistingDirectory(this, tr("Validate Markup"), m_path);
+    if (inputDir.isEmpty()) return;
 
-    ResetEditor();
+    QStringList mstFiles;
+    for (QString const& mstFile : QDir(inputDir).entryList(QStringList() << "*.mst", QDir::Files, QDir::Name))
+    {
+        mstFiles.push_back(inputDir + "/" + mstFile);
+    }
 
-    ui->PB_SubtitleAdd->setEnabled(false);
-    ui->PB_SubtitleDelete->setEnabled(false);
-    ui->TW_TreeWidget->scrollToTop();
+    m_validateProgress = new QProgressDialog("Validating markup...", "Cancel", 0, mstFiles.size(), this);
+    m_validateProgress->setWindowTitle("Validate Markup");
+    m_validateProgress->setWindowModality(Qt::WindowModal);
+    m_validateProgress->setMinimumDuration(250);
+    m_validateProgress->setAutoClose(false);
+    m_validateProgress->setAutoReset(false);
+    m_validateProgress->setValue(0);
+    connect(&m_validateWatcher, SIGNAL(progressValueChanged(int)), m_validateProgress, SLOT(setValue(int)));
+    connect(m_validateProgress, SIGNAL(canceled()), &m_validateWatcher, SLOT(cancel()));
 
-    ui->LE_Find->setEnabled(false);
-    ui->RB_Top->setEnabled(false);
-    ui->RB_Current->setEnabled(false);
-    ui->PB_Find->setEnabled(false);
+    m_validateWatcher.setFuture(QtConcurrent::mapped(mstFiles, MarkupValidator()));
 }
 
 //---------------------------------------------------------------------------
-// Reset subtitle editor
+// All files of the folder are validated or cancelled
 //---------------------------------------------------------------------------
-void mstEditor::ResetEditor()
+void mstEditor::ValidateFolderFinished()
 {
-    ui->LE_SubtitleName->setEnabled(false);
-    ui->LE_SubtitleName->setText("");
-
-    m_id = -1;
-    m_page = -1;
-    m_name.clear();
-    m_subtitles.clear();
-    m_tags.clear();
+    m_validateProgress->deleteLater();
+    m_validateProgress = Q_NULLPTR;
 
-    m_initValue = 0;
-    m_mouseY = 0;
-    m_dragScale = 0;
-    m_dragSpinBox = Q_NULLPTR;
+    // Files that finished before cancelling still have their results
+    QList<MarkupValidator::Report> const reports = m_validateWatcher.future().results();
+    int entryCount = 0;
+    for (MarkupValidator::Report const& report : reports)
+    {
+        entryCount += report.m_entryCount;
+    }
+
+    int const issueCount = SetIssues(reports);
+    QString message = QString::number(reports.size()) + " files and " + QString::number(entryCount) + " subtitles checked, ";
+    message += QString::number(issueCount) + " issues found.";
+    if (m_validateWatcher.isCanceled())
+    {
+        message = "Validation cancelled, " + message;
+    }
+    QMessageBox::information(this, "Validate Markup", message, QMessageBox::Ok);
+}
+
+//---------------------------------------------------------------------------
+// Fill the issue list, returns the number of rows
+//---------------------------------------------------------------------------
+int mstEditor::SetIssues(QList<MarkupValidator::Report> const& _reports)
+{
+    m_issueList->clear();
+
+    QList<QTreeWidgetItem*> items;
+    for (MarkupValidator::Report const& report : _reports)
+    {
+        QString const fileName = QFileInfo(report.m_fileName).fileName();
+        if (!report.m_errorMsg.isEmpty())
+        {
+            QTreeWidgetItem* item = new QTreeWidgetItem();
+            item->setText(0, fileName);
+            item->setText(3, report.m_errorMsg);
+            items.push_back(item);
+            continue;
+        }
+
+        for (MarkupValidator::Issue const& issue : report.m_issues)
+        {
+            QTreeWidgetItem* item = new QTreeWidgetItem();
+            item->setText(0, fileName);
+            item->setData(0, Qt::UserRole, report.m_fileName);
+            item->setText(1, issue.m_name);
+            item->setData(1, Qt::UserRole, issue.m_entry);
+            item->setText(2, issue.m_page >= 0 ? QString::number(issue.m_page + 1) : QString());
+            item->setData(2, Qt::UserRole, qMax(issue.m_page, 0));
+            item->setText(3, MarkupValidator::ToString(issue));
+            if (!MarkupValidator::IsError(issue.m_type))
+            {
+                item->setForeground(3, QColor(128,128,128));
+            }
+            items.push_back(item);
+        }
+    }
+
+    m_issueList->addTopLevelItems(items);
+    m_issueDock->setVisible(!items.isEmpty());
+    return items.size();
+}
+
+//---------------------------------------------------------------------------
+// Issue double clicked, open its file if needed and load the subtitle
+//---------------------------------------------------------------------------
+void mstEditor::IssueItemActivated(QTreeWidgetItem *item, int column)
+{
+    Q_UNUSED(column)
+
+    QString const fileName = item->data(0, Qt::UserRole).toString();
+    QString const name = item->text(1);
+    int const entry = item->data(1, Qt::UserRole).toInt();
+    int const page = item->data(2, Qt::UserRole).toInt();
+
+    // File could not be loaded, nothing to go to
+    if (fileName.isEmpty()) return;
+
+    if (m_mst.IsLoaded() && QFileInfo(fileName) == QFileInfo(m_fileName))
+    {
+        GoToIssue(name, entry, page);
+        return;
+    }
+
+    if (!DiscardSaveMessage("Open", "You have unsaved changes, continue without saving?", true))
+    {
+        return;
+    }
+
+    m_pendingIssueName = name;
+    m_pendingIssueEntry = entry;
+    m_pendingIssuePage = page;
+    OpenFile(fileName, false);
+}
+
+//---------------------------------------------------------------------------
+// Load the subtitle of an issue, by name if entries were moved since
+//---------------------------------------------------------------------------
+void mstEditor::GoToIssue(QString const& _name, int _entry, int _page)
+{
+    if (!DiscardSaveMessage("Discard", "Discard unsaved changes?", false))
+    {
+        return;
+    }
+
+    string const name = _name.toStdString();
+    int id = _entry;
+    if (id < 0 || id >= static_cast<int>(m_mst.GetEntryCount()) || m_mst.GetEntry(static_cast<unsigned int>(id)).m_name != name)
+    {
+        id = m_mst.FindEntry(name);
+    }
+    if (id < 0) return;
+
+    TW_FocusItem(id);
+    LoadSubtitle(id, _page);
+}
+
+//---------------------------------------------------------------------------
+// Compare the current document with another version of the file
+//---------------------------------------------------------------------------
+void mstEditor::on_actionCompare_triggered()
+{
+    if (!m_mst.IsLoaded()) return;
+
+    QString oldFile = QFileDialog::getOpenFileName(this, tr("Compare With"), m_path, "MST File (*.mst)");
+    if (oldFile == Q_NULLPTR) return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    mst other;
+    string errorMsg;
+    bool const loaded = other.Load(oldFile.toStdString(), errorMsg);
+    if (loaded)
+    {
+        m_diffOldSnapshot = other.GetSnapshot();
+        m_diffNewSnapshot = m_mst.GetSnapshot();
+        m_diff.Compare(m_diffOldSnapshot, m_diffNewSnapshot);
+    }
+    QApplication::restoreOverrideCursor();
+
+    if (!loaded)
+    {
+        QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
+        return;
+    }
+
+    if (SetDiff(oldFile) == 0)
+    {
+        QMessageBox::information(this, "Compare", "No differences found.", QMessageBox::Ok);
+    }
+}
+
+//---------------------------------------------------------------------------
+// Fill the difference list from m_diff, returns the number of rows
+//---------------------------------------------------------------------------
+int mstEditor::SetDiff(QString const& _oldFileName)
+{
+    m_diffList->clear();
+    m_diffOld->clear();
+    m_diffNew->clear();
+
+    QList<QTreeWidgetItem*> items;
+    vector<MstDiff::EntryChange> const& changes = m_diff.GetChanges();
+    for (unsigned int i = 0; i < changes.size(); i++)
+    {
+        MstDiff::EntryChange const& change = changes[i];
+
+        QString detail;
+        QColor color(0,0,0);
+        switch (change.m_type)
+        {
+        case MstDiff::ChangeType::Added:
+            detail = QString::number(change.m_pages.size()) + " pages";
+            color = QColor(0,128,0);
+            break;
+        case MstDiff::ChangeType::Removed:
+            detail = QString::number(change.m_pages.size()) + " pages";
+            color = QColor(192,0,0);
+            break;
+        case MstDiff::ChangeType::Changed:
+            detail = QString::number(change.m_pages.size()) + " pages, " + QString::number(change.m_tags.size()) + " tags differ";
+            if (change.m_moved) detail += ", moved";
+            break;
+        default:
+            detail = QString("%1 -> %2").arg(change.m_oldIndex + 1).arg(change.m_newIndex + 1);
+            color = QColor(128,128,128);
+            break;
+        }
+
+        QTreeWidgetItem* item = new QTreeWidgetItem();
+        item->setText(0, MstDiff::ToString(change.m_type));
+        item->setData(0, Qt::UserRole, i);
+        item->setForeground(0, color);
+        item->setText(1, QString::fromStdString(change.m_name));
+        item->setText(2, detail);
+        items.push_back(item);
+    }
+
+    m_diffList->addTopLevelItems(items);
+    m_diffDock->setWindowTitle("Differences to " + QFileInfo(_oldFileName).fileName());
+    m_diffDock->setVisible(!items.isEmpty());
+
+    QString message = QString::number(m_diff.GetCount(MstDiff::ChangeType::Added)) + " added, ";
+    message += QString::number(m_diff.GetCount(MstDiff::ChangeType::Removed)) + " removed, ";
+    message += QString::number(m_diff.GetCount(MstDiff::ChangeType::Changed)) + " changed, ";
+    message += QString::number(m_diff.GetCount(MstDiff::ChangeType::Moved)) + " moved.";
+    statusBar()->showMessage(message, 5000);
+    return items.size();
+}
+
+//---------------------------------------------------------------------------
+// Show both versions of the selected entry side by side
+//---------------------------------------------------------------------------
+void mstEditor::DiffItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous)
+{
+    Q_UNUSED(previous)
+    if (!current) return;
+
+    MstDiff::EntryChange const& change = m_diff.GetChanges()[current->data(0, Qt::UserRole).toUInt()];
+    m_diffOld->setHtml(GetDiffHtml(m_diffOldSnapshot, change.m_oldIndex, change, true));
+    m_diffNew->setHtml(GetDiffHtml(m_diffNewSnapshot, change.m_newIndex, change, false));
+}
+
+//---------------------------------------------------------------------------
+// Difference double clicked, load the entry at its first changed page
+//---------------------------------------------------------------------------
+void mstEditor::DiffItemActivated(QTreeWidgetItem *item, int column)
+{
+    Q_UNUSED(column)
+
+    MstDiff::EntryChange const& change = m_diff.GetChanges()[item->data(0, Qt::UserRole).toUInt()];
+    if (change.m_newIndex < 0) return;
+
+    int page = 0;
+    for (MstDiff::PageChange const& pageChange : change.m_pages)
+    {
+        if (pageChange.m_inNew)
+        {
+            page = pageChange.m_page;
+            break;
+        }
+    }
+    GoToIssue(QString::fromStdString(change.m_name), change.m_newIndex, page);
+}
+
+//---------------------------------------------------------------------------
+// One side of an entry, pages and tags that differ are highlighted
+//---------------------------------------------------------------------------
+QString mstEditor::GetDiffHtml(mst::Snapshot const& _snapshot, int _index, MstDiff::EntryChange const& _change, bool _old)
+{
+    if (_index < 0) return QString();
+
+    QSet<int> changedPages;
+    for (MstDiff::PageChange const& page : _change.m_pages)
+    {
+        changedPages.insert(page.m_page);
+    }
+    QSet<int> changedTags;
+    for (MstDiff::TagChange const& tag : _change.m_tags)
+    {
+        changedTags.insert(tag.m_tag);
+    }
+
+    mst::TextEntry const& entry = *_snapshot.m_entries.At(static_cast<unsigned int>(_index));
+    return GetEntryHtml(entry, QString::number(_index + 1), changedPages, changedTags, _old ? "#ffd8d8" : "#d8f0d8");
+}
+
+//---------------------------------------------------------------------------
+// Pages and tags of an entry for a text browser, some highlighted
+//---------------------------------------------------------------------------
+QString mstEditor::GetEntryHtml(mst::TextEntry const& _entry, QString const& _title, QSet<int> const& _pages, QSet<int> const& _tags, QString const& _highlight)
+{
+    QString html = "<b>" + QString::fromStdString(_entry.m_name).toHtmlEscaped() + "</b> (" + _title + ")";
+    for (unsigned int p = 0; p < _entry.m_subtitles.size(); p++)
+    {
+        QString subtitle = QString::fromStdWString(_entry.m_subtitles[p]);
+        if (ui->CB_Russian->isChecked())
+        {
+            subtitle = ToRussian(subtitle);
+        }
+
+        QString const style = _pages.contains(static_cast<int>(p)) ? " style=\"background-color:" + _highlight + "\"" : QString();
+        html += "<p" + style + "><i>Page " + QString::number(p + 1) + "</i><br>" + subtitle.toHtmlEscaped().replace("\n", "<br>") + "</p>";
+    }
+
+    html += "<p><i>Tags</i><br>";
+    for (unsigned int t = 0; t < _entry.m_tags.size(); t++)
+    {
+        QString const tag = TW_DecodeTag(_entry.m_tags[t]).toHtmlEscaped();
+        html += (t ? ", " : "") + (_tags.contains(static_cast<int>(t)) ? "<span style=\"background-color:" + _highlight + "\">" + tag + "</span>" : tag);
+    }
+    html += "</p>";
+    return html;
+}
+
+//---------------------------------------------------------------------------
+// Merge another translator's copy into the current document
+//---------------------------------------------------------------------------
+void mstEditor::on_actionMerge_triggered()
+{
+    if (!m_mst.IsLoaded()) return;
+
+    if (!DiscardSaveMessage("Merge", "Discard unsaved changes?", false))
+    {
+        return;
+    }
+
+    QString baseFile = QFileDialog::getOpenFileName(this, tr("Merge: Original Both Copies Started From"), m_path, "MST File (*.mst)");
+    if (baseFile == Q_NULLPTR) return;
+
+    QString theirsFile = QFileDialog::getOpenFileName(this, tr("Merge: Copy To Merge In"), m_path, "MST File (*.mst)");
+    if (theirsFile == Q_NULLPTR) return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    mst base;
+    mst theirs;
+    string errorMsg;
+    bool const loaded = base.Load(baseFile.toStdString(), errorMsg) && theirs.Load(theirsFile.toStdString(), errorMsg);
+
+    MstMerge merge;
+    if (loaded)
+    {
+        merge.Merge(base.GetSnapshot(), m_mst.GetSnapshot(), theirs.GetSnapshot());
+    }
+    QApplication::restoreOverrideCursor();
+
+    if (!loaded)
+    {
+        QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
+        return;
+    }
+
+    // The whole merge is one step to undo
+    PushEditStep(EditType::Replace, -1);
+    CloseSubtitle();
+    m_mst.SetEntries(merge.GetEntries());
+    TW_Refresh();
+    SetFileEdited(true);
+
+    int const conflictCount = SetConflicts(merge.GetConflicts());
+    QString message = QString::number(merge.GetTheirsCount()) + " subtitles taken from the other copy, ";
+    message += QString::number(merge.GetCombinedCount()) + " combined page by page, ";
+    message += QString::number(merge.GetRemovedCount()) + " removed.";
+    if (conflictCount > 0)
+    {
+        message += "\n\n" + QString::number(conflictCount) + " conflicts kept the current version, see the conflict list.";
+    }
+    QMessageBox::information(this, "Merge", message, QMessageBox::Ok);
+}
+
+//---------------------------------------------------------------------------
+// Fill the conflict list, returns the number of rows
+//---------------------------------------------------------------------------
+int mstEditor::SetConflicts(vector<MstMerge::Conflict> const& _conflicts)
+{
+    m_conflictList->clear();
+    m_conflictBase->clear();
+    m_conflictOurs->clear();
+    m_conflictTheirs->clear();
+    m_conflicts.clear();
+    m_conflictHandles.clear();
+
+    QList<QTreeWidgetItem*> items;
+    for (MstMerge::Conflict const& conflict : _conflicts)
+    {
+        QTreeWidgetItem* item = new QTreeWidgetItem();
+        item->setText(0, conflict.m_index >= 0 ? QString::number(conflict.m_index + 1) : "-");
+        item->setData(0, Qt::UserRole, m_conflicts.size());
+        item->setText(1, QString::fromStdString(MstMerge::ToString(conflict)));
+        items.push_back(item);
+
+        m_conflicts.push_back(conflict);
+        m_conflictHandles.push_back(conflict.m_index >= 0 ? m_mst.GetHandle(static_cast<unsigned int>(conflict.m_index)) : mst::InvalidHandle);
+    }
+
+    m_conflictList->addTopLevelItems(items);
+    m_conflictDock->setVisible(!items.isEmpty());
+    return items.size();
+}
+
+//---------------------------------------------------------------------------
+// Current index of a conflict's entry, -1 if it is not in the document
+//---------------------------------------------------------------------------
+int mstEditor::GetConflictIndex(int _conflict)
+{
+    mst::Handle const handle = m_conflictHandles[_conflict];
+    return (handle == mst::InvalidHandle) ? -1 : m_mst.GetIndex(handle);
+}
+
+//---------------------------------------------------------------------------
+// Show the base, current and other version of the selected conflict
+//---------------------------------------------------------------------------
+void mstEditor::ConflictItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous)
+{
+    Q_UNUSED(previous)
+    if (!current) return;
+
+    MstMerge::Conflict const& conflict = m_conflicts[current->data(0, Qt::UserRole).toInt()];
+    QSet<int> pages;
+    for (int page : conflict.m_pages)
+    {
+        pages.insert(page);
+    }
+
+    auto setSide = [&](QTextBrowser* _browser, mst::EntryPtr const& _entry, QString const& _title)
+    {
+        _browser->setHtml(_entry ? GetEntryHtml(*_entry, _title, pages, QSet<int>(), "#fff0c0") : "<i>" + _title + ": not there</i>");
+    };
+    setSide(m_conflictBase, conflict.m_base, "Original");
+    setSide(m_conflictOurs, conflict.m_ours, "Current");
+    setSide(m_conflictTheirs, conflict.m_theirs, "Theirs");
+}
+
+//---------------------------------------------------------------------------
+// Conflict double clicked, load the entry at the first page in conflict
+//---------------------------------------------------------------------------
+void mstEditor::ConflictItemActivated(QTreeWidgetItem *item, int column)
+{
+    Q_UNUSED(column)
+
+    int const c = item->data(0, Qt::UserRole).toInt();
+    int const id = GetConflictIndex(c);
+    if (id < 0) return;
+
+    MstMerge::Conflict const& conflict = m_conflicts[c];
+    GoToIssue(QString::fromStdString(conflict.m_name), id, conflict.m_pages.empty() ? 0 : conflict.m_pages.front());
+}
+
+//---------------------------------------------------------------------------
+// Current version of the entry is fine, nothing to change
+//---------------------------------------------------------------------------
+void mstEditor::ConflictKeepClicked()
+{
+    QTreeWidgetItem* item = m_conflictList->currentItem();
+    if (!item) return;
+
+    RemoveConflictItem(item);
+}
+
+//---------------------------------------------------------------------------
+// Replace the entry with the other copy, where both changed it
+//---------------------------------------------------------------------------
+void mstEditor::ConflictUseTheirsClicked()
+{
+    QTreeWidgetItem* item = m_conflictList->currentItem();
+    if (!item) return;
+
+    if (!DiscardSaveMessage("Discard", "Discard unsaved changes?", false))
+    {
+        return;
+    }
+
+    int const c = item->data(0, Qt::UserRole).toInt();
+    int id = GetConflictIndex(c);
+    mst::EntryPtr const entry = MstMerge::ResolveTheirs(m_conflicts[c]);
+
+    CloseSubtitle();
+    if (id >= 0 && entry)
+    {
+        PushEditStep(EditType::Modify, id);
+        m_mst.ModifyEntry(static_cast<unsigned int>(id), *entry);
+        TW_AddOrReplaceEntry(*entry, id);
+    }
+    else if (id >= 0)
+    {
+        // Removed by theirs
+        PushEditStep(EditType::Remove, id);
+        m_mst.RemoveEntry(static_cast<unsigned int>(id));
+        delete ui->TW_TreeWidget->takeTopLevelItem(id);
+        m_conflictHandles[c] = mst::InvalidHandle;
+    }
+    else if (entry)
+    {
+        // Removed here, added back at the end
+        PushEditStep(EditType::Add, static_cast<int>(m_mst.GetEntryCount()));
+        id = m_mst.AddNewEntry();
+        m_mst.ModifyEntry(static_cast<unsigned int>(id), *entry);
+        TW_AddOrReplaceEntry(*entry);
+        m_conflictHandles[c] = m_mst.GetHandle(static_cast<unsigned int>(id));
+        TW_FocusItem(id);
+    }
+
+    SetFileEdited(true);
+    RemoveConflictItem(item);
+}
+
+//---------------------------------------------------------------------------
+// Conflict resolved, hide the list after the last one
+//---------------------------------------------------------------------------
+void mstEditor::RemoveConflictItem(QTreeWidgetItem* _item)
+{
+    delete _item;
+    if (m_conflictList->topLevelItemCount() == 0)
+    {
+        m_conflictBase->clear();
+        m_conflictOurs->clear();
+        m_conflictTheirs->clear();
+        m_conflictDock->hide();
+    }
+}
+
+//---------------------------------------------------------------------------
+// Close application
+//---------------------------------------------------------------------------
+void mstEditor::on_actionClose_triggered()
+{
+    if (m_mst.IsLoaded())
+    {
+        if (!DiscardSaveMessage("Close", "Quit without saving?", true))
+        {
+            return;
+        }
+    }
+
+    QApplication::quit();
+}
+
+//---------------------------------------------------------------------------
+// About mstEditor
+//---------------------------------------------------------------------------
+void mstEditor::on_actionAbout_mstEditor_triggered()
+{
+    QString message = "mstEditor - Sonic the Hedgehog (2006) Subtitle Editor v2.2";
+    message += "\nCreated by brianuuu 2025";
+    message += "\nYoutube: brianuuuSonic";
+    message += "\nSpecial Thanks: N69vid - Beta testing, Russian mapping";
+    message += "\n\nv1.0 - Initial Release";
+    message += "\nv2.0 - Added Color Support";
+    message += "\nv2.1 - Bug Fix on able to add color to sound before";
+    message += "\nv2.2 - Allow drag reorder, mapped d-pad";
+    QMessageBox::information(this, "About mstEditor", message, QMessageBox::Ok);
+}
+
+//---------------------------------------------------------------------------
+// Show how much memory the open document takes
+//---------------------------------------------------------------------------
+void mstEditor::on_actionMemoryUsage_triggered()
+{
+    MemoryUsage usage;
+    m_mst.GetMemoryUsage(usage);
+
+    // Estimated from the item, its column data and the text it holds
+    for (int i = 0; i < ui->TW_TreeWidget->topLevelItemCount(); i++)
+    {
+        QTreeWidgetItem const* item = ui->TW_TreeWidget->topLevelItem(i);
+        usage.m_treeItems += static_cast<long long>(sizeof(QTreeWidgetItem));
+        for (int column = 0; column < item->columnCount(); column++)
+        {
+            QString const text = item->text(column);
+            usage.m_treeItems += static_cast<long long>(sizeof(QVariant) + sizeof(QArrayData) + (text.capacity() + 1) * sizeof(QChar));
+        }
+    }
+
+    QMessageBox::information(this, "Memory Usage", QString::fromStdString(usage.ToString()), QMessageBox::Ok);
+}
+
+//---------------------------------------------------------------------------
+// Start or stop recording timing spans
+//---------------------------------------------------------------------------
+void mstEditor::on_actionRecordTrace_toggled(bool checked)
+{
+    if (checked)
+    {
+        Trace::Clear();
+    }
+    Trace::SetEnabled(checked);
+}
+
+//---------------------------------------------------------------------------
+// Write recorded spans for chrome://tracing
+//---------------------------------------------------------------------------
+void mstEditor::on_actionSaveTrace_triggered()
+{
+    QString traceFile = QFileDialog::getSaveFileName(this, tr("Save Trace"), m_path, "Trace File (*.json)");
+    if (traceFile == Q_NULLPTR) return;
+
+    string errorMsg;
+    if (!Trace::WriteChromeTrace(traceFile.toStdString(), errorMsg))
+    {
+        QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
+    }
+}
+
+//---------------------------------------------------------------------------
+// About Qt
+//---------------------------------------------------------------------------
+void mstEditor::on_actionAbout_Qt_triggered()
+{
+    QMessageBox::aboutQt(this, "About Qt");
+}
+
+//---------------------------------------------------------------------------
+// Closing application
+//---------------------------------------------------------------------------
+void mstEditor::closeEvent (QCloseEvent *event)
+{
+    if (m_mst.IsLoaded())
+    {
+        if (!DiscardSaveMessage("Close", "Quit without saving?", true))
+        {
+            event->ignore();
+            return;
+        }
+    }
+
+    event->accept();
+}
+
+//---------------------------------------------------------------------------
+// Alt+S
+//---------------------------------------------------------------------------
+void mstEditor::on_Shortcut_ApplyChanges()
+{
+    if (ui->PB_Save->isEnabled())
+    {
+        on_PB_Save_clicked();
+    }
+}
+
+//---------------------------------------------------------------------------
+// Alt+R
+//---------------------------------------------------------------------------
+void mstEditor::on_Shortcut_ResetSubtitle()
+{
+    if (ui->PB_Reset->isEnabled())
+    {
+        on_PB_Reset_clicked();
+    }
+}
+
+//---------------------------------------------------------------------------
+// Ctrl+F
+//---------------------------------------------------------------------------
+void mstEditor::on_Shortcut_Find()
+{
+    if (ui->LE_Find->isEnabled())
+    {
+        ui->LE_Find->setFocus();
+        ui->LE_Find->selectAll();
+    }
+}
+
+//---------------------------------------------------------------------------
+// Resetting all buttons and data
+//---------------------------------------------------------------------------
+void mstEditor::ResetProgram()
+{
+    SetFileEdited(false);
+
+    ui->L_FileName->setText("File Name: ---");
+
+    ResetEditor();
+
+    ui->PB_SubtitleAdd->setEnabled(false);
+    ui->PB_SubtitleDelete->setEnabled(false);
+    ui->TW_TreeWidget->scrollToTop();
+
+    ui->LE_Find->setEnabled(false);
+    ui->RB_Top->setEnabled(false);
+    ui->RB_Current->setEnabled(false);
+    ui->PB_Find->setEnabled(false);
+
+    m_undoSteps.clear();
+    m_redoSteps.clear();
+    UpdateEditActions();
+
+    // Differences were to the document being closed
+    m_diffList->clear();
+    m_diffDock->hide();
+    m_diff = MstDiff();
+    m_diffOldSnapshot = mst::Snapshot();
+    m_diffNewSnapshot = mst::Snapshot();
+
+    m_conflictList->clear();
+    m_conflictDock->hide();
+    m_conflicts.clear();
+    m_conflictHandles.clear();
+
+    // Overflow highlights were for the document being closed
+    m_overflowAnalyzer.reset();
+}
+
+//---------------------------------------------------------------------------
+// Reset subtitle editor
+//---------------------------------------------------------------------------
+void mstEditor::ResetEditor()
+{
+    ui->LE_SubtitleName->setEnabled(false);
+    ui->LE_SubtitleName->setText("");
+
+    m_id = -1;
+    m_handle = mst::InvalidHandle;
+    m_page = -1;
+    m_name.clear();
+    m_subtitles.clear();
+    RebuildTagStarts();
+    m_tags.clear();
+
+    m_initValue = 0;
+    m_mouseY = 0;
+    m_dragScale = 0;
+    m_dragSpinBox = Q_NULLPTR;
 
     ui->TE_TextEditor->setEnabled(false);
     ui->TE_TextEditor->setText("");
-    m_previewLabel->setText("");
+    m_preview->Clear();
     m_subtitleEdited = false;
     m_subtitleHardcoded = false;
 
@@ -636,6 +1694,7 @@ bool mstEditor::DiscardSaveMessage(QString _title, QString _message, bool _check
 //---------------------------------------------------------------------------
 void mstEditor::TW_Refresh()
 {
+    TRACE_SCOPE("mstEditor::TW_Refresh");
     ui->TW_TreeWidget->clear();
 
     vector<mst::TextEntry> entries;
@@ -668,80 +1727,312 @@ void mstEditor::TW_AddOrReplaceEntry(mst::TextEntry entry, int _id)
         item = ui->TW_TreeWidget->topLevelItem(_id);
     }
 
-    item->setText(0, QString::fromStdString(entry.m_name));
-    item->setFlags(item->flags() & ~Qt::ItemIsDropEnabled);
+    TW_SetItemText(item, entry);
+    TW_CheckItemOverflow(item, entry);
+}
+
+//---------------------------------------------------------------------------
+// Fill name, subtitle and tag columns of a tree item, subtitles are always
+// stored unconverted, m_russianDelegate converts them when painted
+//---------------------------------------------------------------------------
+void mstEditor::TW_SetItemText(QTreeWidgetItem* _item, mst::TextEntry const& _entry)
+{
+    _item->setText(0, QString::fromStdString(_entry.m_name));
+    _item->setFlags(_item->flags() & ~Qt::ItemIsDropEnabled);
 
     QString subtitle;
-    for(unsigned int i = 0; i < entry.m_subtitles.size(); i++)
+    for(unsigned int i = 0; i < _entry.m_subtitles.size(); i++)
+    {
+        subtitle += QString::fromStdWString(_entry.m_subtitles[i]);
+        if (i != _entry.m_subtitles.size() - 1)
+        {
+            subtitle += "\n\n";
+        }
+    }
+    _item->setText(1, subtitle);
+
+    QString tags;
+    for(unsigned int i = 0; i < _entry.m_tags.size(); i++)
+    {
+        tags += TW_DecodeTag(_entry.m_tags[i]);
+        if (i != _entry.m_tags.size() - 1)
+        {
+            tags += "\n";
+        }
+    }
+    _item->setText(2, tags);
+}
+
+//---------------------------------------------------------------------------
+// Highlight an entry that doesn't fit in the text box, issues as tooltip
+//---------------------------------------------------------------------------
+void mstEditor::TW_SetItemOverflow(QTreeWidgetItem* _item, QStringList const& _issues)
+{
+    QBrush const background = _issues.isEmpty() ? QBrush() : QBrush(QColor(255,200,200));
+    for (int column = 0; column < _item->columnCount(); column++)
+    {
+        _item->setBackground(column, background);
+        _item->setToolTip(column, _issues.join("\n"));
+    }
+}
+
+//---------------------------------------------------------------------------
+// Check an entry again after it changed, only once the file was checked
+//---------------------------------------------------------------------------
+void mstEditor::TW_CheckItemOverflow(QTreeWidgetItem* _item, mst::TextEntry const& _entry)
+{
+    if (!m_overflowAnalyzer) return;
+
+    OverflowAnalyzer::Report report;
+    m_overflowAnalyzer->Analyze(vector<mst::EntryPtr>(1, mst::MakeEntry(_entry)), report);
+
+    QStringList issues;
+    for (OverflowAnalyzer::Issue const& issue : report.m_issues)
+    {
+        issues.push_back(OverflowAnalyzer::ToString(issue));
+    }
+    TW_SetItemOverflow(_item, issues);
+}
+
+//---------------------------------------------------------------------------
+// Decode a Shift-JIS tag, only the first occurrence hits the codec
+//---------------------------------------------------------------------------
+QString mstEditor::TW_DecodeTag(string const& _tag)
+{
+    // Also used by the loading worker
+    QMutexLocker locker(&m_tagCacheMutex);
+
+    // Raw data lookup avoids copying the bytes unless we need to insert
+    QByteArray const rawTag = QByteArray::fromRawData(_tag.c_str(), static_cast<int>(_tag.size()));
+    QHash<QByteArray, QString>::const_iterator iter = m_tagCache.constFind(rawTag);
+    if (iter != m_tagCache.constEnd())
+    {
+        return iter.value();
+    }
+
+    QByteArray const key(_tag.c_str(), static_cast<int>(_tag.size()));
+    return m_tagCache.insert(key, m_tagCodec->toUnicode(key)).value();
+}
+
+//---------------------------------------------------------------------------
+// Item in tree widget clicked
+//---------------------------------------------------------------------------
+void mstEditor::on_TW_TreeWidget_itemDoubleClicked(QTreeWidgetItem *item, int column)
+{
+    if (!DiscardSaveMessage("Discard", "Discard unsaved changes?", false))
+    {
+       return;
+    }
+
+    LoadSubtitle(ui->TW_TreeWidget->indexOfTopLevelItem(item));
+}
+
+//---------------------------------------------------------------------------
+// Items in tree widget reordered, tree is already updated
+//---------------------------------------------------------------------------
+void mstEditor::on_TW_TreeWidget_itemsMoved(QList<int> const& fromRows, QList<int> const& toRows)
+{
+    PushEditStep(EditType::Move, toRows.front(), fromRows, toRows);
+    if (!MoveEntries(fromRows, toRows))
+    {
+        // Should never happen, rebuild the tree from the entries
+        m_undoSteps.pop_back();
+        UpdateEditActions();
+        TW_Refresh();
+        return;
+    }
+    SetFileEdited(true);
+
+    // Current entry is tracked by handle, just look up where it is now
+    if (m_id >= 0)
+    {
+        m_id = m_mst.GetIndex(m_handle);
+    }
+}
+
+//---------------------------------------------------------------------------
+// Move entries of the document, _fromRows[i] ends up at _toRows[i]
+//---------------------------------------------------------------------------
+bool mstEditor::MoveEntries(QList<int> const& _fromRows, QList<int> const& _toRows)
+{
+    vector<unsigned int> from;
+    vector<unsigned int> to;
+    from.reserve(static_cast<size_t>(_fromRows.size()));
+    to.reserve(static_cast<size_t>(_toRows.size()));
+    for (int i = 0; i < _fromRows.size(); i++)
+    {
+        from.push_back(static_cast<unsigned int>(_fromRows[i]));
+        to.push_back(static_cast<unsigned int>(_toRows[i]));
+    }
+    return m_mst.MoveEntries(from, to);
+}
+
+//---------------------------------------------------------------------------
+// Undo last change to the entries
+//---------------------------------------------------------------------------
+void mstEditor::on_actionUndo_triggered()
+{
+    if (m_undoSteps.isEmpty()) return;
+
+    if (!DiscardSaveMessage("Undo", "Discard unsaved changes?", false))
+    {
+        return;
+    }
+
+    // Redo goes back to the current document
+    EditStep step = m_undoSteps.takeLast();
+    EditStep redoStep = step;
+    redoStep.m_snapshot = m_mst.GetSnapshot();
+    m_redoSteps.push_back(redoStep);
+
+    ApplyEditStep(step, true);
+}
+
+//---------------------------------------------------------------------------
+// Redo last undone change
+//---------------------------------------------------------------------------
+void mstEditor::on_actionRedo_triggered()
+{
+    if (m_redoSteps.isEmpty()) return;
+
+    if (!DiscardSaveMessage("Redo", "Discard unsaved changes?", false))
+    {
+        return;
+    }
+
+    EditStep step = m_redoSteps.takeLast();
+    EditStep undoStep = step;
+    undoStep.m_snapshot = m_mst.GetSnapshot();
+    m_undoSteps.push_back(undoStep);
+
+    ApplyEditStep(step, false);
+}
+
+//---------------------------------------------------------------------------
+// Record the document before a change, only costs the nodes it will copy
+//---------------------------------------------------------------------------
+void mstEditor::PushEditStep(EditType _type, int _id, QList<int> const& _fromRows, QList<int> const& _toRows)
+{
+    m_redoSteps.clear();
+
+    // Auto-apply modifies on every keystroke, keep one step per entry
+    if (_type == EditType::Modify && ui->CB_AutoApply->isChecked() && !m_undoSteps.isEmpty())
+    {
+        EditStep const& lastStep = m_undoSteps.last();
+        if (lastStep.m_type == EditType::Modify && lastStep.m_id == _id)
+        {
+            UpdateEditActions();
+            return;
+        }
+    }
+
+    EditStep step;
+    step.m_snapshot = m_mst.GetSnapshot();
+    step.m_type = _type;
+    step.m_id = _id;
+    step.m_fromRows = _fromRows;
+    step.m_toRows = _toRows;
+    m_undoSteps.push_back(step);
+
+    UpdateEditActions();
+}
+
+//---------------------------------------------------------------------------
+// Restore the document of a step and patch the tree view to match
+//---------------------------------------------------------------------------
+void mstEditor::ApplyEditStep(EditStep const& _step, bool _undo)
+{
+    // The entry the editor shows may no longer exist
+    CloseSubtitle();
+
+    // Moves are replayed backwards instead, that only touches the moved
+    // entries and keeps the name index
+    if (_step.m_type != EditType::Move)
     {
-        subtitle += QString::fromStdWString(entry.m_subtitles[i]);
-        if (i != entry.m_subtitles.size() - 1)
+        m_mst.RestoreSnapshot(_step.m_snapshot);
+    }
+
+    int focusID = _step.m_id;
+    switch (_step.m_type)
+    {
+    case EditType::Modify:
+    {
+        TW_AddOrReplaceEntry(m_mst.GetEntry(static_cast<unsigned int>(_step.m_id)), _step.m_id);
+        break;
+    }
+    case EditType::Add:
+    case EditType::Remove:
+    {
+        if ((_step.m_type == EditType::Add) == _undo)
+        {
+            // Undoing add or redoing remove
+            delete ui->TW_TreeWidget->takeTopLevelItem(_step.m_id);
+            focusID = qMin(_step.m_id, ui->TW_TreeWidget->topLevelItemCount() - 1);
+        }
+        else
+        {
+            QTreeWidgetItem* item = new QTreeWidgetItem();
+            mst::TextEntry const entry = m_mst.GetEntry(static_cast<unsigned int>(_step.m_id));
+            TW_SetItemText(item, entry);
+            TW_CheckItemOverflow(item, entry);
+            ui->TW_TreeWidget->insertTopLevelItem(_step.m_id, item);
+        }
+        break;
+    }
+    case EditType::Move:
+    {
+        if (_undo)
+        {
+            MoveEntries(_step.m_toRows, _step.m_fromRows);
+            TW_MoveItems(_step.m_toRows, _step.m_fromRows);
+            focusID = _step.m_fromRows.front();
+        }
+        else
         {
-            subtitle += "\n\n";
+            MoveEntries(_step.m_fromRows, _step.m_toRows);
+            TW_MoveItems(_step.m_fromRows, _step.m_toRows);
+            focusID = _step.m_toRows.front();
         }
+        break;
     }
-    if (ui->CB_Russian->isChecked())
+    case EditType::Replace:
     {
-        subtitle = ToRussian(subtitle);
-    }
-    item->setText(1, subtitle);
+        TW_Refresh();
+        focusID = 0;
 
-    QTextCodec *codec = QTextCodec::codecForName("Shift-JIS");
-    QTextDecoder *decoder = codec->makeDecoder();
-
-    QString tags;
-    for(unsigned int i = 0; i < entry.m_tags.size(); i++)
-    {
-        tags += decoder->toUnicode(entry.m_tags[i].c_str());
-        if (i != entry.m_tags.size() - 1)
-        {
-            tags += "\n";
-        }
+        // Conflicts are about the entries after the merge
+        m_conflictDock->setVisible(!_undo && m_conflictList->topLevelItemCount() > 0);
+        break;
+    }
     }
-    item->setText(2, tags);
 
-    delete decoder;
+    TW_FocusItem(focusID);
+    SetFileEdited(true);
+    UpdateEditActions();
 }
 
 //---------------------------------------------------------------------------
-// Item in tree widget clicked
+// Close the subtitle editor and unmark its entry in the tree view
 //---------------------------------------------------------------------------
-void mstEditor::on_TW_TreeWidget_itemDoubleClicked(QTreeWidgetItem *item, int column)
+void mstEditor::CloseSubtitle()
 {
-    if (!DiscardSaveMessage("Discard", "Discard unsaved changes?", false))
+    if (m_id >= 0 && m_id < ui->TW_TreeWidget->topLevelItemCount())
     {
-       return;
+        QTreeWidgetItem* item = ui->TW_TreeWidget->topLevelItem(m_id);
+        item->setForeground(0, QColor(0,0,0));
+        item->setForeground(1, QColor(0,0,0));
+        item->setForeground(2, QColor(0,0,0));
     }
-
-    LoadSubtitle(ui->TW_TreeWidget->indexOfTopLevelItem(item));
+    ResetEditor();
 }
 
 //---------------------------------------------------------------------------
-// Item in tree widget reordered
+// Enable undo and redo menu items
 //---------------------------------------------------------------------------
-void mstEditor::on_TW_TreeWidget_itemMoved(int from, int to)
+void mstEditor::UpdateEditActions()
 {
-    m_fileEdited = true;
-    m_mst.MoveEntry(static_cast<unsigned int>(from), static_cast<unsigned int>(to));
-
-    if (m_id >= 0)
-    {
-        if (m_id == from)
-        {
-            // moving current entry
-            m_id = to;
-        }
-        else if (from > m_id && to <= m_id)
-        {
-            // something moved to above current entry
-            m_id++;
-        }
-        else if (from < m_id && to >= m_id)
-        {
-            // something moved to below current entry
-            m_id--;
-        }
-    }
+    ui->actionUndo->setEnabled(!m_undoSteps.isEmpty());
+    ui->actionRedo->setEnabled(!m_redoSteps.isEmpty());
 }
 
 //---------------------------------------------------------------------------
@@ -750,6 +2041,7 @@ void mstEditor::on_TW_TreeWidget_itemMoved(int from, int to)
 void mstEditor::on_PB_SubtitleAdd_clicked()
 {
     // Add new entry and update tree entry
+    PushEditStep(EditType::Add, static_cast<int>(m_mst.GetEntryCount()));
     int id = m_mst.AddNewEntry();
     mst::TextEntry const entry = m_mst.GetEntry(static_cast<unsigned int>(id));
 
@@ -757,7 +2049,7 @@ void mstEditor::on_PB_SubtitleAdd_clicked()
     TW_FocusItem(id);
     TW_AddOrReplaceEntry(entry);
 
-    m_fileEdited = true;
+    SetFileEdited(true);
 }
 
 //---------------------------------------------------------------------------
@@ -767,11 +2059,12 @@ void mstEditor::on_PB_SubtitleDelete_clicked()
 {
     if (m_id < 0 || m_id >= ui->TW_TreeWidget->topLevelItemCount()) return;
 
+    PushEditStep(EditType::Remove, m_id);
     m_mst.RemoveEntry(static_cast<unsigned int>(m_id));
     delete ui->TW_TreeWidget->takeTopLevelItem(m_id);
     ResetEditor();
 
-    m_fileEdited = true;
+    SetFileEdited(true);
 }
 
 //---------------------------------------------------------------------------
@@ -812,10 +2105,25 @@ void mstEditor::TW_Find()
         return;
     }
 
+    // Subtitles in the tree are not converted, search for what is stored
+    QString const subtitleStr = ui->CB_Russian->isChecked() ? ToUnicode(str) : str;
+
     bool found = false;
     int page = 0;
     int findID = ui->RB_Top->isChecked() ? 0 : (m_id + 1);
-    for (; findID < ui->TW_TreeWidget->topLevelItemCount() ; findID++)
+
+    // An exact entry name goes straight there without scanning the tree
+    if (ui->RB_Top->isChecked())
+    {
+        int const nameID = m_mst.FindEntry(str.toStdString());
+        if (nameID >= 0)
+        {
+            findID = nameID;
+            found = true;
+        }
+    }
+
+    for (; !found && findID < ui->TW_TreeWidget->topLevelItemCount() ; findID++)
     {
         // Go through tree view
         QTreeWidgetItem const* item = ui->TW_TreeWidget->topLevelItem(findID);
@@ -823,7 +2131,7 @@ void mstEditor::TW_Find()
         {
             // Find within name, subtitle and tags
             QString const columnString = item->text(i);
-            int index = columnString.indexOf(str, 0, Qt::CaseInsensitive);
+            int index = columnString.indexOf(i == 1 ? subtitleStr : str, 0, Qt::CaseInsensitive);
             if (index != -1)
             {
                 if (i == 1)
@@ -875,6 +2183,38 @@ void mstEditor::TW_Find()
     ui->LE_Find->selectAll();
 }
 
+//---------------------------------------------------------------------------
+// Move tree items so that _fromRows[i] ends up at _toRows[i]
+//---------------------------------------------------------------------------
+void mstEditor::TW_MoveItems(QList<int> const& _fromRows, QList<int> const& _toRows)
+{
+    // Take from the bottom so the remaining rows stay valid
+    QMap<int, int> fromOrder;
+    for (int i = 0; i < _fromRows.size(); i++)
+    {
+        fromOrder[_fromRows[i]] = i;
+    }
+
+    QVector<QTreeWidgetItem*> items(_fromRows.size());
+    for (auto iter = fromOrder.end(); iter != fromOrder.begin();)
+    {
+        --iter;
+        items[iter.value()] = ui->TW_TreeWidget->takeTopLevelItem(iter.key());
+    }
+
+    // Insert from the top, every row before a target is then final
+    QMap<int, int> toOrder;
+    for (int i = 0; i < _toRows.size(); i++)
+    {
+        toOrder[_toRows[i]] = i;
+    }
+
+    for (auto iter = toOrder.begin(); iter != toOrder.end(); ++iter)
+    {
+        ui->TW_TreeWidget->insertTopLevelItem(iter.key(), items[iter.value()]);
+    }
+}
+
 //---------------------------------------------------------------------------
 // Load a subtitle for editor
 //---------------------------------------------------------------------------
@@ -893,6 +2233,8 @@ void mstEditor::TW_FocusItem(int _id)
 //---------------------------------------------------------------------------
 void mstEditor::LoadSubtitle(int _id, int _page)
 {
+    TRACE_SCOPE("mstEditor::LoadSubtitle");
+
     // Un-highlight previous selection
     if (m_id >= 0)
     {
@@ -909,6 +2251,7 @@ void mstEditor::LoadSubtitle(int _id, int _page)
 
     // Highlight selected
     m_id = _id;
+    m_handle = m_mst.GetHandle(static_cast<unsigned int>(m_id));
     QTreeWidgetItem* item = ui->TW_TreeWidget->topLevelItem(m_id);
     item->setForeground(0, QColor(255,0,0));
     item->setForeground(1, QColor(255,0,0));
@@ -917,101 +2260,22 @@ void mstEditor::LoadSubtitle(int _id, int _page)
     mst::TextEntry const entry = m_mst.GetEntry(static_cast<unsigned int>(m_id));
     m_name = QString::fromStdString(entry.m_name);
 
+    // Colors are paired in one pass, unpaired or broken ones become the A button
+    MarkupParser::Document document;
+    MarkupParser::Parse(entry, document);
+
     m_tags.clear();
-    for (string const& tag : entry.m_tags)
+    m_tags.reserve(document.m_tags.size());
+    for (MarkupParser::TagInfo const& tag : document.m_tags)
     {
-        // Remove "sound(" or "picture(" and ")"
-        QString str = QString::fromStdString(tag);
-        int start = str.indexOf("("); // Color will be -1
-
-        // Record tag type, default as button
-        Tag tagType = Tag::Picture;
-        QString type = str.mid(0, start);
-        if (type == "sound")
-        {
-            tagType = Tag::Sound;
-        }
-        else if (type == "rgba")
+        bool const isColor = (tag.m_type == Tag::RGBA || tag.m_type == Tag::Color);
+        if (isColor && tag.m_partner < 0)
         {
-            tagType = Tag::RGBA;
-        }
-
-        if (type == "color")
-        {
-            // Color has no brackets
-            tagType = Tag::Color;
+            m_tags.push_back(TagPair(m_buttonToString[Button::A], Tag::Picture));
         }
         else
         {
-            str.remove(0, start + 1);
-            str.remove(str.size() - 1, 1);
-        }
-
-        m_tags.push_back(TagPair(str, tagType));
-    }
-
-    // Loop through all the tags again, check for invalid color
-    for (int i = 0; i < m_tags.size(); i++)
-    {
-        TagPair& tagPair = m_tags[i];
-        if (tagPair.second == Tag::RGBA)
-        {
-            bool valid = true;
-
-            QList<int> rgbaNum;
-            QStringList rgbaStr = tagPair.first.split(",");
-            if (rgbaStr.size() == 3 || rgbaStr.size() == 4)
-            {
-                // Validate individual number
-                for (QString const& numStr : rgbaStr)
-                {
-                    bool ok = false;
-                    int num = numStr.toInt(&ok);
-                    if (ok) rgbaNum.push_back(num);
-                    valid &= ok;
-                }
-            }
-
-            if (valid)
-            {
-                // Search if a "Color" tag exist after this
-                valid = false;
-                for (int j = i + 1; j < m_tags.size(); j++)
-                {
-                    if (m_tags[j].second == Tag::Color)
-                    {
-                        valid = true;
-                        break;
-                    }
-                }
-            }
-
-            if (!valid)
-            {
-                // Invalid rgba tag, set to button
-                tagPair.first = m_buttonToString[Button::A];
-                tagPair.second = Tag::Picture;
-            }
-        }
-        else if (tagPair.second == Tag::Color)
-        {
-            // Search if a "RGBA" tag exist before this
-            bool valid = false;
-            for (int j = i - 1; j >= 0; j--)
-            {
-                if (m_tags[j].second == Tag::RGBA)
-                {
-                    valid = true;
-                    break;
-                }
-            }
-
-            if (!valid)
-            {
-                // Invalid color tag, set to button
-                tagPair.first = m_buttonToString[Button::A];
-                tagPair.second = Tag::Picture;
-            }
+            m_tags.push_back(TagPair(tag.m_value, tag.m_type));
         }
     }
 
@@ -1020,47 +2284,29 @@ void mstEditor::LoadSubtitle(int _id, int _page)
     {
         m_subtitles.push_back(QString::fromStdWString(subtitle));
     }
+    RebuildTagStarts();
 
     // Check if number of $ match the number of tags
-    int tagCount = 0;
-    for (QString const& subtitle : m_subtitles)
-    {
-        tagCount += subtitle.count("$");
-    }
+    int tagCount = m_tagStarts.back();
 
     bool forceEdited = false;
     m_subtitleHardcoded = false;
     if (m_tags.isEmpty() && tagCount > 0)
     {
-        // Hard-coded subtitle
-        QMessageBox::StandardButton resBtn = QMessageBox::Yes;
-        QString message = "Subtitle contains $ but has no sounds or buttons.";
-        message += "\nThis is most likely a hard-coded subtitle and not recommended to be edited.";
-        message += "\nYou should keep the same number of $ and edit it at your own risk.";
-        message += "\nEditing will be restricted, do you wish to continue?";
-        resBtn = QMessageBox::warning(this, "Hardcoded Subtitle", message, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
-        if (resBtn == QMessageBox::No)
-        {
-            ResetEditor();
-            item->setForeground(0, QColor(0,0,0));
-            item->setForeground(1, QColor(0,0,0));
-            item->setForeground(2, QColor(0,0,0));
-            return;
-        }
-        else
-        {
-            m_subtitleHardcoded = true;
-        }
+        // Hard-coded subtitle, already listed as an issue when the file was loaded
+        statusBar()->showMessage("Hardcoded subtitle, keep the same number of $. Editing is restricted.", 5000);
+        m_subtitleHardcoded = true;
     }
     else if (m_tags.size() != tagCount)
     {
         // Missing tags
-        QMessageBox::warning(this, "Warning", "Number of $ does not match the number of sounds and buttons!\nAll the tags will be removed!", QMessageBox::Ok);
+        statusBar()->showMessage("Number of $ does not match the number of sounds and buttons, all the tags were removed.", 5000);
         m_tags.clear();
         for (QString& subtitle : m_subtitles)
         {
             subtitle.remove('$');
         }
+        RebuildTagStarts();
         forceEdited = true;
     }
 
@@ -1091,6 +2337,8 @@ void mstEditor::LoadSubtitle(int _id, int _page)
 //---------------------------------------------------------------------------
 void mstEditor::LoadPage(int _page)
 {
+    TRACE_SCOPE("mstEditor::LoadPage");
+
     if (_page < 0 || _page >= m_subtitles.size())
     {
         ui->TE_TextEditor->setText("");
@@ -1106,13 +2354,7 @@ void mstEditor::LoadPage(int _page)
     // Loading a new page, grab all color tags
     GetColorTagsFromCurrentPage(true);
     QString subtitle = m_subtitles[m_page];
-
-    // Count the number of tags it has before this page
-    int tagStart = 0;
-    for (int i = 0; i < m_page; i++)
-    {
-        tagStart += m_subtitles[i].count("$");
-    }
+    int tagStart = GetTagStart(m_page);
 
     // Convert to russian
     if (ui->CB_Russian->isChecked())
@@ -1121,7 +2363,7 @@ void mstEditor::LoadPage(int _page)
     }
 
     int buttonStart = tagStart;
-    int buttonCount = subtitle.count("$");
+    int buttonCount = GetTagStart(m_page + 1) - tagStart;
 
     // Disable sound check box and line edit so their events doesn't get triggered
     ui->TE_TextEditor->setEnabled(false);
@@ -1195,6 +2437,58 @@ void mstEditor::AddButtonComboBox(int _insertAt, Button _button)
 {
     if (_insertAt < 0 || _insertAt > ui->VL_Tags->layout()->count()) return;
 
+    // Rows are reused, they were removed with their signals still connected
+    QHBoxLayout* pictureLayout = TakeButtonRow();
+    QComboBox* comboBox = reinterpret_cast<QComboBox*>(pictureLayout->itemAt(1)->widget());
+    {
+        QSignalBlocker blocker(comboBox);
+        comboBox->setCurrentIndex(_button < Button::COUNT ? _button : 0);
+    }
+
+    // Create layout
+    ui->VL_Tags->insertLayout(_insertAt, pictureLayout);
+    SetRowVisible(pictureLayout, true);
+
+    // Rename id, rows before it are unchanged
+    for (int i = _insertAt; i < ui->VL_Tags->layout()->count(); i++)
+    {
+        QLayoutItem* pictureLayoutItem = ui->VL_Tags->layout()->itemAt(i);
+        QLabel* label = reinterpret_cast<QLabel*>(pictureLayoutItem->layout()->itemAt(0)->widget());
+        label->setText("Picture" + QString::number(i) + ":");
+    }
+}
+
+//---------------------------------------------------------------------------
+// Remove a combo box of given comboID
+//---------------------------------------------------------------------------
+void mstEditor::RemoveButtonComboBox(int _comboID)
+{
+    if (_comboID < 0 || _comboID >= ui->VL_Tags->layout()->count()) return;
+
+    // Keep it for the next page instead of deleting
+    QHBoxLayout* pictureLayout = reinterpret_cast<QHBoxLayout*>(ui->VL_Tags->layout()->takeAt(_comboID)->layout());
+    SetRowVisible(pictureLayout, false);
+    m_buttonRowPool.push_back(pictureLayout);
+
+    // Rename id
+    for (int i = _comboID; i < ui->VL_Tags->layout()->count(); i++)
+    {
+        QLayoutItem* pictureLayoutItem = ui->VL_Tags->layout()->itemAt(i);
+        QLabel* label = reinterpret_cast<QLabel*>(pictureLayoutItem->layout()->itemAt(0)->widget());
+        label->setText("Picture" + QString::number(i) + ":");
+    }
+}
+
+//---------------------------------------------------------------------------
+// Get an unused combo box row, only built when the pool is empty
+//---------------------------------------------------------------------------
+QHBoxLayout* mstEditor::TakeButtonRow()
+{
+    if (!m_buttonRowPool.isEmpty())
+    {
+        return m_buttonRowPool.takeLast();
+    }
+
     QHBoxLayout* pictureLayout = new QHBoxLayout();
     pictureLayout->addStretch();
 
@@ -1211,66 +2505,94 @@ void mstEditor::AddButtonComboBox(int _insertAt, Button _button)
     for (int i = 0; i < Button::COUNT; i++)
     {
         // Add all items
-        comboBox->addItem(m_buttonToCombo[static_cast<Button>(i)]);
-        comboBox->setItemIcon(i, QIcon(":/resources/" + m_buttonToString[static_cast<Button>(i)] + ".png"));
-    }
-    if (_button < Button::COUNT)
-    {
-        // Set current index
-        comboBox->setCurrentIndex(_button);
+        comboBox->addItem(GetButtonIcon(static_cast<Button>(i)), m_buttonToCombo[static_cast<Button>(i)]);
     }
     connect(comboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(on_CB_ComboBox_currentIndexChanged(int)));
 
-    // Create layout
-    ui->VL_Tags->insertLayout(_insertAt + 1, pictureLayout);
+    return pictureLayout;
+}
 
-    // Rename id
-    for (int i = 0; i < ui->VL_Tags->layout()->count(); i++)
+//---------------------------------------------------------------------------
+// Button icons are loaded once and shared by all combo boxes
+//---------------------------------------------------------------------------
+QIcon const& mstEditor::GetButtonIcon(Button _button)
+{
+    QIcon& icon = m_buttonIcons[_button];
+    if (icon.isNull())
     {
-        QLayoutItem* pictureLayoutItem = ui->VL_Tags->layout()->itemAt(i);
-        if (pictureLayoutItem->layout()->count() > 1)
+        icon = QIcon(":/resources/" + m_buttonToString[_button] + ".png");
+    }
+    return icon;
+}
+
+//---------------------------------------------------------------------------
+// Show or hide all widgets of a tag or color row
+//---------------------------------------------------------------------------
+void mstEditor::SetRowVisible(QLayout* _row, bool _visible)
+{
+    for (int i = 0; i < _row->count(); i++)
+    {
+        QWidget* widget = _row->itemAt(i)->widget();
+        if (widget)
         {
-            QLabel* label = reinterpret_cast<QLabel*>(pictureLayoutItem->layout()->itemAt(0)->widget());
-            label->setText("Picture" + QString::number(i) + ":");
+            widget->setVisible(_visible);
         }
     }
 }
 
 //---------------------------------------------------------------------------
-// Remove a combo box of given comboID
+// Remove all combo boxes
 //---------------------------------------------------------------------------
-void mstEditor::RemoveButtonComboBox(int _comboID)
+void mstEditor::RemoveAllButtonComboBox()
 {
-    if (_comboID < 0 || _comboID >= ui->VL_Tags->layout()->count()) return;
-
-    QLayoutItem* pictureLayoutItem = ui->VL_Tags->layout()->takeAt(_comboID);
-    while (pictureLayoutItem->layout()->count() > 0)
+    // From the back so no rows are renumbered
+    for (int i = ui->VL_Tags->layout()->count() - 1; i >= 0; i--)
     {
-        delete pictureLayoutItem->layout()->takeAt(0)->widget(); // Remove all widgets inside
+        RemoveButtonComboBox(i);
     }
-    delete pictureLayoutItem->widget();                         // Remove layout
+}
 
-    // Rename id
-    for (int i = 0; i < ui->VL_Tags->layout()->count(); i++)
+//---------------------------------------------------------------------------
+// Index of the first tag on a page, pages past the end give the tag count
+//---------------------------------------------------------------------------
+int mstEditor::GetTagStart(int _page)
+{
+    return m_tagStarts[_page];
+}
+
+//---------------------------------------------------------------------------
+// Replace the text of a page, tag indices of later pages are shifted
+//---------------------------------------------------------------------------
+void mstEditor::SetPageSubtitle(int _page, QString const& _subtitle)
+{
+    int const diff = _subtitle.count('$') - (m_tagStarts[_page + 1] - m_tagStarts[_page]);
+    m_subtitles[_page] = _subtitle;
+    ShiftTagStarts(_page, diff);
+}
+
+//---------------------------------------------------------------------------
+// Page has _diff more tags, shift the pages after it
+//---------------------------------------------------------------------------
+void mstEditor::ShiftTagStarts(int _page, int _diff)
+{
+    if (_diff == 0) return;
+
+    for (int i = _page + 1; i < m_tagStarts.size(); i++)
     {
-        QLayoutItem* pictureLayoutItem = ui->VL_Tags->layout()->itemAt(i);
-        if (pictureLayoutItem->layout()->count() > 1)
-        {
-            QLabel* label = reinterpret_cast<QLabel*>(pictureLayoutItem->layout()->itemAt(0)->widget());
-            label->setText("Picture" + QString::number(i) + ":");
-        }
+        m_tagStarts[i] += _diff;
     }
 }
 
 //---------------------------------------------------------------------------
-// Remove all combo boxes
+// Count tags of every page again, only when pages are added or removed
 //---------------------------------------------------------------------------
-void mstEditor::RemoveAllButtonComboBox()
+void mstEditor::RebuildTagStarts()
 {
-    int comboCount = ui->VL_Tags->layout()->count();
-    for (int i = 0; i < comboCount; i++)
+    m_tagStarts.resize(m_subtitles.size() + 1);
+    m_tagStarts[0] = 0;
+    for (int i = 0; i < m_subtitles.size(); i++)
     {
-        RemoveButtonComboBox(0);
+        m_tagStarts[i + 1] = m_tagStarts[i] + m_subtitles[i].count('$');
     }
 }
 
@@ -1294,9 +2616,11 @@ void mstEditor::SetCurrentPageLabel()
 //---------------------------------------------------------------------------
 void mstEditor::UpdateSubtitlePreview()
 {
+    TRACE_SCOPE("mstEditor::UpdateSubtitlePreview");
+
     if (m_page == -1 || m_page >= m_subtitles.size())
     {
-        m_previewLabel->setText("");
+        m_preview->Clear();
         return;
     }
 
@@ -1306,14 +2630,11 @@ void mstEditor::UpdateSubtitlePreview()
         subtitle = ToRussian(subtitle);
     }
 
-    int tagID = 0;
+    // Button image for each $ on this page
+    QStringList pictures;
     if (!m_subtitleHardcoded)
     {
-        // Count the number of tags it has before this page
-        for (int i = 0; i < m_page; i++)
-        {
-            tagID += m_subtitles[i].count("$");
-        }
+        int tagID = GetTagStart(m_page);
 
         // Skip the first $ if sound exist
         if (ui->CB_Sound->isChecked())
@@ -1321,57 +2642,37 @@ void mstEditor::UpdateSubtitlePreview()
             subtitle = subtitle.mid(1);
             tagID++;
         }
-    }
-
-    QString htmlString;
-    for(int i = 0; i < subtitle.size(); i++)
-    {
-        QString str(subtitle[i]);
-
-        // Line break in html
-        if (str == "\n") str = "<br>";
-
-        // Space in html
-        if (str == " ") str = "<font color=\"#00000000\" size = \"2\">..</font>";
 
-        // Japanese Space in html
-        if (str == "　") str = "<font color=\"#00000000\">あ</font>";
-
-        // Button images
-        if (str == "$" && !m_subtitleHardcoded)
+        for (QChar const& chr : subtitle)
         {
-            TagPair tagPair = m_tags[tagID];
+            if (chr != '$') continue;
+
+            TagPair const& tagPair = m_tags[tagID];
             Q_ASSERT(tagPair.second != Tag::RGBA && tagPair.second != Tag::Color);
-            if (tagPair.second == Tag::Picture)
-            {
-                str = "<img src=\":/resources/" + tagPair.first + ".png\">";
-            }
+            pictures.push_back(tagPair.second == Tag::Picture ? tagPair.first : QString());
             tagID++;
         }
+    }
 
-        for(ColorBlock const& colorBlock : m_colorBlocks)
-        {
-            if (colorBlock.m_start == i)
-            {
-                QColor const& color = colorBlock.m_color;
-                QString r,g,b,a;
-                r.setNum(color.red(),   16); if (color.red()    < 0x10) r = "0" + r;
-                g.setNum(color.green(), 16); if (color.green()  < 0x10) g = "0" + g;
-                b.setNum(color.blue(),  16); if (color.blue()   < 0x10) b = "0" + b;
-                a.setNum(color.alpha(), 16); if (color.alpha()  < 0x10) a = "0" + a;
-                str = "<font color=\"#" + a + r + g + b + "\">" + str;
-            }
-
-            if (colorBlock.m_end == i)
-            {
-                str = str + "</font>";
-            }
-        }
-
-        htmlString += str;
+    QVector<SubtitleLayout::ColorRange> colors;
+    colors.reserve(m_colorBlocks.size());
+    for (ColorBlock const& colorBlock : m_colorBlocks)
+    {
+        colors.push_back(SubtitleLayout::ColorRange(colorBlock.m_start, colorBlock.m_end, colorBlock.m_color));
     }
 
-    m_previewLabel->setText(htmlString);
+    // Only the lines that changed are laid out and repainted
+    m_preview->SetPage(subtitle, pictures, colors);
+}
+
+//---------------------------------------------------------------------------
+// Font of the in-game text box
+//---------------------------------------------------------------------------
+QFont mstEditor::GetPreviewFont(bool _russian)
+{
+    QFont font(_russian ? "nintendo_NTLG-DB_002" : "FOT-RodinCattleya Pro DB");
+    font.setPixelSize(_russian ? 26 : 27);
+    return font;
 }
 
 //---------------------------------------------------------------------------
@@ -1381,204 +2682,262 @@ void mstEditor::GetColorTagsFromCurrentPage(bool _insertUI)
 {
     if (m_id < 0 || m_page < 0) return;
 
-    QString subtitle = m_subtitles[m_page];
-    m_colorBlocks.clear();
-    int colorIndex = -1;
+    int const tagStart = GetTagStart(m_page);
+    int const tagEnd = GetTagStart(m_page + 1);
 
-    // Count the number of tags it has before this page
-    int tagStart = 0;
-    for (int i = 0; i < m_page; i++)
+    // Pair the colors of this page only
+    MarkupParser::Document document;
+    document.m_tags.reserve(tagEnd - tagStart);
+    for (int i = tagStart; i < tagEnd; i++)
     {
-        tagStart += m_subtitles[i].count("$");
+        document.m_tags.push_back(MarkupParser::MakeTag(m_tags[i].second, m_tags[i].first));
     }
+    MarkupParser::Parse(QVector<QString>() << m_subtitles[m_page], document);
+
+    QString subtitle;
+    QVector<MarkupParser::Node const*> tagNodes;
+    QVector<MarkupParser::Span> spans;
+    MarkupParser::Flatten(document.m_pages[0], subtitle, tagNodes, spans);
 
-    // Temporary remove color $ in m_subtitle[m_page]
-    int tagIndex = subtitle.indexOf('$', 0);
-    int tagID = (tagIndex != -1) ? 0 : -1;
-    while (tagID != -1)
+    // Keep sounds and pictures, the color tags are now blocks
+    QVector<TagPair> pageTags;
+    pageTags.reserve(tagNodes.size());
+    for (MarkupParser::Node const* node : tagNodes)
     {
-        TagPair& tagPair = m_tags[tagStart + tagID];
+        pageTags.push_back(TagPair(node->m_text, node->m_type == MarkupParser::NodeType::Sound ? Tag::Sound : Tag::Picture));
+    }
+    m_tags = m_tags.mid(0, tagStart) + pageTags + m_tags.mid(tagEnd);
+    SetPageSubtitle(m_page, subtitle);
 
-        if (tagPair.second == Tag::RGBA)
-        {
-            ColorBlock colorBlock;
-            colorBlock.m_start = tagIndex;
+    // If sound tag exist, block positions are after its $
+    bool const hasSound = !tagNodes.isEmpty() && tagNodes[0]->m_type == MarkupParser::NodeType::Sound && subtitle.startsWith('$');
+    int const offset = hasSound ? 1 : 0;
 
-            QStringList rgbaStr = tagPair.first.split(",");
-            colorBlock.m_color = QColor(rgbaStr[0].toInt(), rgbaStr[1].toInt(), rgbaStr[2].toInt(), rgbaStr.size() == 4 ? rgbaStr[3].toInt() : 255);
+    m_colorBlocks.clear();
+    m_colorBlocks.reserve(spans.size());
+    for (MarkupParser::Span const& span : spans)
+    {
+        ColorBlock colorBlock;
+        colorBlock.m_color = span.m_color;
+        colorBlock.m_start = qMax(span.m_start - offset, 0);
+        colorBlock.m_end = qMax(span.m_end - offset, 0);
+        m_colorBlocks.push_back(colorBlock);
+    }
 
-            m_colorBlocks.push_front(colorBlock);
-            colorIndex++;
-        }
-        else if (tagPair.second == Tag::Color)
+    if (_insertUI)
+    {
+        for (ColorBlock const& colorBlock : m_colorBlocks)
         {
-            ColorBlock& colorBlock = m_colorBlocks[colorIndex];
-            colorBlock.m_end = tagIndex - 1;
-            colorIndex--;
+            AddColorBlock(ui->VL_Colors->layout()->count(), colorBlock, false);
         }
 
-        if (tagPair.second == Tag::RGBA || tagPair.second == Tag::Color)
+        for (int i = 0; i < m_colorBlocks.size(); i++)
         {
-            subtitle.remove(tagIndex, 1);
-            m_tags.remove(tagStart + tagID);
-
-            tagIndex--;
-            tagID--;
+            UpdateStartEndLimits(i);
         }
+    }
+}
+
+//---------------------------------------------------------------------------
+// Re-insert removed color tags back to the current page
+//---------------------------------------------------------------------------
+void mstEditor::InsertColorTagsToCurrentPage(bool _removeUI)
+{
+    if (m_id < 0 || m_page < 0 || m_colorBlocks.empty()) return;
+
+    QString const subtitle = m_subtitles[m_page];
+    int const tagStart = GetTagStart(m_page);
+    int const tagEnd = GetTagStart(m_page + 1);
+
+    // Skip the first $ if sound exist
+    int const offset = (ui->CB_Sound->isChecked() && subtitle.startsWith('$')) ? 1 : 0;
+    int const length = subtitle.size() - offset;
+
+    // A $ goes before the first and after the last character of each block
+    struct ColorEvent
+    {
+        int m_position;     // Number of characters before the $
+        int m_order;        // 0 close, 1 open, 2 close of an empty block
+        int m_key;          // Outer blocks open first and close last
+        int m_block;
+    };
 
-        tagIndex = subtitle.indexOf('$', tagIndex + 1);
-        tagID = (tagIndex != -1) ? tagID + 1 : -1;
+    QVector<ColorEvent> events;
+    events.reserve(m_colorBlocks.size() * 2);
+    for (int i = 0; i < m_colorBlocks.size(); i++)
+    {
+        ColorBlock const& colorBlock = m_colorBlocks[i];
+        int const open = qBound(0, colorBlock.m_start, length);
+        int const close = qBound(open, colorBlock.m_end + 1, length);
+        events.push_back({open, 1, -close, i});
+        events.push_back({close, close > open ? 0 : 2, -open, i});
     }
+    std::sort(events.begin(), events.end(), [](ColorEvent const& _a, ColorEvent const& _b)
+    {
+        if (_a.m_position != _b.m_position) return _a.m_position < _b.m_position;
+        if (_a.m_order != _b.m_order) return _a.m_order < _b.m_order;
+        if (_a.m_key != _b.m_key) return _a.m_key < _b.m_key;
+        return (_a.m_order == 1) ? (_a.m_block < _b.m_block) : (_a.m_block > _b.m_block);
+    });
 
-    m_subtitles[m_page] = subtitle;
+    // Walk the page once, every $ takes its tag along
+    QString fixedSubtitle;
+    fixedSubtitle.reserve(subtitle.size() + events.size());
+    QVector<TagPair> pageTags;
+    pageTags.reserve(tagEnd - tagStart + events.size());
+    int tagID = tagStart;
+    auto appendChar = [&](QChar _chr)
+    {
+        fixedSubtitle += _chr;
+        if (_chr == '$') pageTags.push_back(m_tags[tagID++]);
+    };
 
-    // Reverse color block order
-    QVector<ColorBlock> temp;
-    for (ColorBlock const& colorBlock : m_colorBlocks)
+    if (offset > 0)
     {
-        temp.push_front(colorBlock);
+        appendChar(subtitle[0]);
     }
-    m_colorBlocks.clear();
-    m_colorBlocks = temp;
 
-    // If sound tag exist, push front all indices by 1
-    if (!m_tags.empty() && m_tags[tagStart].second == Tag::Sound)
-    {
-        for (ColorBlock& colorBlock : m_colorBlocks)
+    int e = 0;
+    for (int position = 0; position <= length; position++)
+    {
+        for (; e < events.size() && events[e].m_position == position; e++)
+        {
+            ColorEvent const& event = events[e];
+            fixedSubtitle += '$';
+            if (event.m_order == 1)
+            {
+                pageTags.push_back(TagPair(MarkupParser::ToRGBAValue(m_colorBlocks[event.m_block].m_color), Tag::RGBA));
+            }
+            else
+            {
+                pageTags.push_back(TagPair("color", Tag::Color));
+            }
+        }
+
+        if (position < length)
         {
-            colorBlock.m_start--;
-            colorBlock.m_end--;
-            Q_ASSERT(colorBlock.m_start >= 0 && colorBlock.m_end >= 0);
+            appendChar(subtitle[offset + position]);
         }
     }
 
-    if (_insertUI)
+    m_tags = m_tags.mid(0, tagStart) + pageTags + m_tags.mid(tagEnd);
+    SetPageSubtitle(m_page, fixedSubtitle);
+
+    if (_removeUI)
     {
-        for (ColorBlock const& colorBlock : m_colorBlocks)
-        {
-            AddColorBlock(ui->VL_Colors->layout()->count(), colorBlock);
-        }
+        RemoveAllColorBlocks();
     }
 }
 
 //---------------------------------------------------------------------------
-// Re-insert removed color tags back to the current page
+// Add color blocks to the editor
 //---------------------------------------------------------------------------
-void mstEditor::InsertColorTagsToCurrentPage(bool _removeUI)
+void mstEditor::AddColorBlock(int _insertAt, ColorBlock _colorBlock, bool _updateLimits)
 {
-    if (m_id < 0 || m_page < 0 || m_colorBlocks.empty()) return;
+    QHBoxLayout* colorLayout = TakeColorRow();
 
-    QString const subtitle = m_subtitles[m_page];
-    int tagStart = 0;
+    // Color (1)
+    QTextBrowser* colorBrowser = reinterpret_cast<QTextBrowser*>(colorLayout->itemAt(1)->widget());
+    QPalette pal = palette();
+    pal.setColor(QPalette::Base, _colorBlock.m_color.rgb());
+    colorBrowser->setPalette(pal);
 
-    // Count the number of tags it has before this page
-    for (int i = 0; i < m_page; i++)
-    {
-        tagStart += m_subtitles[i].count("$");
-    }
+    // Alpha (2), Start (4), End (6), they are connected already
+    QSpinBox* alpha = reinterpret_cast<QSpinBox*>(colorLayout->itemAt(2)->widget());
+    QSpinBox* start = reinterpret_cast<QSpinBox*>(colorLayout->itemAt(4)->widget());
+    QSpinBox* end = reinterpret_cast<QSpinBox*>(colorLayout->itemAt(6)->widget());
+    QSignalBlocker alphaBlocker(alpha);
+    QSignalBlocker startBlocker(start);
+    QSignalBlocker endBlocker(end);
+    alpha->setValue(_colorBlock.m_color.alpha());
+    start->setRange(0, m_subtitles[m_page].size() - 1);
+    start->setValue(_colorBlock.m_start);
+    end->setRange(0, m_subtitles[m_page].size() - 1);
+    end->setValue(_colorBlock.m_end);
 
-    // Skip the first $ if sound exist
-    if (ui->CB_Sound->isChecked())
+    // Create layout
+    ui->VL_Colors->insertLayout(_insertAt, colorLayout);
+    SetRowVisible(colorLayout, true);
+
+    for (int i = _insertAt; i < ui->VL_Colors->layout()->count(); i++)
     {
-        tagStart++;
+        SetColorRowIndex(i);
     }
 
-    // Add back color to m_tags
-    for(int i = 0; i < m_colorBlocks.size(); i++)
+    // Loading a page adds every block first and updates the limits once
+    if (!_updateLimits) return;
+    for (int i = 0; i < ui->VL_Colors->layout()->count(); i++)
     {
-        ColorBlock& colorBlock = m_colorBlocks[i];
-
-        QVector<int> positions;
-        positions.push_back(colorBlock.m_start);
-        positions.push_back(colorBlock.m_end);
-
-        while(!positions.empty())
-        {
-            int position = positions[0];
-            positions.pop_front();
-
-            // Find how many tag exist before this position
-            QString subStr = subtitle.mid(ui->CB_Sound->isChecked() ? 1 : 0, position);
-            int tagID = subStr.count('$');
+        UpdateStartEndLimits(i);
+    }
+}
 
-            // Also add the number color tags exist before this position
-            for (int j = 0; j < i; j++)
-            {
-                ColorBlock& checkColorBlock = m_colorBlocks[j];
-                if (checkColorBlock.m_start < position) tagID++;
-                if (checkColorBlock.m_end < position) tagID++;
-            }
+//---------------------------------------------------------------------------
+// Remove color blocks from the editor
+//---------------------------------------------------------------------------
+void mstEditor::RemoveColorBlock(int _colorID)
+{
+    if (_colorID < 0 || _colorID >= m_colorBlocks.size()) return;
 
-            if (!positions.empty())
-            {
-                // Front
-                QColor const& color = colorBlock.m_color;
-                QString tagStr = QString::number(color.red()) + "," + QString::number(color.green()) + "," + QString::number(color.blue());
-                if (color.alpha() != 255)
-                {
-                    tagStr += "," + QString::number(color.alpha());
-                }
-                m_tags.insert(tagStart + tagID, TagPair(tagStr, Tag::RGBA));
-            }
-            else
-            {
-                // Need to add 1 to ID, start must be before end
-                tagID++;
+    // Keep it for the next page instead of deleting
+    QHBoxLayout* colorLayout = reinterpret_cast<QHBoxLayout*>(ui->VL_Colors->layout()->takeAt(_colorID)->layout());
+    SetRowVisible(colorLayout, false);
+    m_colorRowPool.push_back(colorLayout);
+    m_colorBlocks.remove(_colorID);
 
-                // Back
-                m_tags.insert(tagStart + tagID, TagPair("color", Tag::Color));
-            }
-        }
+    // Hidden widgets no longer belong to any row
+    for (int i = 0; i < colorLayout->count(); i++)
+    {
+        m_colorWidgets.remove(colorLayout->itemAt(i)->widget());
     }
 
-    // Finally add back all the $ to the subtitle
-    QString fixedSubtitle;
-    for(int i = 0; i < subtitle.size(); i++)
+    for (int i = _colorID; i < ui->VL_Colors->layout()->count(); i++)
     {
-        QString str(subtitle[i]);
-        for(ColorBlock const& colorBlock : m_colorBlocks)
-        {
-            if (colorBlock.m_start + (ui->CB_Sound->isChecked() ? 1 : 0) == i)
-            {
-                str = "$" + str;
-            }
-
-            if (colorBlock.m_end + (ui->CB_Sound->isChecked() ? 1 : 0) == i)
-            {
-                str = str + "$";
-            }
-        }
-        fixedSubtitle += str;
+        SetColorRowIndex(i);
     }
+}
 
-    m_subtitles[m_page] = fixedSubtitle;
+//---------------------------------------------------------------------------
+// Label a color row and point its widgets at it
+//---------------------------------------------------------------------------
+void mstEditor::SetColorRowIndex(int _colorID)
+{
+    QLayout* colorLayout = ui->VL_Colors->layout()->itemAt(_colorID)->layout();
+    QLabel* idLabel = reinterpret_cast<QLabel*>(colorLayout->itemAt(0)->widget());
+    idLabel->setText("Color" + QString::number(_colorID) + ":");
 
-    if (_removeUI)
+    // Widget positions are fixed by TakeColorRow()
+    static ColorRole const roles[] = {ColorRole::Color, ColorRole::Alpha, ColorRole::Start, ColorRole::End, ColorRole::Delete};
+    static int const positions[] = {1, 2, 4, 6, 8};
+    for (int i = 0; i < 5; i++)
     {
-        RemoveAllColorBlocks();
+        ColorWidget& colorWidget = m_colorWidgets[colorLayout->itemAt(positions[i])->widget()];
+        colorWidget.m_row = _colorID;
+        colorWidget.m_role = roles[i];
     }
 }
 
 //---------------------------------------------------------------------------
-// Add color blocks to the editor
+// Get an unused color row, only built when the pool is empty
 //---------------------------------------------------------------------------
-void mstEditor::AddColorBlock(int _insertAt, ColorBlock _colorBlock)
+QHBoxLayout* mstEditor::TakeColorRow()
 {
+    if (!m_colorRowPool.isEmpty())
+    {
+        return m_colorRowPool.takeLast();
+    }
+
     QHBoxLayout* colorLayout = new QHBoxLayout();
 
     // Label (0)
     QLabel* label = new QLabel();
     label->setMinimumSize(80,22);
-    label->setText("Color" + QString::number(ui->VL_Colors->layout()->count()) + ":");
     colorLayout->addWidget(label);
 
     // Color (1)
     QTextBrowser *colorBrowser = new QTextBrowser();
     colorBrowser->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     colorBrowser->setMaximumSize(27,27);
-    QPalette pal = palette();
-    pal.setColor(QPalette::Base, _colorBlock.m_color.rgb());
-    colorBrowser->setPalette(pal);
     colorBrowser->installEventFilter(this);
     colorLayout->addWidget(colorBrowser);
 
@@ -1587,7 +2946,6 @@ void mstEditor::AddColorBlock(int _insertAt, ColorBlock _colorBlock)
     alpha->setStyleSheet("font: 14px");
     alpha->setFixedSize(50,27);
     alpha->setRange(0,255);
-    alpha->setValue(_colorBlock.m_color.alpha());
     alpha->setCursor(Qt::SizeVerCursor);
     alpha->installEventFilter(this);
     colorLayout->addWidget(alpha);
@@ -1604,9 +2962,6 @@ void mstEditor::AddColorBlock(int _insertAt, ColorBlock _colorBlock)
     QSpinBox *start = new QSpinBox();
     start->setStyleSheet("font: 14px");
     start->setFixedSize(50,27);
-    start->setMinimum(0);
-    start->setMaximum(m_subtitles[m_page].size() - 1);
-    start->setValue(_colorBlock.m_start);
     start->setCursor(Qt::SizeVerCursor);
     start->installEventFilter(this);
     colorLayout->addWidget(start);
@@ -1621,9 +2976,6 @@ void mstEditor::AddColorBlock(int _insertAt, ColorBlock _colorBlock)
     QSpinBox *end = new QSpinBox();
     end->setStyleSheet("font: 14px");
     end->setFixedSize(50,27);
-    end->setMinimum(0);
-    end->setMaximum(m_subtitles[m_page].size() - 1);
-    end->setValue(_colorBlock.m_end);
     end->setCursor(Qt::SizeVerCursor);
     end->installEventFilter(this);
     colorLayout->addWidget(end);
@@ -1644,51 +2996,74 @@ void mstEditor::AddColorBlock(int _insertAt, ColorBlock _colorBlock)
     colorLayout->addWidget(del);
     connect(del, SIGNAL(clicked()), this, SLOT(ColorDeletePressed()));
 
-    // Create layout
     colorLayout->addStretch();
-    ui->VL_Colors->insertLayout(_insertAt, colorLayout);
+    return colorLayout;
+}
 
-    for (int i = 0; i < ui->VL_Colors->layout()->count(); i++)
+//---------------------------------------------------------------------------
+// Remove all color blocks
+//---------------------------------------------------------------------------
+void mstEditor::RemoveAllColorBlocks()
+{
+    // From the back so no rows are renumbered
+    while(!m_colorBlocks.empty())
     {
-        QLayoutItem* colorLayoutItem = ui->VL_Colors->layout()->itemAt(i);
-        QLabel* idLabel = reinterpret_cast<QLabel*>(colorLayoutItem->layout()->itemAt(0)->widget());
-        idLabel->setText("Color" + QString::number(i) + ":");
-
-        UpdateStartEndLimits(i);
+        RemoveColorBlock(m_colorBlocks.size() - 1);
     }
 }
 
 //---------------------------------------------------------------------------
-// Add color blocks to the editor
+// Move color blocks with the text around them, text typed inside a
+// block is colored too, blocks with nothing left are removed
 //---------------------------------------------------------------------------
-void mstEditor::RemoveColorBlock(int _colorID)
+void mstEditor::ShiftColorBlocks(int _position, int _removed, int _added)
 {
-    if (_colorID < 0 || _colorID >= m_colorBlocks.size()) return;
-
-    QLayoutItem* colorLayoutItem = ui->VL_Colors->layout()->takeAt(_colorID);
-    while (colorLayoutItem->layout()->count() > 0)
+    int const diff = _added - _removed;
+    int const length = ui->TE_TextEditor->document()->characterCount() - 1;
+    bool changed = false;
+    for (int i = m_colorBlocks.size() - 1; i >= 0; i--)
     {
-        delete colorLayoutItem->layout()->takeAt(0)->widget(); // Remove all widgets inside
+        ColorBlock& colorBlock = m_colorBlocks[i];
+        int start = colorBlock.m_start;
+        int end = colorBlock.m_end;
+
+        if (start >= _position + _removed) start += diff;
+        else if (start >= _position) start = _position;
+
+        if (end >= _position + _removed) end += diff;
+        else if (end >= _position) end = _position + _added - 1;
+
+        if (end < start || end >= length)
+        {
+            RemoveColorBlock(i);
+            continue;
+        }
+
+        changed |= (start != colorBlock.m_start || end != colorBlock.m_end);
+        colorBlock.m_start = start;
+        colorBlock.m_end = end;
     }
-    delete colorLayoutItem->widget();                          // Remove layout
-    m_colorBlocks.remove(_colorID);
 
-    for (int i = 0; i < ui->VL_Colors->layout()->count(); i++)
+    if (!changed) return;
+
+    // Blocks are already correct, spin boxes only need to show it
+    for (int i = 0; i < m_colorBlocks.size(); i++)
     {
         QLayoutItem* colorLayoutItem = ui->VL_Colors->layout()->itemAt(i);
-        QLabel* idLabel = reinterpret_cast<QLabel*>(colorLayoutItem->layout()->itemAt(0)->widget());
-        idLabel->setText("Color" + QString::number(i) + ":");
+        QSpinBox* start = reinterpret_cast<QSpinBox*>(colorLayoutItem->layout()->itemAt(4)->widget());
+        QSpinBox* end = reinterpret_cast<QSpinBox*>(colorLayoutItem->layout()->itemAt(6)->widget());
+
+        QSignalBlocker startBlocker(start);
+        QSignalBlocker endBlocker(end);
+        start->setRange(0, qMax(0, length - 1));
+        end->setRange(0, qMax(0, length - 1));
+        start->setValue(m_colorBlocks[i].m_start);
+        end->setValue(m_colorBlocks[i].m_end);
     }
-}
 
-//---------------------------------------------------------------------------
-// Remove all color blocks
-//---------------------------------------------------------------------------
-void mstEditor::RemoveAllColorBlocks()
-{
-    while(!m_colorBlocks.empty())
+    for (int i = 0; i < m_colorBlocks.size(); i++)
     {
-        RemoveColorBlock(0);
+        UpdateStartEndLimits(i);
     }
 }
 
@@ -1742,51 +3117,23 @@ void mstEditor::UpdateStartEndLimits(int _colorID)
 //---------------------------------------------------------------------------
 void mstEditor::ColorSpinBoxChanged(int _value)
 {
-    QWidget* widget = reinterpret_cast<QWidget*>(sender());
-
-    int indexAlpha = -1;
-    for (int i = 0; i < ui->VL_Colors->layout()->count(); i++)
-    {
-        // Look for alpha
-        QLayoutItem* colorLayoutItem = ui->VL_Colors->layout()->itemAt(i);
-        if (colorLayoutItem->layout()->itemAt(2)->widget() == widget)
-        {
-            indexAlpha = i;
-            break;
-        }
-    }
-
-    int indexStart = -1;
-    int indexEnd = -1;
-    for (int i = 0; i < ui->VL_Colors->layout()->count(); i++)
-    {
-        // Look for start or end
-        QLayoutItem* colorLayoutItem = ui->VL_Colors->layout()->itemAt(i);
-        if (colorLayoutItem->layout()->itemAt(4)->widget() == widget)
-        {
-            indexStart = i;
-            break;
-        }
-        else if (colorLayoutItem->layout()->itemAt(6)->widget() == widget)
-        {
-            indexEnd = i;
-            break;
-        }
-    }
+    ColorWidget const colorWidget = m_colorWidgets.value(reinterpret_cast<QWidget*>(sender()));
+    int const index = colorWidget.m_row;
+    if (index < 0) return;
 
-    if (indexAlpha != -1)
+    if (colorWidget.m_role == ColorRole::Alpha)
     {
-        m_colorBlocks[indexAlpha].m_color.setAlpha(_value);
+        m_colorBlocks[index].m_color.setAlpha(_value);
     }
-    else if (indexStart != -1)
+    else if (colorWidget.m_role == ColorRole::Start)
     {
-        m_colorBlocks[indexStart].m_start = _value;
-        UpdateStartEndLimits(indexStart);
+        m_colorBlocks[index].m_start = _value;
+        UpdateStartEndLimits(index);
     }
-    else if (indexEnd != -1)
+    else if (colorWidget.m_role == ColorRole::End)
     {
-        m_colorBlocks[indexEnd].m_end = _value;
-        UpdateStartEndLimits(indexEnd);
+        m_colorBlocks[index].m_end = _value;
+        UpdateStartEndLimits(index);
     }
     else
     {
@@ -1802,25 +3149,27 @@ void mstEditor::ColorSpinBoxChanged(int _value)
 //---------------------------------------------------------------------------
 void mstEditor::ColorDeletePressed()
 {
-    QWidget* widget = reinterpret_cast<QWidget*>(sender());
-    int index = -1;
-    for (int i = 0; i < ui->VL_Colors->layout()->count(); i++)
-    {
-        QLayoutItem* colorLayoutItem = ui->VL_Colors->layout()->itemAt(i);
-        if (colorLayoutItem->layout()->itemAt(8)->widget() == widget)
-        {
-            index = i;
-            break;
-        }
-    }
-
-    if (index == -1) return;
+    ColorWidget const colorWidget = m_colorWidgets.value(reinterpret_cast<QWidget*>(sender()));
+    int const index = colorWidget.m_row;
+    if (index < 0 || colorWidget.m_role != ColorRole::Delete) return;
 
     RemoveColorBlock(index);
     UpdateSubtitlePreview();
     SetSubtitleEdited(true);
 }
 
+//---------------------------------------------------------------------------
+// Mark file as edited, each edit bumps the revision
+//---------------------------------------------------------------------------
+void mstEditor::SetFileEdited(bool _edited)
+{
+    m_fileEdited = _edited;
+    if (_edited)
+    {
+        m_fileRevision++;
+    }
+}
+
 //---------------------------------------------------------------------------
 // Set apply and reset button enabled
 //---------------------------------------------------------------------------
@@ -1867,6 +3216,7 @@ void mstEditor::on_PB_PageNext_clicked()
 void mstEditor::on_PB_PageAdd_clicked()
 {
     m_subtitles.push_back("*INSERT SUBTITLE HERE*");
+    m_tagStarts.push_back(m_tagStarts.back());
     LoadPage(m_subtitles.size() - 1);
     SetCurrentPageLabel();
 
@@ -1882,6 +3232,7 @@ void mstEditor::on_PB_PageDelete_clicked()
     ui->TE_TextEditor->setText("");     // Event will remove tags and set m_subtitle[m_page]
 
     m_subtitles.remove(m_page);
+    RebuildTagStarts();
     LoadPage(max(m_page - 1, 0));
 
     SetSubtitleEdited(true);
@@ -1909,34 +3260,21 @@ void mstEditor::on_PB_Save_clicked()
         entry.m_subtitles.push_back(subtitle.toStdWString());
     }
 
+    entry.m_tags.reserve(static_cast<size_t>(m_tags.size()));
     for (TagPair const& tagPair : m_tags)
     {
-        if (tagPair.second == Tag::Sound)
-        {
-            entry.m_tags.push_back("sound(" + tagPair.first.toStdString() + ")");
-        }
-        else if (tagPair.second == Tag::RGBA)
-        {
-            entry.m_tags.push_back("rgba(" + tagPair.first.toStdString() + ")");
-        }
-        else if (tagPair.second == Tag::Color)
-        {
-            entry.m_tags.push_back("color");
-        }
-        else
-        {
-            entry.m_tags.push_back("picture(" + tagPair.first.toStdString() + ")");
-        }
+        entry.m_tags.push_back(MarkupParser::ToString(tagPair.second, tagPair.first));
     }
 
     // Replace entry
+    PushEditStep(EditType::Modify, m_id);
     m_mst.ModifyEntry(static_cast<unsigned int>(m_id), entry);
 
     // Update in Tree View
     TW_AddOrReplaceEntry(entry, m_id);
 
     // Save and reset button
-    m_fileEdited = true;
+    SetFileEdited(true);
     SetSubtitleEdited(false);
 
     // Remove color tags again
@@ -2016,68 +3354,86 @@ void mstEditor::on_PB_ColorAdd_clicked()
 }
 
 //---------------------------------------------------------------------------
-// Editing subtitle
+// Editing subtitle, only the changed span is processed
 //---------------------------------------------------------------------------
-void mstEditor::on_TE_TextEditor_textChanged()
+void mstEditor::TextEditorContentsChange(int position, int charsRemoved, int charsAdded)
 {
-    if (!ui->TE_TextEditor->isEnabled()) return;
+    if (!ui->TE_TextEditor->isEnabled() || m_page < 0 || m_convertingText) return;
 
     bool useSound = ui->CB_Sound->isEnabled() && ui->CB_Sound->isChecked();
-    QString currentText = ui->TE_TextEditor->toPlainText();
+    int const offset = useSound ? 1 : 0;
+    QString const& prevText = m_subtitles[m_page];
+    int const prevLength = prevText.size() - offset;
+    int const currentLength = ui->TE_TextEditor->document()->characterCount() - 1;
 
-    if (!m_subtitleHardcoded)
-    {
-        // Count the number of tags it has before this page
-        int pictureTagStart = 0;
-        for (int i = 0; i < m_page; i++)
-        {
-            pictureTagStart += m_subtitles[i].count("$");
-        }
-        pictureTagStart += (useSound ? 1 : 0);
+    // The last paragraph separator can be included, it is not part of the text
+    position = qBound(0, position, qMin(prevLength, currentLength));
+    charsRemoved = qBound(0, charsRemoved, prevLength - position);
+    charsAdded = qBound(0, charsAdded, currentLength - position);
 
-        // Find the difference of tag count
-        QString prevText = m_subtitles[m_page];
-        int prevTagCount = prevText.count("$");
-        int currentTagCount = currentText.count("$") + (useSound ? 1 : 0);
+    QTextCursor cursor(ui->TE_TextEditor->document());
+    cursor.setPosition(position);
+    cursor.setPosition(position + charsAdded, QTextCursor::KeepAnchor);
+    QString added = cursor.selectedText().replace(QChar::ParagraphSeparator, '\n');
+    QString removed = prevText.mid(offset + position, charsRemoved);
 
-        // Insert or delete combo boxes
-        if (prevTagCount > currentTagCount)
-        {
-            for (int i = 0; i < (prevTagCount - currentTagCount); i++)
-            {
-                int index = ui->VL_Tags->layout()->count() - 1;
-                m_tags.remove(pictureTagStart + index);
-                RemoveButtonComboBox(index);
-            }
-        }
-        else if (currentTagCount > prevTagCount)
-        {
-            for (int i = 0; i < (currentTagCount - prevTagCount); i++)
-            {
-                int index = ui->VL_Tags->layout()->count();
-                m_tags.insert(pictureTagStart + index, TagPair(m_buttonToString[Button::A], Tag::Picture));
-                AddButtonComboBox(index);
-            }
-        }
+    // setText and format changes report everything as replaced, skip what is the same
+    int samePrefix = 0;
+    while (samePrefix < removed.size() && samePrefix < added.size() && removed[samePrefix] == added[samePrefix])
+    {
+        samePrefix++;
+    }
+    int sameSuffix = 0;
+    while (sameSuffix < removed.size() - samePrefix && sameSuffix < added.size() - samePrefix
+           && removed[removed.size() - 1 - sameSuffix] == added[added.size() - 1 - sameSuffix])
+    {
+        sameSuffix++;
     }
+    position += samePrefix;
+    removed = removed.mid(samePrefix, removed.size() - samePrefix - sameSuffix);
+    added = added.mid(samePrefix, added.size() - samePrefix - sameSuffix);
+    if (removed.isEmpty() && added.isEmpty()) return;
 
-    m_subtitles[m_page] = (useSound ? "$" : "") + currentText;
+    // Same length with every $ where it was only swaps characters,
+    // tags and color blocks stay as they are
+    bool substitution = removed.size() == added.size();
+    for (int i = 0; substitution && i < removed.size(); i++)
+    {
+        substitution = (removed[i] == '$') == (added[i] == '$');
+    }
+    if (substitution)
+    {
+        m_subtitles[m_page].replace(offset + position, removed.size(), added);
+        UpdateSubtitlePreview();
+        SetSubtitleEdited(true);
+        return;
+    }
 
-    // If color block range is outside subtitle, remove it
-    for (int i = m_colorBlocks.size() - 1; i >= 0; i--)
+    int const removedTagCount = removed.count('$');
+    int const addedTagCount = added.count('$');
+    if (!m_subtitleHardcoded && (removedTagCount > 0 || addedTagCount > 0))
     {
-        if (m_colorBlocks[i].m_end > (m_subtitles[m_page].size() - 1) || m_colorBlocks[i].m_start > (m_subtitles[m_page].size() - 1))
+        // Tags are in the same order as $, find the first one at the change
+        int const pictureTagStart = GetTagStart(m_page) + offset;
+        int const index = prevText.midRef(offset, position).count('$');
+
+        for (int i = 0; i < removedTagCount; i++)
         {
-            RemoveColorBlock(i);
+            m_tags.remove(pictureTagStart + index);
+            RemoveButtonComboBox(index);
         }
-    }
 
-    // Update limits of color blocks
-    for (int i = 0; i < m_colorBlocks.size(); i++)
-    {
-        UpdateStartEndLimits(i);
+        for (int i = 0; i < addedTagCount; i++)
+        {
+            m_tags.insert(pictureTagStart + index, TagPair(m_buttonToString[Button::A], Tag::Picture));
+            AddButtonComboBox(index);
+        }
     }
 
+    m_subtitles[m_page].replace(offset + position, removed.size(), added);
+    ShiftTagStarts(m_page, addedTagCount - removedTagCount);
+    ShiftColorBlocks(position, removed.size(), added.size());
+
     UpdateSubtitlePreview();
     SetSubtitleEdited(true);
 }
@@ -2087,13 +3443,7 @@ void mstEditor::on_TE_TextEditor_textChanged()
 //---------------------------------------------------------------------------
 void mstEditor::on_CB_ComboBox_currentIndexChanged(int index)
 {
-    // Count the number of tags it has before this page
-    int tagID = 0;
-    for (int i = 0; i < m_page; i++)
-    {
-        tagID += m_subtitles[i].count("$");
-    }
-    tagID += (ui->CB_Sound->isChecked() ? 1 : 0);
+    int tagID = GetTagStart(m_page) + (ui->CB_Sound->isChecked() ? 1 : 0);
 
     QComboBox* comboBox = reinterpret_cast<QComboBox*>(sender());
     int tagIndex = -1;
@@ -2125,23 +3475,18 @@ void mstEditor::on_CB_Sound_stateChanged(int state)
 {
     if (m_page < 0 || !ui->CB_Sound->isEnabled()) return;
 
-    // Count the number of tags it has before this page
-    int tagID = 0;
-    for (int i = 0; i < m_page; i++)
-    {
-        tagID += m_subtitles[i].count("$");
-    }
+    int tagID = GetTagStart(m_page);
 
     // Remove or insert tag
-    QString& subtitle = m_subtitles[m_page];
+    QString const& subtitle = m_subtitles[m_page];
     if (state == Qt::Checked)
     {
-        subtitle = "$" + subtitle;
+        SetPageSubtitle(m_page, "$" + subtitle);
         m_tags.insert(tagID, TagPair("", Tag::Sound));
     }
     else
     {
-        subtitle = subtitle.mid(1);
+        SetPageSubtitle(m_page, subtitle.mid(1));
         m_tags.remove(tagID);
     }
 
@@ -2170,15 +3515,8 @@ void mstEditor::on_LE_Sound_textEdited(const QString &str)
 {
     if (m_page < 0 || !ui->LE_Sound->isEnabled()) return;
 
-    // Count the number of tags it has before this page
-    int tagID = 0;
-    for (int i = 0; i < m_page; i++)
-    {
-        tagID += m_subtitles[i].count("$");
-    }
-
     // Update tag
-    m_tags[tagID].first = str;
+    m_tags[GetTagStart(m_page)].first = str;
 
     SetSubtitleEdited(true);
 }
@@ -2204,10 +3542,8 @@ QString mstEditor::ToRussian(QString const& str)
     QString returnStr = str;
     for(QChar& chr : returnStr)
     {
-        if (m_unicodeToRussian.contains(chr))
-        {
-            chr = m_unicodeToRussian[chr];
-        }
+        // Read-only access, this is also used by the loading worker
+        chr = m_unicodeToRussian.value(chr, chr);
     }
     return returnStr;
 }
@@ -2233,28 +3569,123 @@ QString mstEditor::ToUnicode(QString const& str)
 //---------------------------------------------------------------------------
 void mstEditor::on_CB_Russian_clicked(bool checked)
 {
-    if (checked)
+    m_preview->SetFont(GetPreviewFont(checked));
+
+    // Only rows on screen are converted
+    m_russianDelegate->SetEnabled(checked);
+    ui->TW_TreeWidget->viewport()->update();
+
+    // Characters map one to one and $ never changes, so tags and
+    // color blocks stay where they are
+    for (QString& subtitle : m_subtitles)
     {
-        m_previewLabel->setStyleSheet("font: 26px \"nintendo_NTLG-DB_002\"; color: white;");
+        subtitle = checked ? ToRussian(subtitle) : ToUnicode(subtitle);
     }
-    else
+
+    m_convertingText = true;
+    QString textEdit = ui->TE_TextEditor->toPlainText();
+    ui->TE_TextEditor->setText(checked ? ToRussian(textEdit) : ToUnicode(textEdit));
+    m_convertingText = false;
+
+    UpdateSubtitlePreview();
+}
+
+//---------------------------------------------------------------------------
+// Same fonts and images as the preview, usable from any thread
+//---------------------------------------------------------------------------
+PreviewRenderer::Options mstEditor::GetPreviewOptions()
+{
+    bool const russian = ui->CB_Russian->isChecked();
+
+    PreviewRenderer::Options options;
+    options.m_background = QImage(":/resources/TextBox.png");
+    options.m_font = GetPreviewFont(russian);
+    if (russian)
+    {
+        options.m_charMap = m_unicodeToRussian;
+    }
+    options.m_textOffset = m_preview->pos();
+    options.m_textSize = m_preview->size();
+    return options;
+}
+
+//---------------------------------------------------------------------------
+// Same font and text box as the preview
+//---------------------------------------------------------------------------
+OverflowAnalyzer::Options mstEditor::GetOverflowOptions()
+{
+    bool const russian = ui->CB_Russian->isChecked();
+
+    OverflowAnalyzer::Options options;
+    options.m_font = GetPreviewFont(russian);
+    if (russian)
     {
-        m_previewLabel->setStyleSheet("font: 27px \"FOT-RodinCattleya Pro DB\"; color: white;");
+        options.m_charMap = m_unicodeToRussian;
     }
+    options.m_boxSize = m_preview->size();
+    return options;
+}
+
+//---------------------------------------------------------------------------
+// Start rendering jobs on the thread pool
+//---------------------------------------------------------------------------
+void mstEditor::RenderPreviews(QList<PreviewRenderer::Job> const& _jobs, QString const& _outputDir)
+{
+    m_renderOutputDir = _outputDir;
+
+    m_renderProgress = new QProgressDialog("Rendering previews...", "Cancel", 0, _jobs.size(), this);
+    m_renderProgress->setWindowTitle("Render Previews");
+    m_renderProgress->setWindowModality(Qt::WindowModal);
+    m_renderProgress->setMinimumDuration(250);
+    m_renderProgress->setAutoClose(false);
+    m_renderProgress->setAutoReset(false);
+    m_renderProgress->setValue(0);
+    connect(&m_renderWatcher, SIGNAL(progressValueChanged(int)), m_renderProgress, SLOT(setValue(int)));
+    connect(m_renderProgress, SIGNAL(canceled()), &m_renderWatcher, SLOT(cancel()));
+
+    m_renderWatcher.setFuture(QtConcurrent::mapped(_jobs, PreviewRenderer(GetPreviewOptions())));
+}
+
+//---------------------------------------------------------------------------
+// All rendering jobs are done or cancelled
+//---------------------------------------------------------------------------
+void mstEditor::RenderPreviewsFinished()
+{
+    m_renderProgress->deleteLater();
+    m_renderProgress = Q_NULLPTR;
 
-    for(int i = 0; i < ui->TW_TreeWidget->topLevelItemCount(); i++)
+    // Jobs that finished before cancelling still have their results
+    int imageCount = 0;
+    QStringList errors;
+    for (PreviewRenderer::Result const& result : m_renderWatcher.future().results())
     {
-        QTreeWidgetItem* item = ui->TW_TreeWidget->topLevelItem(i);
-        QString str = item->text(1);
-        item->setText(1, checked ? ToRussian(str) : ToUnicode(str));
+        imageCount += result.m_imageCount;
+        if (!result.m_errorMsg.isEmpty())
+        {
+            errors.push_back(result.m_errorMsg);
+        }
     }
 
-    bool wasEdited = m_subtitleEdited;
+    QString message = QString::number(imageCount) + " images have been saved to " + m_renderOutputDir;
+    if (m_renderWatcher.isCanceled())
+    {
+        message = "Rendering cancelled, " + message;
+    }
 
-    QString textEdit = ui->TE_TextEditor->toPlainText();
-    ui->TE_TextEditor->setText(checked ? ToRussian(textEdit) : ToUnicode(textEdit));
+    if (errors.isEmpty())
+    {
+        QMessageBox::information(this, "Render Previews", message, QMessageBox::Ok);
+    }
+    else
+    {
+        QMessageBox::warning(this, "Render Previews", message + "\n\n" + errors.join("\n"), QMessageBox::Ok);
+    }
 
-    SetSubtitleEdited(wasEdited);
+    // Open file explorer
+    if (imageCount > 0)
+    {
+        QDesktopServices::openUrl(QUrl::fromLocalFile(m_renderOutputDir));
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -5,26 +5,49 @@
 #include <QColorDialog>
 #include <QComboBox>
 #include <QDesktopServices>
+#include <QDockWidget>
 #include <QDebug>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QFile>
 #include <QFontDatabase>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QTreeWidgetItem>
 #include <QMap>
 #include <QMainWindow>
 #include <QMessageBox>
 #include <QMimeData>
+#include <QMutex>
+#include <QProgressDialog>
+#include <QScopedPointer>
 #include <QScrollBar>
+#include <QSet>
 #include <QSettings>
 #include <QShortcut>
 #include <QSpinBox>
+#include <QSplitter>
+#include <QStatusBar>
 #include <QTextCodec>
+#include <QTextCursor>
 #include <QTextBrowser>
+#include <QtConcurrent>
 #include <QValidator>
 #include <QPainter>
+#include <QSharedPointer>
 
+#include <atomic>
+
+#include "charmapdelegate.h"
+#include "markupparser.h"
+#include "markupvalidator.h"
 #include "mst.h"
+#include "mstdiff.h"
+#include "mstmerge.h"
+#include "overflowanalyzer.h"
+#include "previewrenderer.h"
+#include "subtitlepreview.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -50,14 +73,6 @@ enum Button : int {
     COUNT
 };
 
-// Tag Type enum
-enum Tag : int {
-    Sound,
-    Picture,
-    RGBA,
-    Color
-};
-
 // Drag box enum
 enum DragBox : int {
     Alpha,
@@ -91,10 +106,23 @@ private slots:
     void on_actionExport_triggered();
     void on_actionAbout_Qt_triggered();
     void on_actionAbout_mstEditor_triggered();
+    void on_actionRenderPreviews_triggered();
+    void on_actionRenderFolderPreviews_triggered();
+    void on_actionCheckOverflow_triggered();
+    void on_actionCheckFolderOverflow_triggered();
+    void on_actionValidate_triggered();
+    void on_actionValidateFolder_triggered();
+    void on_actionCompare_triggered();
+    void on_actionMerge_triggered();
+    void on_actionUndo_triggered();
+    void on_actionRedo_triggered();
+    void on_actionMemoryUsage_triggered();
+    void on_actionRecordTrace_toggled(bool checked);
+    void on_actionSaveTrace_triggered();
 
     // Tree view
     void on_TW_TreeWidget_itemDoubleClicked(QTreeWidgetItem *item, int column);
-    void on_TW_TreeWidget_itemMoved(int from, int to);
+    void on_TW_TreeWidget_itemsMoved(QList<int> const& fromRows, QList<int> const& toRows);
     void on_PB_SubtitleAdd_clicked();
     void on_PB_SubtitleDelete_clicked();
     void on_PB_Find_clicked();
@@ -110,7 +138,6 @@ private slots:
     void on_PB_Save_clicked();
     void on_PB_Reset_clicked();
     void on_PB_ColorAdd_clicked();
-    void on_TE_TextEditor_textChanged();
     void on_CB_ComboBox_currentIndexChanged(int index);
     void on_CB_Sound_stateChanged(int state);
     void on_CB_AutoApply_clicked(bool checked);
@@ -129,8 +156,32 @@ private slots:
     void ColorSpinBoxChanged(int _value);
     void ColorDeletePressed();
 
+    // Text editor
+    void TextEditorContentsChange(int position, int charsRemoved, int charsAdded);
+
     // Preview
     void on_PB_SavePreview_clicked();
+    void RenderPreviewsFinished();
+
+    // Issue list
+    void IssueItemActivated(QTreeWidgetItem *item, int column);
+    void ValidateFolderFinished();
+    void CheckFolderOverflowFinished();
+
+    // Differences
+    void DiffItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous);
+    void DiffItemActivated(QTreeWidgetItem *item, int column);
+
+    // Merge conflicts
+    void ConflictItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous);
+    void ConflictItemActivated(QTreeWidgetItem *item, int column);
+    void ConflictKeepClicked();
+    void ConflictUseTheirsClicked();
+
+    // Background loading & saving
+    void LoadFileCancelled();
+    void LoadFileFinished();
+    void SaveFileFinished();
 
 private:
     struct ColorBlock
@@ -144,16 +195,109 @@ private:
         int m_end;
     };
 
+    // What a widget in a color row does
+    enum class ColorRole : int
+    {
+        Color,
+        Alpha,
+        Start,
+        End,
+        Delete
+    };
+
+    struct ColorWidget
+    {
+        ColorWidget():m_row(-1),m_role(ColorRole::Color){}
+
+        int m_row;
+        ColorRole m_role;
+    };
+
+    // Changes to the entries that can be undone
+    enum EditType : int
+    {
+        Modify,
+        Add,
+        Remove,
+        Move,
+        Replace     // Every entry, e.g. by a merge
+    };
+
+    struct EditStep
+    {
+        EditStep():m_type(EditType::Modify),m_id(-1){}
+
+        // Document on the other side of this step, shares
+        // everything but the changed entries with the current one
+        mst::Snapshot m_snapshot;
+        EditType m_type;
+        int m_id;
+
+        // Move only, m_fromRows[i] went to m_toRows[i], these
+        // are replayed instead of restoring the snapshot
+        QList<int> m_fromRows;
+        QList<int> m_toRows;
+    };
+
+    struct LoadResult
+    {
+        LoadResult():m_success(false),m_cancelled(false){}
+
+        QSharedPointer<mst> m_mst;
+        QList<QTreeWidgetItem*> m_items;
+        MarkupValidator::Report m_validation;
+        QString m_errorMsg;
+        bool m_success;
+        bool m_cancelled;
+    };
+
+    struct SaveResult
+    {
+        SaveResult():m_success(false){}
+
+        QString m_errorMsg;
+        bool m_success;
+    };
+
     void ResetProgram();
     void ResetEditor();
     void OpenFile(QString const& mstFile, bool showSuccess = true);
     bool DiscardSaveMessage(QString _title, QString _message, bool _checkFileEdited);
+    LoadResult LoadFileWorker(QString const& _mstFile);
+    void SaveFile(QString const& _mstFile, QString const& _title);
+    void SetFileEdited(bool _edited);
+
+    // Issue list
+    int SetIssues(QList<MarkupValidator::Report> const& _reports);
+    void GoToIssue(QString const& _name, int _entry, int _page);
+
+    // Differences
+    int SetDiff(QString const& _oldFileName);
+    QString GetDiffHtml(mst::Snapshot const& _snapshot, int _index, MstDiff::EntryChange const& _change, bool _old);
+    QString GetEntryHtml(mst::TextEntry const& _entry, QString const& _title, QSet<int> const& _pages, QSet<int> const& _tags, QString const& _highlight);
+
+    // Merge conflicts
+    int SetConflicts(vector<MstMerge::Conflict> const& _conflicts);
+    int GetConflictIndex(int _conflict);
+    void RemoveConflictItem(QTreeWidgetItem* _item);
+
+    // Undo & Redo
+    void PushEditStep(EditType _type, int _id, QList<int> const& _fromRows = QList<int>(), QList<int> const& _toRows = QList<int>());
+    void ApplyEditStep(EditStep const& _step, bool _undo);
+    bool MoveEntries(QList<int> const& _fromRows, QList<int> const& _toRows);
+    void CloseSubtitle();
+    void UpdateEditActions();
 
     // Tree view
     void TW_Refresh();
     void TW_FocusItem(int _id);
+    void TW_MoveItems(QList<int> const& _fromRows, QList<int> const& _toRows);
     void TW_AddOrReplaceEntry(mst::TextEntry entry, int _id = -1);
+    void TW_SetItemText(QTreeWidgetItem* _item, mst::TextEntry const& _entry);
+    void TW_SetItemOverflow(QTreeWidgetItem* _item, QStringList const& _issues);
+    void TW_CheckItemOverflow(QTreeWidgetItem* _item, mst::TextEntry const& _entry);
     void TW_Find();
+    QString TW_DecodeTag(string const& _tag);
 
     // Subtitle Editor
     void LoadSubtitle(int _id, int _page = 0);
@@ -161,16 +305,30 @@ private:
     void AddButtonComboBox(int _insertAt, Button _button = Button::COUNT);
     void RemoveButtonComboBox(int _comboID);
     void RemoveAllButtonComboBox();
+    QHBoxLayout* TakeButtonRow();
+    QIcon const& GetButtonIcon(Button _button);
+    void SetRowVisible(QLayout* _row, bool _visible);
     void SetCurrentPageLabel();
+    int GetTagStart(int _page);
+    void SetPageSubtitle(int _page, QString const& _subtitle);
+    void ShiftTagStarts(int _page, int _diff);
+    void RebuildTagStarts();
     void UpdateSubtitlePreview();
+    static QFont GetPreviewFont(bool _russian);
+    PreviewRenderer::Options GetPreviewOptions();
+    OverflowAnalyzer::Options GetOverflowOptions();
+    void RenderPreviews(QList<PreviewRenderer::Job> const& _jobs, QString const& _outputDir);
     void SetSubtitleEdited(bool _edited);
 
     void GetColorTagsFromCurrentPage(bool _insertUI);
     void InsertColorTagsToCurrentPage(bool _removeUI);
-    void AddColorBlock(int insertAt, ColorBlock _colorBlock = ColorBlock());
+    void AddColorBlock(int _insertAt, ColorBlock _colorBlock = ColorBlock(), bool _updateLimits = true);
     void RemoveColorBlock(int _colorID);
+    QHBoxLayout* TakeColorRow();
+    void SetColorRowIndex(int _colorID);
     void RemoveAllColorBlocks();
     void UpdateStartEndLimits(int _colorID);
+    void ShiftColorBlocks(int _position, int _removed, int _added);
 
     // Russian Mode
     QString ToRussian(QString const& str);
@@ -187,16 +345,84 @@ private:
     bool m_fileEdited;
     QString m_pngPath;
 
+    // Background loading
+    QFutureWatcher<LoadResult> m_loadWatcher;
+    QProgressDialog* m_loadProgress;
+    QString m_loadFileName;
+    bool m_loadShowSuccess;
+    std::atomic<bool> m_loadCancelled;
+    bool m_loadResultTaken;
+
+    // Background saving
+    QFutureWatcher<SaveResult> m_saveWatcher;
+    QString m_saveTitle;
+    unsigned int m_fileRevision;
+    unsigned int m_saveRevision;
+
+    // Batch preview rendering
+    QFutureWatcher<PreviewRenderer::Result> m_renderWatcher;
+    QProgressDialog* m_renderProgress;
+    QString m_renderOutputDir;
+
+    // Markup issues, opening a file from another file's issue goes there once loaded
+    QDockWidget* m_issueDock;
+    QTreeWidget* m_issueList;
+    QString m_pendingIssueName;
+    int m_pendingIssueEntry;
+    int m_pendingIssuePage;
+
+    // Folder markup validation
+    QFutureWatcher<MarkupValidator::Report> m_validateWatcher;
+    QProgressDialog* m_validateProgress;
+
+    // Text overflow, the analyzer of the last check of this file re-checks edited entries
+    QFutureWatcher<OverflowAnalyzer::Report> m_overflowWatcher;
+    QProgressDialog* m_overflowProgress;
+    QScopedPointer<OverflowAnalyzer> m_overflowAnalyzer;
+
+    // Differences to another version, both sides are kept for the side-by-side view
+    QDockWidget* m_diffDock;
+    QTreeWidget* m_diffList;
+    QTextBrowser* m_diffOld;
+    QTextBrowser* m_diffNew;
+    MstDiff m_diff;
+    mst::Snapshot m_diffOldSnapshot;
+    mst::Snapshot m_diffNewSnapshot;
+
+    // Merge conflicts still to resolve, the handle of each entry finds it after other edits
+    QDockWidget* m_conflictDock;
+    QTreeWidget* m_conflictList;
+    QTextBrowser* m_conflictBase;
+    QTextBrowser* m_conflictOurs;
+    QTextBrowser* m_conflictTheirs;
+    QVector<MstMerge::Conflict> m_conflicts;
+    QVector<mst::Handle> m_conflictHandles;
+
+    // Undo & Redo
+    QVector<EditStep> m_undoSteps;
+    QVector<EditStep> m_redoSteps;
+
     // Editor
-    QLabel* m_previewLabel;
+    SubtitlePreview* m_preview;
     int m_id;
+    mst::Handle m_handle;
     int m_page;
     QString m_name;
     QVector<QString> m_subtitles;
+    QVector<int> m_tagStarts;   // Number of $ before each page, one extra for the total
     typedef QPair<QString, Tag> TagPair;
     QVector<TagPair> m_tags;
     QVector<ColorBlock> m_colorBlocks;
     bool m_subtitleEdited;
+    bool m_convertingText;      // Russian toggle, the text editor change is not an edit
+
+    // Tag and color rows that are not shown, reused instead of rebuilt
+    QVector<QHBoxLayout*> m_buttonRowPool;
+    QVector<QHBoxLayout*> m_colorRowPool;
+
+    // Color row widget -> which row it is in and what it does
+    QHash<QWidget*, ColorWidget> m_colorWidgets;
+
     bool m_subtitleHardcoded;
 
     // Dragging spin box
@@ -209,10 +435,17 @@ private:
     QMap<QString, Button> m_stringToButton;
     QMap<Button, QString> m_buttonToCombo;
     QMap<Button, QString> m_buttonToString;
+    QVector<QIcon> m_buttonIcons;   // Loaded on first use, freed with the window
+
+    // Shift-JIS decoded tags, interned by raw bytes
+    QTextCodec* m_tagCodec;
+    QHash<QByteArray, QString> m_tagCache;
+    QMutex m_tagCacheMutex;
 
     // Russian mode
     QMap<QChar, QChar> m_unicodeToRussian;
     QMap<QChar, QChar> m_russianToUnicode;
+    CharMapDelegate* m_russianDelegate;
 };
 
 #endif // MSTEDITOR_H
@@ -0,0 +1,432 @@
+//-----------------------------------------------------
+// Name: mstmerge.cpp
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#include "mstmerge.h"
+#include "mstdiff.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+MstMerge::MstMerge()
+    : m_theirsCount(0)
+    , m_combinedCount(0)
+    , m_removedCount(0)
+{
+}
+
+//-----------------------------------------------------
+// Merge every entry of three versions of a file
+//-----------------------------------------------------
+void MstMerge::Merge
+(
+    mst::Snapshot const& _base,
+    mst::Snapshot const& _ours,
+    mst::Snapshot const& _theirs
+)
+{
+    vector<mst::EntryPtr> baseEntries;
+    vector<mst::EntryPtr> oursEntries;
+    vector<mst::EntryPtr> theirsEntries;
+    _base.m_entries.ToVector(baseEntries);
+    _ours.m_entries.ToVector(oursEntries);
+    _theirs.m_entries.ToVector(theirsEntries);
+    Merge(baseEntries, oursEntries, theirsEntries);
+}
+
+//-----------------------------------------------------
+// Match entries of the three by name, then decide each one
+//-----------------------------------------------------
+void MstMerge::Merge
+(
+    vector<mst::EntryPtr> const& _base,
+    vector<mst::EntryPtr> const& _ours,
+    vector<mst::EntryPtr> const& _theirs
+)
+{
+    TRACE_SCOPE("MstMerge::Merge");
+
+    m_entries.clear();
+    m_entries.reserve(_ours.size());
+    m_conflicts.clear();
+    m_theirsCount = 0;
+    m_combinedCount = 0;
+    m_removedCount = 0;
+
+    // Entries of each name chained in order, the n-th is the same entry in every version
+    struct NameIndex
+    {
+        unordered_map<string, int> m_first;
+        vector<int> m_next;
+    };
+    auto indexNames = [](vector<mst::EntryPtr> const& _entries, NameIndex& _index)
+    {
+        _index.m_first.reserve(_entries.size());
+        _index.m_next.assign(_entries.size(), -1);
+        for (int i = static_cast<int>(_entries.size()) - 1; i >= 0; i--)
+        {
+            auto const inserted = _index.m_first.insert(make_pair(_entries[i]->m_name, i));
+            if (!inserted.second)
+            {
+                _index.m_next[i] = inserted.first->second;
+                inserted.first->second = i;
+            }
+        }
+    };
+    auto findFirst = [](NameIndex const& _index, string const& _name) -> int
+    {
+        auto const iter = _index.m_first.find(_name);
+        return (iter == _index.m_first.end()) ? -1 : iter->second;
+    };
+    auto next = [](NameIndex const& _index, int _i) -> int
+    {
+        return (_i < 0) ? -1 : _index.m_next[_i];
+    };
+
+    NameIndex baseNames;
+    NameIndex oursNames;
+    NameIndex theirsNames;
+    indexNames(_base, baseNames);
+    indexNames(_ours, oursNames);
+    indexNames(_theirs, theirsNames);
+
+    vector<int> baseOfOurs(_ours.size(), -1);
+    vector<int> theirsOfOurs(_ours.size(), -1);
+    vector<int> oursOfTheirs(_theirs.size(), -1);
+    for (auto const& name : oursNames.m_first)
+    {
+        int b = findFirst(baseNames, name.first);
+        int t = findFirst(theirsNames, name.first);
+        for (int o = name.second; o >= 0; o = oursNames.m_next[o])
+        {
+            baseOfOurs[o] = b;
+            theirsOfOurs[o] = t;
+            if (t >= 0)
+            {
+                oursOfTheirs[t] = o;
+            }
+            b = next(baseNames, b);
+            t = next(theirsNames, t);
+        }
+    }
+
+    vector<int> baseOfTheirs(_theirs.size(), -1);
+    for (auto const& name : theirsNames.m_first)
+    {
+        int b = findFirst(baseNames, name.first);
+        for (int t = name.second; t >= 0; t = theirsNames.m_next[t])
+        {
+            baseOfTheirs[t] = b;
+            b = next(baseNames, b);
+        }
+    }
+
+    // Hashed when first compared, 0 is not hashed yet
+    vector<size_t> baseHashes(_base.size(), 0);
+    vector<size_t> oursHashes(_ours.size(), 0);
+    vector<size_t> theirsHashes(_theirs.size(), 0);
+    auto hashOf = [](vector<mst::EntryPtr> const& _entries, vector<size_t>& _hashes, int _i) -> size_t
+    {
+        if (_hashes[_i] == 0)
+        {
+            _hashes[_i] = max<size_t>(MstDiff::HashEntry(*_entries[_i]), 1);
+        }
+        return _hashes[_i];
+    };
+    auto isSame = [&hashOf](vector<mst::EntryPtr> const& _a, vector<size_t>& _hashesA, int _i, vector<mst::EntryPtr> const& _b, vector<size_t>& _hashesB, int _j)
+    {
+        if (_a[_i] == _b[_j]) return true;
+        return hashOf(_a, _hashesA, _i) == hashOf(_b, _hashesB, _j) && MstDiff::IsSameContent(*_a[_i], *_b[_j]);
+    };
+
+    auto addConflict = [this](ConflictType _type, mst::EntryPtr const& _base, mst::EntryPtr const& _ours, mst::EntryPtr const& _theirs, bool _kept)
+    {
+        Conflict conflict;
+        conflict.m_type = _type;
+        conflict.m_name = (_ours ? _ours : _theirs)->m_name;
+        conflict.m_index = _kept ? static_cast<int>(m_entries.size()) - 1 : -1;
+        conflict.m_base = _base;
+        conflict.m_ours = _ours;
+        conflict.m_theirs = _theirs;
+        m_conflicts.push_back(conflict);
+    };
+
+    // Only in theirs, added there or removed by ours
+    auto mergeTheirs = [&](int _t)
+    {
+        mst::EntryPtr const& theirs = _theirs[_t];
+        int const b = baseOfTheirs[_t];
+        if (b < 0)
+        {
+            m_entries.push_back(theirs);
+            m_theirsCount++;
+        }
+        else if (isSame(_theirs, theirsHashes, _t, _base, baseHashes, b))
+        {
+            m_removedCount++;
+        }
+        else
+        {
+            addConflict(ConflictType::ChangedRemoved, _base[b], nullptr, theirs, false);
+        }
+    };
+
+    auto mergeOurs = [&](int _o)
+    {
+        mst::EntryPtr const& ours = _ours[_o];
+        int const b = baseOfOurs[_o];
+        int const t = theirsOfOurs[_o];
+        mst::EntryPtr const base = (b >= 0) ? _base[b] : nullptr;
+        if (t < 0)
+        {
+            if (b < 0)
+            {
+                m_entries.push_back(ours);
+            }
+            else if (isSame(_ours, oursHashes, _o, _base, baseHashes, b))
+            {
+                m_removedCount++;
+            }
+            else
+            {
+                m_entries.push_back(ours);
+                addConflict(ConflictType::ChangedRemoved, base, ours, nullptr, true);
+            }
+            return;
+        }
+
+        mst::EntryPtr const& theirs = _theirs[t];
+        if (isSame(_ours, oursHashes, _o, _theirs, theirsHashes, t))
+        {
+            m_entries.push_back(ours);
+        }
+        else if (b < 0)
+        {
+            m_entries.push_back(ours);
+            addConflict(ConflictType::AddedTwice, nullptr, ours, theirs, true);
+        }
+        else if (isSame(_ours, oursHashes, _o, _base, baseHashes, b))
+        {
+            m_entries.push_back(theirs);
+            m_theirsCount++;
+        }
+        else if (isSame(_theirs, theirsHashes, t, _base, baseHashes, b))
+        {
+            m_entries.push_back(ours);
+        }
+        else
+        {
+            vector<int> conflictPages;
+            mst::EntryPtr const merged = MergePages(*base, *ours, *theirs, false, conflictPages);
+            if (!merged)
+            {
+                m_entries.push_back(ours);
+                addConflict(ConflictType::Tags, base, ours, theirs, true);
+                return;
+            }
+
+            m_entries.push_back(merged);
+            m_combinedCount++;
+            if (!conflictPages.empty())
+            {
+                addConflict(ConflictType::Pages, base, ours, theirs, true);
+                m_conflicts.back().m_pages = conflictPages;
+            }
+        }
+    };
+
+    // Entries only theirs has go after the entry before them in theirs
+    vector<vector<int>> theirsAfter(_ours.size() + 1);
+    int anchor = 0;
+    for (int t = 0; t < static_cast<int>(_theirs.size()); t++)
+    {
+        if (oursOfTheirs[t] >= 0)
+        {
+            anchor = oursOfTheirs[t] + 1;
+        }
+        else
+        {
+            theirsAfter[anchor].push_back(t);
+        }
+    }
+
+    for (int o = 0; o <= static_cast<int>(_ours.size()); o++)
+    {
+        if (o > 0)
+        {
+            mergeOurs(o - 1);
+        }
+        for (int t : theirsAfter[o])
+        {
+            mergeTheirs(t);
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Entry of a conflict with theirs winning where both changed it
+//-----------------------------------------------------
+mst::EntryPtr MstMerge::ResolveTheirs
+(
+    Conflict const& _conflict
+)
+{
+    if (_conflict.m_type == ConflictType::Pages)
+    {
+        // Their pages can still leave the tags unmatched, then take all of theirs
+        vector<int> conflictPages;
+        mst::EntryPtr const merged = MergePages(*_conflict.m_base, *_conflict.m_ours, *_conflict.m_theirs, true, conflictPages);
+        return merged ? merged : _conflict.m_theirs;
+    }
+    return _conflict.m_theirs;
+}
+
+//-----------------------------------------------------
+// Readable description of a conflict
+//-----------------------------------------------------
+string MstMerge::ToString
+(
+    Conflict const& _conflict
+)
+{
+    string str = _conflict.m_name;
+    switch (_conflict.m_type)
+    {
+    case ConflictType::Pages:
+    {
+        str += ": both changed page";
+        for (unsigned int i = 0; i < _conflict.m_pages.size(); i++)
+        {
+            str += (i ? ", " : " ") + to_string(_conflict.m_pages[i] + 1);
+        }
+        break;
+    }
+    case ConflictType::Tags:
+        str += ": both changed it and its tags don't match its $";
+        break;
+    case ConflictType::ChangedRemoved:
+        str += _conflict.m_ours ? ": changed here but removed by theirs" : ": removed here but changed by theirs";
+        break;
+    case ConflictType::AddedTwice:
+        str += ": added by both with different text";
+        break;
+    }
+    return str;
+}
+
+//-----------------------------------------------------
+// Same page and tags, or missing on both
+//-----------------------------------------------------
+bool MstMerge::Page::operator==
+(
+    Page const& _other
+) const
+{
+    if (m_present != _other.m_present) return false;
+    return !m_present || (m_text == _other.m_text && m_tags == _other.m_tags);
+}
+
+//-----------------------------------------------------
+// Pages with the tags of their $, false if the counts differ
+//-----------------------------------------------------
+bool MstMerge::SplitPages
+(
+    mst::TextEntry const& _entry,
+    vector<Page>& _pages
+)
+{
+    // No tags at all is hardcoded text, every page just has none
+    size_t tagCount = 0;
+    for (wstring const& subtitle : _entry.m_subtitles)
+    {
+        tagCount += count(subtitle.begin(), subtitle.end(), L'$');
+    }
+    if (!_entry.m_tags.empty() && _entry.m_tags.size() != tagCount) return false;
+
+    _pages.resize(_entry.m_subtitles.size());
+    auto tag = _entry.m_tags.begin();
+    for (unsigned int p = 0; p < _entry.m_subtitles.size(); p++)
+    {
+        Page& page = _pages[p];
+        page.m_present = true;
+        page.m_text = _entry.m_subtitles[p];
+        if (_entry.m_tags.empty()) continue;
+
+        auto const end = tag + count(page.m_text.begin(), page.m_text.end(), L'$');
+        page.m_tags.assign(tag, end);
+        tag = end;
+    }
+    return true;
+}
+
+//-----------------------------------------------------
+// Merge page by page, nullptr if any side can't be split
+// or the merged tags don't match its $
+//-----------------------------------------------------
+mst::EntryPtr MstMerge::MergePages
+(
+    mst::TextEntry const& _base,
+    mst::TextEntry const& _ours,
+    mst::TextEntry const& _theirs,
+    bool _preferTheirs,
+    vector<int>& _conflictPages
+)
+{
+    vector<Page> basePages;
+    vector<Page> oursPages;
+    vector<Page> theirsPages;
+    if (!SplitPages(_base, basePages) || !SplitPages(_ours, oursPages) || !SplitPages(_theirs, theirsPages))
+    {
+        return nullptr;
+    }
+
+    // Pages of a hardcoded side have no tags to pair with tagged pages
+    if (_ours.m_tags.empty() != _theirs.m_tags.empty())
+    {
+        return nullptr;
+    }
+
+    // Missing pages are pages removed at the end, or not added
+    size_t const pageCount = max(basePages.size(), max(oursPages.size(), theirsPages.size()));
+    basePages.resize(pageCount);
+    oursPages.resize(pageCount);
+    theirsPages.resize(pageCount);
+
+    mst::TextEntry merged;
+    merged.m_name = _ours.m_name;
+    size_t tagCount = 0;
+    for (unsigned int p = 0; p < pageCount; p++)
+    {
+        Page const* page = &oursPages[p];
+        if (oursPages[p] == theirsPages[p] || theirsPages[p] == basePages[p])
+        {
+            page = &oursPages[p];
+        }
+        else if (oursPages[p] == basePages[p])
+        {
+            page = &theirsPages[p];
+        }
+        else
+        {
+            _conflictPages.push_back(static_cast<int>(p));
+            page = _preferTheirs ? &theirsPages[p] : &oursPages[p];
+        }
+
+        if (!page->m_present) continue;
+        merged.m_subtitles.push_back(page->m_text);
+        merged.m_tags.insert(merged.m_tags.end(), page->m_tags.begin(), page->m_tags.end());
+        tagCount += count(page->m_text.begin(), page->m_text.end(), L'$');
+    }
+
+    if (!merged.m_tags.empty() && merged.m_tags.size() != tagCount)
+    {
+        return nullptr;
+    }
+    return mst::MakeEntry(merged);
+}
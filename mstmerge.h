@@ -0,0 +1,88 @@
+//-----------------------------------------------------
+// Name: mstmerge.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <string>
+#include <vector>
+
+#include "mst.h"
+
+using namespace std;
+
+//-----------------------------------------------------
+// Three-way merge of two edited copies of the same file.
+// Entries are the same entry in all three when they are
+// the n-th of their name, and compared by content hash.
+// When both sides changed an entry, its pages are merged
+// one by one, a page with its own tags, so only a page
+// both changed is a conflict. Conflicts keep ours and are
+// listed with all three versions to be resolved later.
+// The order is ours, entries only theirs added are put
+// after the entry they follow in theirs.
+//-----------------------------------------------------
+class MstMerge
+{
+public:
+    enum class ConflictType : int
+    {
+        Pages,          // Both changed the same page
+        Tags,           // Both changed it and its tags don't match its $
+        ChangedRemoved, // One side changed what the other removed
+        AddedTwice      // Both added an entry of this name, different text
+    };
+
+    struct Conflict
+    {
+        Conflict():m_type(ConflictType::Pages),m_index(-1){}
+
+        ConflictType m_type;
+        string m_name;
+        int m_index;            // In the merged entries, -1 when it was left out
+        vector<int> m_pages;    // Pages both changed, Pages only
+        mst::EntryPtr m_base;   // nullptr on a side that doesn't have it
+        mst::EntryPtr m_ours;
+        mst::EntryPtr m_theirs;
+    };
+
+public:
+    MstMerge();
+
+    void Merge(mst::Snapshot const& _base, mst::Snapshot const& _ours, mst::Snapshot const& _theirs);
+    void Merge(vector<mst::EntryPtr> const& _base, vector<mst::EntryPtr> const& _ours, vector<mst::EntryPtr> const& _theirs);
+
+    vector<mst::EntryPtr> const& GetEntries() const { return m_entries; }
+    vector<Conflict> const& GetConflicts() const { return m_conflicts; }
+    int GetTheirsCount() const { return m_theirsCount; }
+    int GetCombinedCount() const { return m_combinedCount; }
+    int GetRemovedCount() const { return m_removedCount; }
+
+    // What the entry of a conflict becomes when theirs wins,
+    // nullptr when theirs removed it
+    static mst::EntryPtr ResolveTheirs(Conflict const& _conflict);
+    static string ToString(Conflict const& _conflict);
+
+private:
+    // One page and the tags of its $
+    struct Page
+    {
+        Page():m_present(false){}
+        bool operator==(Page const& _other) const;
+
+        bool m_present;
+        wstring m_text;
+        vector<string> m_tags;
+    };
+
+    static bool SplitPages(mst::TextEntry const& _entry, vector<Page>& _pages);
+    static mst::EntryPtr MergePages(mst::TextEntry const& _base, mst::TextEntry const& _ours, mst::TextEntry const& _theirs, bool _preferTheirs, vector<int>& _conflictPages);
+
+private:
+    vector<mst::EntryPtr> m_entries;
+    vector<Conflict> m_conflicts;
+    int m_theirsCount;      // Changed only by theirs
+    int m_combinedCount;    // Changed by both, pages merged
+    int m_removedCount;
+};
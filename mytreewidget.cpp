@@ -22,9 +22,9 @@ void MyTreeWidget::dropEvent(QDropEvent *event)
     QList<int> toRows;
     foreach(item, dragItems) toRows.append(indexFromItem(item).row());
 
-    if (fromRows.size() == 1 && toRows.size() == 1)
+    if (!fromRows.isEmpty() && fromRows != toRows)
     {
         // notify subscribers in some useful way
-        emit itemMoved(fromRows.front(), toRows.front());
+        emit itemsMoved(fromRows, toRows);
     }
 }
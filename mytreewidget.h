@@ -12,7 +12,8 @@ public:
     void dropEvent(QDropEvent *event) override;
 
 signals:
-    void itemMoved(int from, int to);
+    // fromRows[i] has been moved to toRows[i]
+    void itemsMoved(QList<int> fromRows, QList<int> toRows);
 };
 
 #endif // MYTREEWIDGET_H
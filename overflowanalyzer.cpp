@@ -0,0 +1,198 @@
+#include "overflowanalyzer.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QFontMetricsF>
+#include <QImageReader>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "previewrenderer.h"
+#include "subtitlepreview.h"
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+OverflowAnalyzer::OverflowAnalyzer
+(
+    Options const& _options
+)
+    : m_options(_options)
+{
+    m_table = GetGlyphTable(m_options.m_font);
+}
+
+//-----------------------------------------------------
+// Measure every page of the entries, same layout as the preview
+//-----------------------------------------------------
+void OverflowAnalyzer::Analyze
+(
+    vector<mst::EntryPtr> const& _entries,
+    Report& _report
+) const
+{
+    GlyphTable const& table = *m_table;
+    qreal const maxWidth = m_options.m_boxSize.width();
+    qreal const maxHeight = m_options.m_boxSize.height();
+
+    QVector<PreviewRenderer::Page> pages;
+    for (unsigned int i = 0; i < _entries.size(); i++)
+    {
+        mst::TextEntry const& entry = *_entries[i];
+        PreviewRenderer::GetPages(entry, m_options.m_charMap, pages);
+        _report.m_pageCount += pages.size();
+
+        for (int page = 0; page < pages.size(); page++)
+        {
+            QString const& text = pages[page].m_text;
+            QStringList const& pictures = pages[page].m_pictures;
+
+            Issue issue;
+            issue.m_name = QString::fromStdString(entry.m_name);
+            issue.m_entry = static_cast<int>(i);
+            issue.m_page = page;
+
+            int line = 0;
+            int pictureIndex = 0;
+            qreal width = 0;
+            qreal ascent = table.m_ascent;
+            qreal height = 0;
+            for (int c = 0; c <= text.size(); c++)
+            {
+                ushort const code = c < text.size() ? text[c].unicode() : '\n';
+                if (code == '\n')
+                {
+                    if (width > maxWidth)
+                    {
+                        issue.m_line = line;
+                        issue.m_size = width;
+                        issue.m_limit = maxWidth;
+                        _report.m_issues.push_back(issue);
+                    }
+
+                    height += ascent + table.m_descent;
+                    ascent = table.m_ascent;
+                    width = 0;
+                    line++;
+                    continue;
+                }
+
+                if (code == ' ')
+                {
+                    width += table.m_spaceAdvance;
+                }
+                else if (code == 0x3000)
+                {
+                    width += table.m_wideSpaceAdvance;
+                }
+                else if (code == '$' && pictureIndex < pictures.size() && !pictures[pictureIndex].isEmpty())
+                {
+                    QSize const size = table.m_imageSizes.value(pictures[pictureIndex++]);
+                    width += size.width();
+                    ascent = qMax(ascent, static_cast<qreal>(size.height()));
+                }
+                else
+                {
+                    pictureIndex += (code == '$');
+                    width += table.m_advances[code];
+                }
+            }
+
+            if (height > maxHeight)
+            {
+                issue.m_line = -1;
+                issue.m_size = height;
+                issue.m_limit = maxHeight;
+                _report.m_issues.push_back(issue);
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Load and analyze a file, for running over a directory
+//-----------------------------------------------------
+OverflowAnalyzer::Report OverflowAnalyzer::operator()
+(
+    QString const& _fileName
+) const
+{
+    Report report;
+    report.m_fileName = _fileName;
+
+    mst file;
+    string errorMsg;
+    if (!file.Load(_fileName.toStdString(), errorMsg))
+    {
+        report.m_errorMsg = QString::fromStdString(errorMsg);
+        return report;
+    }
+
+    vector<mst::EntryPtr> entries;
+    file.GetSnapshot().m_entries.ToVector(entries);
+    Analyze(entries, report);
+    return report;
+}
+
+//-----------------------------------------------------
+// Readable description of an issue
+//-----------------------------------------------------
+QString OverflowAnalyzer::ToString
+(
+    Issue const& _issue
+)
+{
+    QString str = _issue.m_name + " page " + QString::number(_issue.m_page + 1);
+    if (_issue.m_line >= 0)
+    {
+        str += " line " + QString::number(_issue.m_line + 1) + " is too wide";
+    }
+    else
+    {
+        str += " is too tall";
+    }
+
+    str += " (" + QString::number(qRound(_issue.m_size)) + "/" + QString::number(qRound(_issue.m_limit)) + "px)";
+    return str;
+}
+
+//-----------------------------------------------------
+// Tables are built once per font and kept for the whole process
+//-----------------------------------------------------
+shared_ptr<OverflowAnalyzer::GlyphTable const> OverflowAnalyzer::GetGlyphTable
+(
+    QFont const& _font
+)
+{
+    static QMutex mutex;
+    static QHash<QString, shared_ptr<GlyphTable const>> tables;
+
+    QMutexLocker locker(&mutex);
+    shared_ptr<GlyphTable const>& cached = tables[_font.key()];
+    if (cached) return cached;
+
+    shared_ptr<GlyphTable> table = make_shared<GlyphTable>();
+    QFontMetricsF const metrics(_font);
+    table->m_advances.resize(0x10000);
+    for (int code = 0; code < 0x10000; code++)
+    {
+        // A surrogate pair is measured as its first half
+        QChar const chr(static_cast<ushort>(code));
+        table->m_advances[code] = chr.isLowSurrogate() ? 0.0f : static_cast<float>(metrics.horizontalAdvance(chr));
+    }
+
+    table->m_spaceAdvance = SubtitleLayout::GetSpaceAdvance(_font);
+    table->m_wideSpaceAdvance = SubtitleLayout::GetWideSpaceAdvance(_font);
+    table->m_ascent = metrics.ascent();
+    table->m_descent = metrics.descent() + metrics.leading();
+
+    // Every button the preview can show, only the headers are read
+    QDir const resources(":/resources");
+    for (QString const& png : resources.entryList(QStringList() << "*.png", QDir::Files))
+    {
+        table->m_imageSizes[QFileInfo(png).completeBaseName()] = QImageReader(resources.filePath(png)).size();
+    }
+
+    cached = table;
+    return cached;
+}
@@ -0,0 +1,86 @@
+//-----------------------------------------------------
+// Name: overflowanalyzer.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <QFont>
+#include <QHash>
+#include <QMap>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+
+#include "mst.h"
+
+//-----------------------------------------------------
+// Finds pages that don't fit in the in-game text box.
+// Glyph advances of the whole BMP and the size of every
+// button image are measured once per font, after that
+// measuring a page is only table lookups. The analyzer
+// is read-only once built so it can be shared by threads.
+//-----------------------------------------------------
+class OverflowAnalyzer
+{
+public:
+    struct Options
+    {
+        Options():m_boxSize(792,108){}
+
+        QFont m_font;
+        QMap<QChar, QChar> m_charMap;  // Applied to every character, e.g. russian
+        QSize m_boxSize;
+    };
+
+    struct Issue
+    {
+        Issue():m_entry(-1),m_page(-1),m_line(-1),m_size(0),m_limit(0){}
+
+        QString m_name;
+        int m_entry;
+        int m_page;
+        int m_line;     // -1 when the page is too tall
+        qreal m_size;   // Width of the line or height of the page
+        qreal m_limit;
+    };
+
+    struct Report
+    {
+        Report():m_pageCount(0){}
+
+        QString m_fileName;
+        QVector<Issue> m_issues;
+        int m_pageCount;
+        QString m_errorMsg;
+    };
+    typedef Report result_type;
+
+public:
+    OverflowAnalyzer(Options const& _options);
+
+    void Analyze(vector<mst::EntryPtr> const& _entries, Report& _report) const;
+    Report operator()(QString const& _fileName) const;
+
+    static QString ToString(Issue const& _issue);
+
+private:
+    struct GlyphTable
+    {
+        QVector<float> m_advances;  // Indexed by UTF-16 code unit
+        qreal m_spaceAdvance;
+        qreal m_wideSpaceAdvance;
+        qreal m_ascent;
+        qreal m_descent;
+        QHash<QString, QSize> m_imageSizes;
+    };
+
+    static shared_ptr<GlyphTable const> GetGlyphTable(QFont const& _font);
+
+private:
+    Options m_options;
+    shared_ptr<GlyphTable const> m_table;
+};
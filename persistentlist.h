@@ -0,0 +1,383 @@
+//-----------------------------------------------------
+// Name: persistentlist.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "memoryusage.h"
+
+using namespace std;
+
+//-----------------------------------------------------
+// Sequence stored as an immutable implicit treap.
+// Copying a list is O(1) and shares every node, each
+// modification only copies the O(log n) nodes on its path,
+// so older copies stay valid and cost almost no memory.
+//-----------------------------------------------------
+template <class T>
+class PersistentList
+{
+public:
+    PersistentList() : m_seed(0x9E3779B9u) {}
+
+    unsigned int Size() const { return Size(m_root); }
+    bool Empty() const { return !m_root; }
+    void Clear() { m_root.reset(); }
+
+    // Access
+    T const& At(unsigned int _index) const;
+    template <class F> unsigned int LowerBound(F _less) const;
+    void ToVector(vector<T>& _values) const;
+    template <class F> bool ForEach(unsigned int _start, F _func) const;
+
+    // Bytes of one node including its shared_ptr block, roughly
+    static size_t GetNodeBytes() { return sizeof(Node) + 2 * sizeof(void*); }
+
+    // Modifiers
+    void Assign(vector<T> const& _values);
+    void Set(unsigned int _index, T const& _value);
+    void Insert(unsigned int _index, T const& _value);
+    void PushBack(T const& _value) { Insert(Size(), _value); }
+    void Erase(unsigned int _index);
+    void Move(unsigned int _from, unsigned int _to);
+
+private:
+    struct Node;
+    typedef shared_ptr<Node const> NodePtr;
+    struct Node
+    {
+        NodePtr m_left;
+        NodePtr m_right;
+        T m_value;
+        unsigned int m_priority;
+        unsigned int m_size;
+    };
+
+    static unsigned int Size(NodePtr const& _node) { return _node ? _node->m_size : 0; }
+    static unsigned int Priority(NodePtr const& _node) { return _node ? _node->m_priority : 0; }
+    static NodePtr MakeNode(NodePtr const& _left, NodePtr const& _right, T const& _value, unsigned int _priority);
+
+    static void Split(NodePtr _node, unsigned int _count, NodePtr& _left, NodePtr& _right);
+    static NodePtr Merge(NodePtr const& _left, NodePtr const& _right);
+    static NodePtr SetAt(NodePtr const& _node, unsigned int _index, T const& _value);
+    NodePtr Build(vector<T> const& _values, unsigned int _begin, unsigned int _end);
+    template <class F> static bool Visit(NodePtr const& _node, unsigned int _start, unsigned int _offset, F& _func);
+
+    unsigned int NextPriority();
+
+private:
+    NodePtr m_root;
+    unsigned int m_seed;
+};
+
+//-----------------------------------------------------
+// Get value at index, O(log n)
+//-----------------------------------------------------
+template <class T>
+T const& PersistentList<T>::At
+(
+    unsigned int _index
+) const
+{
+    Node const* node = m_root.get();
+    while (true)
+    {
+        unsigned int leftSize = Size(node->m_left);
+        if (_index < leftSize)
+        {
+            node = node->m_left.get();
+        }
+        else if (_index > leftSize)
+        {
+            _index -= leftSize + 1;
+            node = node->m_right.get();
+        }
+        else
+        {
+            return node->m_value;
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Number of leading values _less returns true for, O(log n)
+// On a sorted list this finds where a key is or would be
+//-----------------------------------------------------
+template <class T>
+template <class F>
+unsigned int PersistentList<T>::LowerBound
+(
+    F _less
+) const
+{
+    unsigned int index = 0;
+    Node const* node = m_root.get();
+    while (node)
+    {
+        if (_less(node->m_value))
+        {
+            index += Size(node->m_left) + 1;
+            node = node->m_right.get();
+        }
+        else
+        {
+            node = node->m_left.get();
+        }
+    }
+    return index;
+}
+
+//-----------------------------------------------------
+// Copy all values in order
+//-----------------------------------------------------
+template <class T>
+void PersistentList<T>::ToVector
+(
+    vector<T>& _values
+) const
+{
+    _values.clear();
+    _values.reserve(Size());
+    ForEach(0, [&_values](unsigned int, T const& _value) -> bool
+    {
+        _values.push_back(_value);
+        return true;
+    });
+}
+
+//-----------------------------------------------------
+// Visit (index, value) in order from _start,
+// stops and returns false when _func returns false
+//-----------------------------------------------------
+template <class T>
+template <class F>
+bool PersistentList<T>::ForEach
+(
+    unsigned int _start,
+    F _func
+) const
+{
+    return Visit(m_root, _start, 0, _func);
+}
+
+template <class T>
+template <class F>
+bool PersistentList<T>::Visit
+(
+    NodePtr const& _node,
+    unsigned int _start,
+    unsigned int _offset,
+    F& _func
+)
+{
+    if (!_node) return true;
+
+    // Skip whole subtrees before _start
+    unsigned int index = _offset + Size(_node->m_left);
+    if (_start < index && !Visit(_node->m_left, _start, _offset, _func)) return false;
+    if (_start <= index && !_func(index, _node->m_value)) return false;
+    return Visit(_node->m_right, _start, index + 1, _func);
+}
+
+//-----------------------------------------------------
+// Replace all values, builds a balanced tree in O(n)
+//-----------------------------------------------------
+template <class T>
+void PersistentList<T>::Assign
+(
+    vector<T> const& _values
+)
+{
+    m_root = Build(_values, 0, static_cast<unsigned int>(_values.size()));
+}
+
+template <class T>
+typename PersistentList<T>::NodePtr PersistentList<T>::Build
+(
+    vector<T> const& _values,
+    unsigned int _begin,
+    unsigned int _end
+)
+{
+    if (_begin >= _end) return NodePtr();
+
+    unsigned int mid = _begin + (_end - _begin) / 2;
+    NodePtr left = Build(_values, _begin, mid);
+    NodePtr right = Build(_values, mid + 1, _end);
+
+    // Parent priority must not be lower than its children
+    unsigned int priority = max(NextPriority(), max(Priority(left), Priority(right)));
+    return MakeNode(left, right, _values[mid], priority);
+}
+
+//-----------------------------------------------------
+// Replace value at index
+//-----------------------------------------------------
+template <class T>
+void PersistentList<T>::Set
+(
+    unsigned int _index,
+    T const& _value
+)
+{
+    if (_index >= Size()) return;
+    m_root = SetAt(m_root, _index, _value);
+}
+
+template <class T>
+typename PersistentList<T>::NodePtr PersistentList<T>::SetAt
+(
+    NodePtr const& _node,
+    unsigned int _index,
+    T const& _value
+)
+{
+    unsigned int leftSize = Size(_node->m_left);
+    if (_index < leftSize)
+    {
+        return MakeNode(SetAt(_node->m_left, _index, _value), _node->m_right, _node->m_value, _node->m_priority);
+    }
+    else if (_index > leftSize)
+    {
+        return MakeNode(_node->m_left, SetAt(_node->m_right, _index - leftSize - 1, _value), _node->m_value, _node->m_priority);
+    }
+
+    return MakeNode(_node->m_left, _node->m_right, _value, _node->m_priority);
+}
+
+//-----------------------------------------------------
+// Insert value before index
+//-----------------------------------------------------
+template <class T>
+void PersistentList<T>::Insert
+(
+    unsigned int _index,
+    T const& _value
+)
+{
+    _index = min(_index, Size());
+
+    NodePtr left, right;
+    Split(m_root, _index, left, right);
+    NodePtr node = MakeNode(NodePtr(), NodePtr(), _value, NextPriority());
+    m_root = Merge(Merge(left, node), right);
+}
+
+//-----------------------------------------------------
+// Remove value at index
+//-----------------------------------------------------
+template <class T>
+void PersistentList<T>::Erase
+(
+    unsigned int _index
+)
+{
+    if (_index >= Size()) return;
+
+    NodePtr left, mid, right;
+    Split(m_root, _index, left, right);
+    Split(right, 1, mid, right);
+    m_root = Merge(left, right);
+}
+
+//-----------------------------------------------------
+// Same as erasing _from then inserting at _to, O(log n)
+//-----------------------------------------------------
+template <class T>
+void PersistentList<T>::Move
+(
+    unsigned int _from,
+    unsigned int _to
+)
+{
+    if (_from >= Size() || _from == _to) return;
+
+    T value = At(_from);
+    Erase(_from);
+    Insert(_to, value);
+}
+
+//-----------------------------------------------------
+// Helpers
+//-----------------------------------------------------
+template <class T>
+typename PersistentList<T>::NodePtr PersistentList<T>::MakeNode
+(
+    NodePtr const& _left,
+    NodePtr const& _right,
+    T const& _value,
+    unsigned int _priority
+)
+{
+    shared_ptr<Node> node = allocate_shared<Node>(CountingAllocator<Node>(MemoryCategory::StoreNodes));
+    node->m_left = _left;
+    node->m_right = _right;
+    node->m_value = _value;
+    node->m_priority = _priority;
+    node->m_size = Size(_left) + Size(_right) + 1;
+    return node;
+}
+
+template <class T>
+void PersistentList<T>::Split
+(
+    NodePtr _node,
+    unsigned int _count,
+    NodePtr& _left,
+    NodePtr& _right
+)
+{
+    if (!_node)
+    {
+        _left.reset();
+        _right.reset();
+        return;
+    }
+
+    // First _count values go to the left
+    NodePtr sub;
+    unsigned int leftSize = Size(_node->m_left);
+    if (_count <= leftSize)
+    {
+        Split(_node->m_left, _count, _left, sub);
+        _right = MakeNode(sub, _node->m_right, _node->m_value, _node->m_priority);
+    }
+    else
+    {
+        Split(_node->m_right, _count - leftSize - 1, sub, _right);
+        _left = MakeNode(_node->m_left, sub, _node->m_value, _node->m_priority);
+    }
+}
+
+template <class T>
+typename PersistentList<T>::NodePtr PersistentList<T>::Merge
+(
+    NodePtr const& _left,
+    NodePtr const& _right
+)
+{
+    if (!_left) return _right;
+    if (!_right) return _left;
+
+    if (_left->m_priority > _right->m_priority)
+    {
+        return MakeNode(_left->m_left, Merge(_left->m_right, _right), _left->m_value, _left->m_priority);
+    }
+
+    return MakeNode(Merge(_left, _right->m_left), _right->m_right, _right->m_value, _right->m_priority);
+}
+
+template <class T>
+unsigned int PersistentList<T>::NextPriority()
+{
+    // xorshift32
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
@@ -0,0 +1,176 @@
+#include "previewrenderer.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QPainter>
+#include <QStringList>
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+PreviewRenderer::PreviewRenderer
+(
+    Options const& _options
+)
+    : m_options(_options)
+{
+    // Convert once instead of for every page
+    if (!m_options.m_background.isNull())
+    {
+        m_options.m_background = m_options.m_background.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+}
+
+//-----------------------------------------------------
+// Render every page of every entry in the job to PNG
+//-----------------------------------------------------
+PreviewRenderer::Result PreviewRenderer::operator()
+(
+    Job const& _job
+) const
+{
+    Result result;
+
+    QVector<mst::EntryPtr> entries = _job.m_entries;
+    if (entries.isEmpty() && !_job.m_fileName.isEmpty())
+    {
+        mst file;
+        string errorMsg;
+        if (!file.Load(_job.m_fileName.toStdString(), errorMsg))
+        {
+            result.m_errorMsg = QFileInfo(_job.m_fileName).fileName() + ": " + QString::fromStdString(errorMsg);
+            return result;
+        }
+
+        mst::Snapshot const snapshot = file.GetSnapshot();
+        snapshot.m_entries.ForEach(0, [&entries](unsigned int, mst::EntryPtr const& _entry) -> bool
+        {
+            entries.push_back(_entry);
+            return true;
+        });
+    }
+
+    if (!QDir().mkpath(_job.m_outputDir))
+    {
+        result.m_errorMsg = "Unable to create directory " + _job.m_outputDir;
+        return result;
+    }
+
+    // One layout per job, button images are loaded once for all its pages
+    SubtitleLayout layout;
+    layout.SetFont(m_options.m_font);
+
+    QVector<Page> pages;
+    for (int i = 0; i < entries.size(); i++)
+    {
+        mst::TextEntry const& entry = *entries[i];
+        GetPages(entry, m_options.m_charMap, pages);
+
+        // Index first so the files sort in the same order as the entries
+        QString const prefix = QString("%1_%2_").arg(_job.m_firstIndex + i, 4, 10, QChar('0')).arg(QString::fromStdString(entry.m_name));
+        for (int page = 0; page < pages.size(); page++)
+        {
+            QString const pngFile = _job.m_outputDir + "/" + prefix + QString::number(page + 1) + ".png";
+            if (!RenderPage(layout, pages[page]).save(pngFile, "PNG"))
+            {
+                result.m_errorMsg = "Unable to save " + pngFile;
+                return result;
+            }
+            result.m_imageCount++;
+        }
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------
+// Convert entry to what the preview shows for each page,
+// tags are handled the same way as in the editor
+//-----------------------------------------------------
+void PreviewRenderer::GetPages
+(
+    mst::TextEntry const& _entry,
+    QMap<QChar, QChar> const& _charMap,
+    QVector<Page>& _pages
+)
+{
+    _pages.clear();
+
+    // Hard-coded subtitles show their $, mismatched tags are dropped
+    MarkupParser::Document document;
+    MarkupParser::Parse(_entry, document);
+
+    QString text;
+    QVector<MarkupParser::Node const*> tagNodes;
+    QVector<MarkupParser::Span> spans;
+    for (QVector<MarkupParser::Node> const& nodes : document.m_pages)
+    {
+        text.clear();
+        tagNodes.clear();
+        spans.clear();
+        MarkupParser::Flatten(nodes, text, tagNodes, spans);
+
+        // Sound at the start of a page is not displayed
+        int offset = 0;
+        if (!tagNodes.isEmpty() && tagNodes[0]->m_type == MarkupParser::NodeType::Sound && text.startsWith('$'))
+        {
+            tagNodes.pop_front();
+            offset = 1;
+        }
+
+        Page page;
+        page.m_text.reserve(text.size() - offset);
+        for (int i = offset; i < text.size(); i++)
+        {
+            page.m_text += _charMap.value(text[i], text[i]);
+        }
+
+        // Sounds in the middle draw $ as text
+        for (MarkupParser::Node const* node : tagNodes)
+        {
+            page.m_pictures.push_back(node->m_type == MarkupParser::NodeType::Picture ? node->m_text : QString());
+        }
+
+        page.m_colors.reserve(spans.size());
+        for (MarkupParser::Span const& span : spans)
+        {
+            page.m_colors.push_back(SubtitleLayout::ColorRange(qMax(span.m_start - offset, 0), span.m_end - offset, span.m_color));
+        }
+
+        _pages.push_back(page);
+    }
+}
+
+//-----------------------------------------------------
+// Draw one page on top of the text box
+//-----------------------------------------------------
+QImage PreviewRenderer::RenderPage
+(
+    SubtitleLayout& _layout,
+    Page const& _page
+) const
+{
+    QImage image;
+    if (m_options.m_background.isNull())
+    {
+        QPoint const bottomRight = m_options.m_textOffset + QPoint(m_options.m_textSize.width(), m_options.m_textSize.height());
+        image = QImage(bottomRight.x(), bottomRight.y(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+    }
+    else
+    {
+        // Shared until the painter detaches it
+        image = m_options.m_background;
+    }
+
+    _layout.SetPage(_page.m_text, _page.m_pictures, _page.m_colors);
+
+    QRect const clip(QPoint(), m_options.m_textSize);
+    QPainter painter(&image);
+    painter.translate(m_options.m_textOffset);
+    painter.setClipRect(clip);
+    _layout.Paint(painter, clip);
+    painter.end();
+
+    return image;
+}
@@ -0,0 +1,76 @@
+//-----------------------------------------------------
+// Name: previewrenderer.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <QMap>
+#include <QImage>
+#include <QPoint>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+#include "markupparser.h"
+#include "mst.h"
+#include "subtitlepreview.h"
+
+//-----------------------------------------------------
+// Renders subtitle pages onto the text box image without
+// any widget, every job has its own layout so jobs can
+// run on the thread pool at the same time.
+//-----------------------------------------------------
+class PreviewRenderer
+{
+public:
+    struct Options
+    {
+        Options():m_textOffset(76,31),m_textSize(792,108){}
+
+        QImage m_background;
+        QFont m_font;
+        QMap<QChar, QChar> m_charMap;  // Applied to every character, e.g. russian
+        QPoint m_textOffset;
+        QSize m_textSize;
+    };
+
+    // Entries of one file, m_fileName is loaded first when m_entries is empty
+    struct Job
+    {
+        Job():m_firstIndex(0){}
+
+        QString m_fileName;
+        QVector<mst::EntryPtr> m_entries;
+        int m_firstIndex;  // Index of m_entries[0] in its file
+        QString m_outputDir;
+    };
+
+    // Everything the preview needs to draw a page
+    struct Page
+    {
+        QString m_text;
+        QStringList m_pictures;
+        QVector<SubtitleLayout::ColorRange> m_colors;
+    };
+
+    struct Result
+    {
+        Result():m_imageCount(0){}
+
+        int m_imageCount;
+        QString m_errorMsg;
+    };
+    typedef Result result_type;
+
+public:
+    PreviewRenderer(Options const& _options);
+
+    Result operator()(Job const& _job) const;
+
+    static void GetPages(mst::TextEntry const& _entry, QMap<QChar, QChar> const& _charMap, QVector<Page>& _pages);
+    QImage RenderPage(SubtitleLayout& _layout, Page const& _page) const;
+
+private:
+    Options m_options;
+};
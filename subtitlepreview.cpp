@@ -0,0 +1,407 @@
+#include "subtitlepreview.h"
+
+#include <QFontMetricsF>
+#include <QPaintEvent>
+
+// Nothing is ever laid out this far, used for "everything below"
+static const int c_unboundedSize = 1 << 20;
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+SubtitleLayout::SubtitleLayout()
+{
+    m_spaceAdvance = 0;
+    m_wideSpaceAdvance = 0;
+    SetFont(QFont());
+}
+
+//-----------------------------------------------------
+// Change the font, everything has to be laid out again
+//-----------------------------------------------------
+void SubtitleLayout::SetFont
+(
+    QFont const& _font
+)
+{
+    m_font = _font;
+    m_spaceAdvance = GetSpaceAdvance(m_font);
+    m_wideSpaceAdvance = GetWideSpaceAdvance(m_font);
+
+    for (Line& line : m_lines)
+    {
+        LayoutLine(line);
+    }
+}
+
+//-----------------------------------------------------
+// Spaces used to be a transparent ".." in a smaller font,
+// keep the same width
+//-----------------------------------------------------
+qreal SubtitleLayout::GetSpaceAdvance
+(
+    QFont const& _font
+)
+{
+    QFont spaceFont = _font;
+    if (_font.pixelSize() > 0)
+    {
+        spaceFont.setPixelSize(qMax(1, _font.pixelSize() * 4 / 5));
+    }
+    else
+    {
+        spaceFont.setPointSizeF(_font.pointSizeF() * 0.8);
+    }
+    return QFontMetricsF(spaceFont).horizontalAdvance("..");
+}
+
+//-----------------------------------------------------
+// Japanese spaces used to be a transparent "あ"
+//-----------------------------------------------------
+qreal SubtitleLayout::GetWideSpaceAdvance
+(
+    QFont const& _font
+)
+{
+    return QFontMetricsF(_font).horizontalAdvance(QString::fromUtf8("あ"));
+}
+
+//-----------------------------------------------------
+// Update the page, only lines that are different are laid out
+//-----------------------------------------------------
+QRect SubtitleLayout::SetPage
+(
+    QString const& _text,
+    QStringList const& _pictures,
+    QVector<ColorRange> const& _colors
+)
+{
+    // Color of every character, later ranges are on top
+    QVector<QRgb> colors(_text.size(), qRgba(255, 255, 255, 255));
+    for (ColorRange const& range : _colors)
+    {
+        QRgb const rgba = range.m_color.rgba();
+        int const end = qMin(range.m_end, _text.size() - 1);
+        for (int i = qMax(range.m_start, 0); i <= end; i++)
+        {
+            colors[i] = rgba;
+        }
+    }
+
+    // Split into lines that each know everything they are laid out from
+    QVector<Line> lines(1);
+    int pictureIndex = 0;
+    for (int i = 0; i < _text.size(); i++)
+    {
+        QChar const chr = _text[i];
+        if (chr == '\n')
+        {
+            lines.push_back(Line());
+            continue;
+        }
+
+        Line& line = lines.back();
+        line.m_text += chr;
+        line.m_colors.push_back(colors[i]);
+        if (chr == '$')
+        {
+            line.m_pictures.push_back(pictureIndex < _pictures.size() ? _pictures[pictureIndex] : QString());
+            pictureIndex++;
+        }
+    }
+
+    // Typing only changes one line, or adds/removes some in the middle
+    int const oldCount = m_lines.size();
+    int const newCount = lines.size();
+    int prefix = 0;
+    while (prefix < oldCount && prefix < newCount && IsSameLine(m_lines[prefix], lines[prefix]))
+    {
+        prefix++;
+    }
+    if (prefix == oldCount && prefix == newCount) return QRect();
+
+    int suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix && IsSameLine(m_lines[oldCount - 1 - suffix], lines[newCount - 1 - suffix]))
+    {
+        suffix++;
+    }
+
+    for (int i = 0; i < prefix; i++)
+    {
+        lines[i] = m_lines[i];
+    }
+    for (int i = 0; i < suffix; i++)
+    {
+        lines[newCount - 1 - i] = m_lines[oldCount - 1 - i];
+    }
+
+    bool sameHeights = (oldCount == newCount);
+    for (int i = prefix; i < newCount - suffix; i++)
+    {
+        LayoutLine(lines[i]);
+        sameHeights &= (oldCount == newCount && lines[i].m_height == m_lines[i].m_height);
+    }
+
+    // Lines below only need painting when they have moved
+    QRect dirty;
+    if (sameHeights)
+    {
+        dirty = GetLinesRect(prefix, newCount - suffix - 1);
+    }
+    else
+    {
+        qreal top = 0;
+        for (int i = 0; i < prefix; i++)
+        {
+            top += m_lines[i].m_height;
+        }
+        dirty = QRectF(0, top, c_unboundedSize, c_unboundedSize).toAlignedRect();
+    }
+
+    m_lines.swap(lines);
+    return dirty;
+}
+
+//-----------------------------------------------------
+// Remove all lines
+//-----------------------------------------------------
+QRect SubtitleLayout::Clear()
+{
+    QRect dirty = GetLinesRect(0, m_lines.size() - 1);
+    m_lines.clear();
+    return dirty;
+}
+
+//-----------------------------------------------------
+// Draw all lines that touch _clip
+//-----------------------------------------------------
+void SubtitleLayout::Paint
+(
+    QPainter& _painter,
+    QRect const& _clip
+) const
+{
+    _painter.save();
+    _painter.setFont(m_font);
+
+    qreal const fontAscent = QFontMetricsF(m_font).ascent();
+    qreal y = 0;
+    for (Line const& line : m_lines)
+    {
+        if (y > _clip.bottom()) break;
+        if (y + line.m_height >= _clip.top())
+        {
+            // Everything sits on the baseline
+            qreal const baseline = y + line.m_ascent;
+            for (Run const& run : line.m_runs)
+            {
+                if (!run.m_image.isNull())
+                {
+                    _painter.drawImage(QPointF(run.m_x, baseline - run.m_image.height()), run.m_image);
+                }
+                else
+                {
+                    _painter.setPen(run.m_color);
+                    _painter.drawStaticText(QPointF(run.m_x, baseline - fontAscent), run.m_text);
+                }
+            }
+        }
+        y += line.m_height;
+    }
+
+    _painter.restore();
+}
+
+//-----------------------------------------------------
+// Is the line laid out from the same input
+//-----------------------------------------------------
+bool SubtitleLayout::IsSameLine
+(
+    Line const& _a,
+    Line const& _b
+)
+{
+    return _a.m_text == _b.m_text && _a.m_colors == _b.m_colors && _a.m_pictures == _b.m_pictures;
+}
+
+//-----------------------------------------------------
+// Break a line into runs of the same color and button images
+//-----------------------------------------------------
+void SubtitleLayout::LayoutLine
+(
+    Line& _line
+)
+{
+    QFontMetricsF const metrics(m_font);
+    _line.m_runs.clear();
+    _line.m_ascent = metrics.ascent();
+
+    qreal x = 0;
+    int runStart = -1;
+    auto finishRun = [&](int _end)
+    {
+        if (runStart < 0) return;
+
+        Run run;
+        QString const str = _line.m_text.mid(runStart, _end - runStart);
+        run.m_text.setTextFormat(Qt::PlainText);
+        run.m_text.setText(str);
+        run.m_text.prepare(QTransform(), m_font);
+        run.m_color = QColor::fromRgba(_line.m_colors[runStart]);
+        run.m_x = x;
+        _line.m_runs.push_back(run);
+
+        x += metrics.horizontalAdvance(str);
+        runStart = -1;
+    };
+
+    int pictureIndex = 0;
+    for (int i = 0; i < _line.m_text.size(); i++)
+    {
+        QChar const chr = _line.m_text[i];
+        if (chr == ' ')
+        {
+            finishRun(i);
+            x += m_spaceAdvance;
+            continue;
+        }
+
+        if (chr == QChar(0x3000))
+        {
+            finishRun(i);
+            x += m_wideSpaceAdvance;
+            continue;
+        }
+
+        if (chr == '$')
+        {
+            QString const& picture = _line.m_pictures[pictureIndex++];
+            if (!picture.isEmpty())
+            {
+                finishRun(i);
+
+                Run run;
+                run.m_image = GetImage(picture);
+                run.m_x = x;
+                _line.m_runs.push_back(run);
+
+                x += run.m_image.width();
+                _line.m_ascent = qMax(_line.m_ascent, static_cast<qreal>(run.m_image.height()));
+                continue;
+            }
+        }
+
+        if (runStart >= 0 && _line.m_colors[runStart] != _line.m_colors[i])
+        {
+            finishRun(i);
+        }
+        if (runStart < 0)
+        {
+            runStart = i;
+        }
+    }
+    finishRun(_line.m_text.size());
+
+    _line.m_height = _line.m_ascent + metrics.descent() + metrics.leading();
+}
+
+//-----------------------------------------------------
+// Button image from resources, only loaded once
+//-----------------------------------------------------
+QImage const& SubtitleLayout::GetImage
+(
+    QString const& _name
+)
+{
+    auto iter = m_images.find(_name);
+    if (iter == m_images.end())
+    {
+        iter = m_images.insert(_name, QImage(":/resources/" + _name + ".png"));
+    }
+    return iter.value();
+}
+
+//-----------------------------------------------------
+// Area covered by lines _first to _last
+//-----------------------------------------------------
+QRect SubtitleLayout::GetLinesRect
+(
+    int _first,
+    int _last
+) const
+{
+    if (_first > _last) return QRect();
+
+    qreal top = 0;
+    for (int i = 0; i < _first; i++)
+    {
+        top += m_lines[i].m_height;
+    }
+
+    qreal bottom = top;
+    for (int i = _first; i <= _last; i++)
+    {
+        bottom += m_lines[i].m_height;
+    }
+
+    return QRectF(0, top, c_unboundedSize, bottom - top).toAlignedRect();
+}
+
+//-----------------------------------------------------
+// Constructor
+//-----------------------------------------------------
+SubtitlePreview::SubtitlePreview(QWidget* parent) : QWidget(parent)
+{
+
+}
+
+//-----------------------------------------------------
+// Change font and repaint everything
+//-----------------------------------------------------
+void SubtitlePreview::SetFont
+(
+    QFont const& _font
+)
+{
+    m_layout.SetFont(_font);
+    update();
+}
+
+//-----------------------------------------------------
+// Update the page, only changed lines are repainted
+//-----------------------------------------------------
+void SubtitlePreview::SetPage
+(
+    QString const& _text,
+    QStringList const& _pictures,
+    QVector<SubtitleLayout::ColorRange> const& _colors
+)
+{
+    QRect dirty = m_layout.SetPage(_text, _pictures, _colors).intersected(rect());
+    if (!dirty.isEmpty())
+    {
+        update(dirty);
+    }
+}
+
+//-----------------------------------------------------
+// Remove everything
+//-----------------------------------------------------
+void SubtitlePreview::Clear()
+{
+    QRect dirty = m_layout.Clear().intersected(rect());
+    if (!dirty.isEmpty())
+    {
+        update(dirty);
+    }
+}
+
+//-----------------------------------------------------
+// Paint
+//-----------------------------------------------------
+void SubtitlePreview::paintEvent(QPaintEvent* event)
+{
+    QPainter painter(this);
+    painter.setClipRect(event->rect());
+    m_layout.Paint(painter, event->rect());
+}
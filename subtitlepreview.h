@@ -0,0 +1,115 @@
+//-----------------------------------------------------
+// Name: subtitlepreview.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QPainter>
+#include <QStaticText>
+#include <QStringList>
+#include <QVector>
+#include <QWidget>
+
+//-----------------------------------------------------
+// Laid out subtitle page that is kept between edits.
+// Each line keeps its glyph runs and button images, when
+// the page changes only the lines that are different get
+// laid out again. Doesn't depend on any widget so it can
+// also paint onto a QImage outside the GUI thread.
+//-----------------------------------------------------
+class SubtitleLayout
+{
+public:
+    struct ColorRange
+    {
+        ColorRange():m_start(0),m_end(0){}
+        ColorRange(int _start, int _end, QColor const& _color):m_color(_color),m_start(_start),m_end(_end){}
+
+        // Characters m_start to m_end inclusive
+        QColor m_color;
+        int m_start;
+        int m_end;
+    };
+
+public:
+    SubtitleLayout();
+
+    void SetFont(QFont const& _font);
+    QFont const& GetFont() const { return m_font; }
+
+    // Width of ' ' and '　', they are never drawn
+    static qreal GetSpaceAdvance(QFont const& _font);
+    static qreal GetWideSpaceAdvance(QFont const& _font);
+
+    // Each $ in _text takes the next name in _pictures, empty name draws $ as text
+    // Returns area that needs to be painted again
+    QRect SetPage(QString const& _text, QStringList const& _pictures, QVector<ColorRange> const& _colors);
+    QRect Clear();
+
+    void Paint(QPainter& _painter, QRect const& _clip) const;
+
+private:
+    // Either a glyph run or a button image
+    struct Run
+    {
+        Run():m_x(0){}
+
+        QStaticText m_text;
+        QImage m_image;
+        QColor m_color;
+        qreal m_x;
+    };
+
+    struct Line
+    {
+        Line():m_ascent(0),m_height(0){}
+
+        // What the line was laid out from
+        QString m_text;
+        QVector<QRgb> m_colors;
+        QStringList m_pictures;
+
+        QVector<Run> m_runs;
+        qreal m_ascent;
+        qreal m_height;
+    };
+
+    static bool IsSameLine(Line const& _a, Line const& _b);
+    void LayoutLine(Line& _line);
+    QImage const& GetImage(QString const& _name);
+    QRect GetLinesRect(int _first, int _last) const;
+
+private:
+    QFont m_font;
+    qreal m_spaceAdvance;
+    qreal m_wideSpaceAdvance;
+
+    QVector<Line> m_lines;
+    QHash<QString, QImage> m_images;
+};
+
+//-----------------------------------------------------
+// Widget showing a SubtitleLayout, only repaints
+// the lines that changed
+//-----------------------------------------------------
+class SubtitlePreview : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit SubtitlePreview(QWidget* parent = nullptr);
+
+    void SetFont(QFont const& _font);
+    void SetPage(QString const& _text, QStringList const& _pictures, QVector<SubtitleLayout::ColorRange> const& _colors);
+    void Clear();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    SubtitleLayout m_layout;
+};
@@ -0,0 +1,150 @@
+//-----------------------------------------------------
+// Name: trace.cpp
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+atomic<bool> Trace::m_enabled(false);
+atomic<unsigned long long> Trace::m_next(0);
+Trace::Event Trace::m_events[Trace::Capacity];
+
+//-----------------------------------------------------
+// Turn recording on or off, spans already started still finish
+//-----------------------------------------------------
+void Trace::SetEnabled
+(
+    bool _enabled
+)
+{
+    // Start the clock before the first span
+    Now();
+    m_enabled.store(_enabled, memory_order_relaxed);
+}
+
+//-----------------------------------------------------
+// Forget every recorded span
+//-----------------------------------------------------
+void Trace::Clear()
+{
+    for (Event& event : m_events)
+    {
+        event.m_sequence.store(0, memory_order_relaxed);
+    }
+    m_next.store(0, memory_order_release);
+}
+
+//-----------------------------------------------------
+// Microseconds since the first call
+//-----------------------------------------------------
+long long Trace::Now()
+{
+    static chrono::steady_clock::time_point const epoch = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+//-----------------------------------------------------
+// Claim the next slot and fill it
+//-----------------------------------------------------
+void Trace::Record
+(
+    char const* _name,
+    long long _start,
+    long long _duration
+)
+{
+    unsigned long long const index = m_next.fetch_add(1, memory_order_relaxed);
+    Event& event = m_events[index % Capacity];
+
+    // Readers skip the slot until the sequence is published again
+    event.m_sequence.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    event.m_name.store(_name, memory_order_relaxed);
+    event.m_start.store(_start, memory_order_relaxed);
+    event.m_duration.store(_duration, memory_order_relaxed);
+    event.m_thread.store(GetThreadID(), memory_order_relaxed);
+    event.m_sequence.store(index + 1, memory_order_release);
+}
+
+//-----------------------------------------------------
+// Copy out every complete span and write them as JSON
+//-----------------------------------------------------
+bool Trace::WriteChromeTrace
+(
+    string const& _fileName,
+    string& _errorMsg
+)
+{
+    struct Span
+    {
+        char const* m_name;
+        long long m_start;
+        long long m_duration;
+        unsigned int m_thread;
+    };
+
+    vector<Span> spans;
+    spans.reserve(Capacity);
+    for (Event const& event : m_events)
+    {
+        unsigned long long const sequence = event.m_sequence.load(memory_order_acquire);
+        if (sequence == 0) continue;
+
+        Span span;
+        span.m_name = event.m_name.load(memory_order_relaxed);
+        span.m_start = event.m_start.load(memory_order_relaxed);
+        span.m_duration = event.m_duration.load(memory_order_relaxed);
+        span.m_thread = event.m_thread.load(memory_order_relaxed);
+
+        // Overwritten while copying, drop it
+        atomic_thread_fence(memory_order_acquire);
+        if (event.m_sequence.load(memory_order_relaxed) != sequence) continue;
+
+        spans.push_back(span);
+    }
+
+    sort(spans.begin(), spans.end(), [](Span const& _a, Span const& _b)
+    {
+        return _a.m_start < _b.m_start;
+    });
+
+    FILE* output = fopen(_fileName.c_str(), "w");
+    if (!output)
+    {
+        _errorMsg = "Unable to write file!";
+        return false;
+    }
+
+    // Names are literals in the code, nothing needs escaping
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", output);
+    for (size_t i = 0; i < spans.size(); i++)
+    {
+        Span const& span = spans[i];
+        fprintf(output, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}%s\n",
+                span.m_name, span.m_thread, span.m_start, span.m_duration, (i + 1 < spans.size()) ? "," : "");
+    }
+    fputs("]}\n", output);
+
+    bool const success = !ferror(output);
+    fclose(output);
+    if (!success)
+    {
+        _errorMsg = "Unable to write file!";
+    }
+    return success;
+}
+
+//-----------------------------------------------------
+// Small number for each thread, in the order they first record
+//-----------------------------------------------------
+unsigned int Trace::GetThreadID()
+{
+    static atomic<unsigned int> nextID(1);
+    thread_local unsigned int const id = nextID.fetch_add(1, memory_order_relaxed);
+    return id;
+}
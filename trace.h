@@ -0,0 +1,136 @@
+//-----------------------------------------------------
+// Name: trace.h
+// Author: brianuuu
+// Date: 19/10/2026
+//-----------------------------------------------------
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+
+using namespace std;
+
+//-----------------------------------------------------
+// Timing spans kept in a fixed ring buffer, the oldest
+// are overwritten when it is full. Recording is lock
+// free so any thread can add spans, and costs a single
+// relaxed load while tracing is off. Define MST_NO_TRACE
+// to compile every TRACE_SCOPE out.
+//-----------------------------------------------------
+class Trace
+{
+public:
+    static bool IsEnabled() { return m_enabled.load(memory_order_relaxed); }
+    static void SetEnabled(bool _enabled);
+    static void Clear();
+
+    // Microseconds since the process started tracing
+    static long long Now();
+    static void Record(char const* _name, long long _start, long long _duration);
+
+    // Chrome trace event format, open with chrome://tracing or Perfetto
+    static bool WriteChromeTrace(string const& _fileName, string& _errorMsg);
+
+private:
+    struct Event
+    {
+        Event():m_sequence(0),m_name(nullptr),m_start(0),m_duration(0),m_thread(0){}
+
+        // 0 while being written, else index + 1 of the write that filled it
+        atomic<unsigned long long> m_sequence;
+        atomic<char const*> m_name;
+        atomic<long long> m_start;
+        atomic<long long> m_duration;
+        atomic<unsigned int> m_thread;
+    };
+
+    static unsigned int GetThreadID();
+
+    static const unsigned int Capacity = 1 << 16;
+    static atomic<bool> m_enabled;
+    static atomic<unsigned long long> m_next;
+    static Event m_events[Capacity];
+};
+
+//-----------------------------------------------------
+// Records the time between construction and destruction
+//-----------------------------------------------------
+class TraceScope
+{
+public:
+    // _name must outlive the trace, use string literals
+    explicit TraceScope(char const* _name)
+        : m_name(Trace::IsEnabled() ? _name : nullptr)
+        , m_start(m_name ? Trace::Now() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (m_name)
+        {
+            Trace::Record(m_name, m_start, Trace::Now() - m_start);
+        }
+    }
+
+    TraceScope(TraceScope const&) = delete;
+    TraceScope& operator=(TraceScope const&) = delete;
+
+private:
+    char const* m_name;
+    long long m_start;
+};
+
+//-----------------------------------------------------
+// Back to back spans in one scope, Next() ends the
+// current span and starts the next one
+//-----------------------------------------------------
+class TracePhase
+{
+public:
+    explicit TracePhase(char const* _name)
+        : m_name(Trace::IsEnabled() ? _name : nullptr)
+        , m_start(m_name ? Trace::Now() : 0)
+    {
+    }
+
+    ~TracePhase() { End(); }
+
+    void Next(char const* _name)
+    {
+        End();
+        m_name = Trace::IsEnabled() ? _name : nullptr;
+        if (m_name) m_start = Trace::Now();
+    }
+
+    TracePhase(TracePhase const&) = delete;
+    TracePhase& operator=(TracePhase const&) = delete;
+
+private:
+    void End()
+    {
+        if (m_name)
+        {
+            Trace::Record(m_name, m_start, Trace::Now() - m_start);
+            m_name = nullptr;
+        }
+    }
+
+private:
+    char const* m_name;
+    long long m_start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef MST_NO_TRACE
+#define TRACE_SCOPE(name)
+#define TRACE_PHASE(name)
+#define TRACE_NEXT_PHASE(name)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_PHASE(name) TracePhase tracePhase(name)
+#define TRACE_NEXT_PHASE(name) tracePhase.Next(name)
+#endif